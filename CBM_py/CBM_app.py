@@ -37,6 +37,8 @@ if __name__ == "__main__":
 import time
 import threading
 import traceback
+import struct
+import zlib
 
 from SmartMeshSDK.IpMgrConnectorSerial import IpMgrConnectorSerial
 from SmartMeshSDK.IpMgrConnectorMux import IpMgrSubscribe
@@ -88,7 +90,7 @@ def getAdcCodeFromGravityValue(G):
 
 LARGE_FONT = ("Verdana", 12)
 
-VERSION = 1.06
+VERSION = 1.07
 py_version = int(VERSION * 100 - int(VERSION) * 100)  # version after decimal
 ##bin_version     = bin(version).replace("0b","") # 1.02 float -> 10 binary string
 
@@ -99,6 +101,99 @@ save_frames = 0  # Keeps track of frames left to be saved to SQL database
 
 FLASH_PAGE_SAMPLES = 1024  # How many samples can be fit on a page of the external flash
 
+# Frame info packets are sent by the mote ahead of a frame. First 3 bytes are the magic,
+# followed by records of type, length and payload
+FRAME_INFO_MAGIC = [0xFE, 0xED, 0xCB]
+FRAME_INFO_TYPE_JITTER = 0x01
+FRAME_INFO_TYPE_AUX    = 0x02
+FRAME_INFO_TYPE_CAPTURE = 0x03
+FRAME_INFO_TYPE_FLASH_WR = 0x04
+FRAME_INFO_TYPE_ARCHIVE  = 0x05
+FRAME_INFO_TYPE_FLASH_RD = 0x06
+FRAME_INFO_TYPE_FRAME    = 0x07
+FRAME_NO_CAPTURE_ID      = 0xFFFFFFFF  # Frame record of a capture that isn't in the archive
+AUX_VBAT_VALID      = 0x01  # Must match ADC_AUX_x_VALID in ADC_channel_read.h
+AUX_DIE_TEMP_VALID  = 0x02
+AUX_SENS_TEMP_VALID = 0x04
+SAMP_JITTER_HIST_BINS = 8  # Must match SAMP_JITTER_HIST_BINS in scheduler.h
+
+# Calibration stored on the mote. Must match calibration.h and SmartMesh_RF_cog.h
+READY_FLAG_CALIBRATED = 0x01  # 5th byte of the ready message
+CAL_COEFF_SCALE = 2 ** 14     # Matrix coefficients are Q14
+CAL_OP_STAGE  = 0
+CAL_OP_COMMIT = 1
+CAL_OP_ERASE  = 2
+
+# Capture plan run by the mote in one wake. Must match capture_plan.h
+PLAN_MAX_ENTRIES = 4
+PLAN_PROC_FFT    = 0x01
+PLAN_OP_STAGE    = 0
+PLAN_OP_COMMIT   = 1
+PLAN_OP_CLEAR    = 2
+
+# Capture archive kept in the mote's flash. Must match capture_archive.h and SmartMesh_RF_cog.h
+ARCH_FLAG_CALIBRATED = 0x01
+ARCH_FLAG_COMPRESSED = 0x02  # Flash pages are compressed, see codec_decode_page()
+ARCH_FLAG_SPECTRUM   = 0x04  # A spectrum page follows the samples of each axis
+ARCH_FLAG_PAGE_CRC   = 0x08  # Pages were stored with a CRC, checked when read back
+ARCH_FLAG_REPLAY     = 0x80  # Frame is an archived capture sent again
+
+# Frame v2 packets. Each axis is a frame, data packets say where their bytes go in it and an
+# end packet gives its length and CRC-32. Must match SmartMesh_RF_cog.h
+FRAME_V2_DATA         = 0xD2
+FRAME_V2_END          = 0xD3
+FRAME_V2_DATA_HDR_B   = 5
+FRAME_V2_END_LEN      = 10
+FRAME_V2_KEEP         = 4       # Frames put together at once, a capture's axes and one more
+FRAME_NACK_MAX        = 3       # Times a frame's missing bytes are asked for before it is dropped
+FRAME_NACK_MAX_RANGES = 8       # Must match FRAME_RETX_MAX_RANGES in SmartMesh_RF_cog.h
+FRAME_NACK_MAX_BYTES  = 0xFFFF  # In one range
+
+# Event packets, sent ahead of the data when something goes wrong on the mote:
+# | EE | event | value (4) |. Must match SmartMesh_RF_cog.h
+EVENT_MAGIC          = 0xEE
+EVENT_LEN            = 6
+EVENT_FLASH_CORRUPT  = 0x01
+EVENT_WRITER_OVERRUN = 0x02
+EVENT_NAMES = {EVENT_FLASH_CORRUPT: "corrupt flash pages in the capture",
+               EVENT_WRITER_OVERRUN: "flash writer overruns in the capture"}
+EVENT_KEEP  = 20     # Latest events kept per mote
+
+# Binary commands to the motes. Must match SmartMesh_RF_cog.h
+DL_CMD_MAGIC        = 0xB5
+DL_CMD_VERSION      = 1
+DL_TYPE_READY       = 0x01
+DL_TYPE_SAMPLING    = 0x02
+DL_TYPE_AXES        = 0x03
+DL_TYPE_ALARM       = 0x04
+DL_TYPE_CAL_ROW     = 0x05
+DL_TYPE_PLAN_ENTRY  = 0x06
+DL_TYPE_ARCHIVE_GET = 0x07
+DL_TYPE_FRAME_NACK  = 0x08
+DL_TYPE_CREDIT      = 0x09
+
+# Frames a mote may send past the last one acknowledged without waiting for the ready
+# handshake, topped up with every frame ack. At most STREAM_MAX_CREDIT in SmartMesh_RF_cog.h
+STREAM_CREDIT_FRAMES = 6  # Two captures of three axes
+
+# Compressed flash pages. Must match sample_codec.h
+CODEC_PAGE_MAGIC  = 0xC5
+CODEC_FLAG_SIGNED = 0x01
+CODEC_HDR_FMT     = '<2B3H'
+CODEC_HDR_B       = 8
+CODEC_BLOCK_SHIFT = 4
+CODEC_BLOCK_LEN   = 1 << CODEC_BLOCK_SHIFT
+CODEC_K_INIT      = 4
+CODEC_K_MAX       = 16
+CODEC_ESC_Q       = 8
+CODEC_RAW_BITS    = 17
+
+# Spectrum of a capture too long to transform in RAM, a band of bins. Must match flash_fft.h
+SPEC_PAGE_MAGIC = 0x5B
+SPEC_HDR_FMT    = '<2B3H'
+SPEC_HDR_B      = 8
+SPEC_MAX_BINS   = (2 * FLASH_PAGE_SAMPLES - SPEC_HDR_B) // 2
+
 # ==============================================================================
 # Class for handling SmartMesh manager information
 # ==============================================================================
@@ -139,6 +234,13 @@ class Manager:
         self.sleep_dur_msg          = "0xxxxxxx"
         self.adc_num_samples_msg    = "512xxxxx"
 
+        # Sequence number of the next binary command. Starts somewhere new each run
+        # so the motes don't take the first command as a repeat of an old one
+        self.cmd_seq = int(time.time()) & 0xFFFF
+
+        # Frames of credit the motes stream on, 0 to send the ready handshake after every frame
+        self.stream_credit = STREAM_CREDIT_FRAMES
+
     def __repr__(self):
         return repr(tuple(self.mac))
 
@@ -326,26 +428,46 @@ class Manager:
             print("ERROR on send. Mote not connected")
             traceback.print_exc()
 
+    def command(self, records):
+        '''Builds a binary command for the motes, see handleBinaryCmd() in SmartMesh_RF_cog.c
+
+        @param records: list of (DL_TYPE_x, value) pairs, each value a packed string
+        @returns: message for send_to_mote()
+        '''
+        msg = struct.pack('<2BH', DL_CMD_MAGIC, DL_CMD_VERSION, self.cmd_seq)
+        for rec_type, value in records:
+            msg += struct.pack('<2B', rec_type, len(value)) + value
+        self.cmd_seq = (self.cmd_seq + 1) & 0xFFFF
+        return msg + struct.pack('<I', zlib.crc32(msg) & 0xFFFFFFFF)
+
     def send_to_all_motes(self, message, prnt=True):
         if (self.num_motes > 0):
             for mac in self.operationalMacs:
                 self.send_to_mote(mac, message, prnt)
 
+    def sampling_command(self, sampling_frequency_msg, adc_num_samples_msg, sleep_dur_msg, final_stage):
+        '''Binary command with the sampling parameters, the axes and the alarm. The parameters
+        are the 8 character fields the GUI keeps them in, e.g. "512xxxxx"'''
+        sampling = struct.pack('<3I2B', field_value(sampling_frequency_msg), field_value(adc_num_samples_msg),
+                               field_value(sleep_dur_msg), axes_mask(self.axis_sel_msg), field_value(final_stage))
+        return self.command([(DL_TYPE_SAMPLING, sampling),
+                             (DL_TYPE_ALARM, struct.pack('<B', field_value(self.alarm)))])
+
     def send_sampling_parameters(self, mac=None, alarm="0xxxxxxx"):
         '''Sends msg to motes to update parameters, by default sets alarm trigger to off'''
 
         self.final_stage = '0xxxxxxx'
-        
-        cmd_descriptor = "22xxxxxx"  # This tells MCU that the packet contains sampling parameters
 
-        sampling_message = self.sampling_frequency_msg + self.alarm         + self.axis_sel_msg \
-                         + self.adc_num_samples_msg    + self.sleep_dur_msg + cmd_descriptor + self.final_stage
-        
+        sampling_message = self.sampling_command(self.sampling_frequency_msg, self.adc_num_samples_msg,
+                                                 self.sleep_dur_msg, self.final_stage)
+
         if mac is None: 
             self.send_to_all_motes(sampling_message)
         else:
             self.send_to_mote(mac, sampling_message)
-        print("Sending sampling parameters with msg {}".format(sampling_message))
+        print("Sending sampling parameters: {}Hz, {} samples, sleep {}s, axes {}".format(
+            field_value(self.sampling_frequency_msg), field_value(self.adc_num_samples_msg),
+            field_value(self.sleep_dur_msg), self.axis_sel_msg[:3]))
 
 
     def send_axis_info(self, *args):
@@ -358,8 +480,7 @@ class Manager:
         else:
             self.axis_sel_msg = T_axis_en
 
-        cmd_descriptor = '33xxxxxx'
-        msg = 'xxxxxxxx' + '0xxxxxxx' + self.axis_sel_msg + 'xxxxxxxx' + 'xxxxxxxx' + cmd_descriptor + '0xxxxxxx'
+        msg = self.command([(DL_TYPE_AXES, struct.pack('<B', axes_mask(self.axis_sel_msg)))])
         self.send_to_all_motes(msg)
 
     def get_user_sampling_parameters(self, *args):
@@ -403,8 +524,7 @@ class Manager:
 
     def alarm_triggered(self, *args):
         '''Send a message with no changes to sampling parameters, but alarm set to "1"'''
-        cmd_descriptor = '44xxxxxx'
-        msg = 'xxxxxxxx' + '1xxxxxxx' + 'xxxxxxxx' + 'xxxxxxxx' + 'xxxxxxxx' + cmd_descriptor
+        msg = self.command([(DL_TYPE_ALARM, struct.pack('<B', 1))])
         self.send_to_mote(mgr.operationalMacs[self.ID], msg, False)
 
     ## IN mgr class
@@ -421,10 +541,111 @@ class Manager:
             mote.alarm_flag = 1
         print("Alarm set")
 
+    def send_calibration(self, mac, offsets, matrix=None):
+        '''Stores a calibration in the mote's flash. From then on the mote sends samples in milli-g
+
+        @param mac: mote to calibrate
+        @param offsets: ADC code at 0g for x, y and z
+        @param matrix: 3x3 list of gains in g per code, row = output axis. Defaults to the nominal ADC gain
+        '''
+        if matrix is None:
+            matrix = [[ADC_gain if row == col else 0.0 for col in range(3)] for row in range(3)]
+
+        rows = []
+        for axis in range(3):
+            # Coefficients are Q14 and convert codes into milli-g
+            coeffs = [int(round(c * 1000 * CAL_COEFF_SCALE)) for c in matrix[axis]]
+            op = CAL_OP_COMMIT if axis == 2 else CAL_OP_STAGE  # Last row saves all of them to flash
+            rows.append((DL_TYPE_CAL_ROW, struct.pack('<BH3hB', axis, int(round(offsets[axis])), *(coeffs + [op]))))
+        self.send_to_mote(mac, self.command(rows))
+        print("Sending calibration to {}. Offsets {}".format(self.pretty_mac(mac), offsets))
+
+    def clear_calibration(self, mac=None):
+        '''Erases the calibration stored in the mote, which will send raw ADC codes again'''
+        msg = self.command([(DL_TYPE_CAL_ROW, struct.pack('<BH3hB', 0, 0, 0, 0, 0, CAL_OP_ERASE))])
+        if mac is None:
+            self.send_to_all_motes(msg)
+        else:
+            self.send_to_mote(mac, msg)
+        for entry in self.motes.values():
+            mote = entry[0]
+            if mac is None or list(mote.mac) == list(mac):
+                mote.calibrated = False
+
+    def send_capture_plan(self, entries, mac=None):
+        '''Sends a list of captures for the mote to run back to back in each wake
+
+        @param entries: list of (sampling frequency, num samples, axes, fft[, first bin]) tuples,
+                        axes as in axis_sel_msg e.g. '111', fft True to calculate the FFT.
+                        Captures kept in flash only get SPEC_MAX_BINS bins, from first bin on
+        @param mac: mote to send to, all motes if None
+        '''
+        if not 0 < len(entries) <= PLAN_MAX_ENTRIES:
+            print("A capture plan needs 1 to {} entries".format(PLAN_MAX_ENTRIES))
+            return
+
+        records = []
+        for idx, entry in enumerate(entries):
+            freq, num_samples, axes, fft = entry[:4]
+            first_bin = entry[4] if len(entry) > 4 else 0
+            proc = PLAN_PROC_FFT if fft else 0
+            op = PLAN_OP_COMMIT if idx == len(entries) - 1 else PLAN_OP_STAGE  # Last entry starts the plan
+            records.append((DL_TYPE_PLAN_ENTRY,
+                            struct.pack('<2B2I2BH', idx, op, freq, num_samples, axes_mask(str(axes)), proc, first_bin)))
+        msg = self.command(records)
+        if mac is None:
+            self.send_to_all_motes(msg)
+        else:
+            self.send_to_mote(mac, msg)
+        print("Sending capture plan {}".format(entries))
+
+    def clear_capture_plan(self, mac=None):
+        '''Removes the capture plan, motes run the sampling parameters again'''
+        msg = self.command([(DL_TYPE_PLAN_ENTRY, struct.pack('<2B2I2BH', 0, PLAN_OP_CLEAR, 0, 0, 0, 0, 0))])
+        if mac is None:
+            self.send_to_all_motes(msg)
+        else:
+            self.send_to_mote(mac, msg)
+
+    def get_archived_capture(self, mac, seq):
+        '''Asks a mote to send an earlier capture from its archive again
+
+        The frame arrives like any other once the mote is next ready to send. Nothing is
+        sent if the capture has been overwritten. See Mote.archive for the seq of the latest
+
+        @param mac: mote to ask
+        @param seq: archive sequence number of the capture
+        '''
+        self.send_to_mote(mac, self.command([(DL_TYPE_ARCHIVE_GET, struct.pack('<I', seq))]))
+
+    def frame_nack(self, mac, frame_id, ranges):
+        '''Asks a mote to send byte ranges of a frame again. With no ranges, tells it the frame
+        is done with, so it needn't keep it any longer
+
+        @param mac: mote the frame came from
+        @param frame_id: frame id from its packets
+        @param ranges: list of (offset, bytes), at most FRAME_NACK_MAX_RANGES
+        '''
+        value = struct.pack('<B', frame_id)
+        for offset, num_bytes in ranges:
+            value += struct.pack('<IH', offset, num_bytes)
+        records = [(DL_TYPE_FRAME_NACK, value)]
+        if not ranges and self.stream_credit:
+            # The credit of a streaming mote is topped up with each frame it is done with
+            records.append((DL_TYPE_CREDIT, struct.pack('<2B', self.stream_credit, frame_id)))
+        self.send_to_mote(mac, self.command(records), prnt=False)
+
+    def stream_start(self, mac):
+        '''Grants a mote credit to stream frames from the last one it started, or stops it
+        streaming if self.stream_credit is 0. The credit is kept up by frame_nack()
+
+        @param mac: mote to grant it to
+        '''
+        self.send_to_mote(mac, self.command([(DL_TYPE_CREDIT, struct.pack('<B', self.stream_credit))]))
+
     def reset_alarm(self, *args):
         '''Send default msg with alarm value set to 0 to reset mote alarm LED'''
-        cmd_descriptor = '55xxxxxx'
-        msg = 'xxxxxxxx' + '0xxxxxxx' + 'xxxxxxxx' + 'xxxxxxxx' + 'xxxxxxxx' + cmd_descriptor
+        msg = self.command([(DL_TYPE_ALARM, struct.pack('<B', 0))])
         self.send_to_all_motes(msg, prnt=False)
         for entry in self.motes.values():
             mote = entry[0]
@@ -597,6 +818,46 @@ class Mote:
         self.remove_offsets = False
         self.offset = 0  # Default offset for all axis
 
+        # Mote applies its stored calibration and sends samples in milli-g
+        self.calibrated = False
+
+        # Sampling jitter summary of the latest capture, from the frame info packet
+        self.samp_jitter = None
+
+        # Settings of the latest capture, from the frame info packet
+        self.capture = None
+
+        # Performance of the flash writer in the latest capture, None if it was held in RAM
+        self.flash_writer = None
+
+        # Where the latest frame is in the mote's capture archive
+        self.archive = None
+
+        # Checks of flash pages the mote read back for the latest frame, None if not read from flash
+        self.flash_reader = None
+
+        # Frame record of the latest frame info packet
+        self.frame = None
+
+        # Frame v2 frames being put together by frame id, oldest first in _v2_order
+        self._v2_frames = {}
+        self._v2_order = []
+
+        # Frame and flash reader records of frames not yet complete, by frame id
+        self._v2_info = {}
+
+        # Latest event packets from the mote, (time, event, value)
+        self.events = []
+
+        # Band of bins the mote worked out for the latest frame kept in its flash, None if not sent
+        self.spectrum = None
+        self._rx_spectrum = None
+
+        # Battery and temperatures measured at the start of the latest capture, None if not measured
+        self.vbat = None
+        self.die_temp = None
+        self.sensor_temp = None
+
     def __repr__(self):
         return repr(self.ID)
 
@@ -634,15 +895,14 @@ class Mote:
         else:
             self.final_stage            = '0xxxxxxx'
         
-        cmd_descriptor = "22xxxxxx"  # This tells MCU that the packet contains sampling parameters
-
-        sampling_message = self.sampling_frequency_msg + '0xxxxxxx'         + mgr.axis_sel_msg \
-                         + self.adc_num_samples_msg    + self.sleep_dur_msg + cmd_descriptor + self.final_stage
+        sampling_message = mgr.sampling_command(self.sampling_frequency_msg, self.adc_num_samples_msg,
+                                                self.sleep_dur_msg, self.final_stage)
 
         self.first_stage = False
         
         mgr.send_to_mote(self.mac, sampling_message)
-        print("Sending sampling parameters with msg {}".format(sampling_message))
+        print("Sending sampling parameters: {}Hz, {} samples, sleep {}s, final stage {}".format(
+            self.sampling_frequency, self.adc_num_samples, self.sleep_dur, self.final_stage[0]))
 
 
 
@@ -670,6 +930,8 @@ class Mote:
                        bytes[2] == 204 and \
                        bytes[3] == 221      
 
+            frameInfo = len(bytes) >= 4 and list(bytes[0:3]) == FRAME_INFO_MAGIC
+
             # Below lines are used to debug mote when not connected to debugger
             if False:
                 if bytes[0] == 10 and bytes[1] == 11:
@@ -699,126 +961,471 @@ class Mote:
             if startAck:
                 # The mote has acknowledge the start signal from the GUI    
                 print "Mote has advertised it is ready. MAC: ", self.mac
+                self.calibrated = len(bytes) > 4 and (bytes[4] & READY_FLAG_CALIBRATED) != 0
+                if self.calibrated:
+                    print "Mote is calibrated, samples are in milli-g"
                 if TerminalMode:
                     self.send_terminal_sampling_parameters(update=True)
                 else:
                     mgr.send_sampling_parameters(None)
+                    # Also sent by a streaming mote that has run out of credit
+                    mgr.stream_start(self.mac)
 
                 moteStartAckd = True
+            elif frameInfo:
+                self._handle_frame_info(bytes)
+            elif is_event(bytes):
+                self._handle_event(bytes)
+            elif bytes[0] == FRAME_V2_DATA:
+                self._add_frame_v2_bytes(bytes)
+            elif bytes[0] == FRAME_V2_END:
+                self._end_frame_v2(bytes)
             else:
                 cur_data = self._data_order[0]
-                data_len = len(bytes) / 2
-                msb_set = bytes[1] == 255  # MSB of first word is alignment bit
-
-                if self._rx_cnt + data_len > len(cur_data):  # Restart if we get more data in a frame than expected
-                    print("[{} {}] Restarting after data overflow. Expected {}. Rxd {}".format(id(self), self._rx_cnt, len(cur_data), self._rx_cnt + data_len))
-                    self._rx_cnt = 0
-
-                    # Here so that terminal mode won't hang... you'll just lose a frame
-                    self.frame_count += 1
-                    self.stage_count = floor(self.frame_count/T_num_axes_en)
-
-                if self._rx_cnt > 0 and msb_set:  # Restart if we get an alignment bit in the middle of a frame
-                    print("[{}] Restarting after partial frame".format(id(self)))
-                    print("Rx_cnt {}, cur_data {}".format(self._rx_cnt, len(cur_data)))
-                    self._rx_cnt = 0
-
-                if self._rx_cnt == 0 and not msb_set:  # Align to the start of a new frame
-                    print("[{}] Waiting for start of new frame".format(id(self)))
-                    return  # Continue count until full frame is reached
-
-                if msb_set and self._rx_cnt == 0:
-                    # START OF FRAME
-                    self.frame_start_time = time.clock()
-                    # HANDSHAKE: Send ready message to mote. If this stops being sent then sampling will stop
-                    if not TerminalMode:
-                        # Only sending to one mote at a time to free up resources
-                        mgr.send_sampling_parameters(self.mac)
-                    else:
-                        self.send_terminal_sampling_parameters()
-                    print("[{}] Frame beginning @ {}".format(id(self), self.frame_start_time))
 
-                if (msb_set):
-                    # Check python and firmware versions match
-                    c_version = int(bytes[0] & 0x0F)
-                    version_match = int(c_version) == int(py_version)
-                    if not version_match:
-                        print("Version mismatch - GUI version: {}, Firmware version:{}".format(py_version, c_version))
+                if self._frame_compressed():
+                    if not self._add_compressed_bytes(cur_data, bytes):
+                        return
+                    self._lock.acquire()
+                    self._rx_cnt = len(cur_data)
+                else:
+                    data_len = len(bytes) / 2
+                    msb_set = bytes[1] == 255  # MSB of first word is alignment bit
 
-                self._lock.acquire()
+                    if self._rx_cnt + data_len > len(cur_data):  # Restart if we get more data in a frame than expected
+                        print("[{} {}] Restarting after data overflow. Expected {}. Rxd {}".format(id(self), self._rx_cnt, len(cur_data), self._rx_cnt + data_len))
+                        self._rx_cnt = 0
 
-                for i in range(0, len(bytes), 2):
-                    cur_data[self._rx_cnt] = (bytes[i + 1] << 8) | bytes[i]  # Convert from bytes to words
-                    self._rx_cnt = self._rx_cnt + 1
+                        # Here so that terminal mode won't hang... you'll just lose a frame
+                        self.frame_count += 1
+                        self.stage_count = floor(self.frame_count/T_num_axes_en)
+
+                    if self._rx_cnt > 0 and msb_set:  # Restart if we get an alignment bit in the middle of a frame
+                        print("[{}] Restarting after partial frame".format(id(self)))
+                        print("Rx_cnt {}, cur_data {}".format(self._rx_cnt, len(cur_data)))
+                        self._rx_cnt = 0
+
+                    if self._rx_cnt == 0 and not msb_set:  # Align to the start of a new frame
+                        print("[{}] Waiting for start of new frame".format(id(self)))
+                        return  # Continue count until full frame is reached
+
+                    if msb_set and self._rx_cnt == 0:
+                        self._start_frame(bytes)
+
+                    self._lock.acquire()
+
+                    for i in range(0, len(bytes), 2):
+                        cur_data[self._rx_cnt] = (bytes[i + 1] << 8) | bytes[i]  # Convert from bytes to words
+                        self._rx_cnt = self._rx_cnt + 1
 
                 # print "Rx Count: {}\tMAC: {}".format(self._rx_cnt, self.mac)
 
-                frame_got = False  # True if we have entered the next if statement, avoids double release of lock
                 # Are we done with frame?
                 if self._rx_cnt == len(cur_data):
-
-                    self.frame_count += 1
-                    self.stage_count = floor(self.frame_count/T_num_axes_en)
-
-                    self.frame_end_time = time.clock()
-                    self._data_order = (self._data_order[1], self._data_order[0])
-                    self._data_valid = True
-                    self._rx_cnt = 0
-                    self._lock.release()
-                    frame_got = True
-
-                    # This where we have a complete frame, update all our stats here
-                    raw, fft, ax = self.latest_valid_data()
-
-                    print("[{}] {} axis frame complete @ {}".format(id(self), ax, self.frame_end_time))
-                    print("[{}] Time between first and last packets = {}s\n".format(id(self), self.frame_end_time - self.frame_start_time))
-
-                    # Choose which stat axis list to store data: x,y,z
-                    axis_dict = {'x': 0,
-                                 'y': 1,
-                                 'z': 2}
-                    if ax is not None:
-                        axis_index = axis_dict[ax]
-                        self._peaks[axis_index].append(peak(raw))
-                        self._p2ps[axis_index].append(peak_to_peak(raw))
-                        self._means[axis_index].append(rms(raw))
-                        self._sds[axis_index].append(standard_deviation(raw))
-                        self._kurts[axis_index].append(kurtosis(raw))
-                        self._skews[axis_index].append(skew(raw))
-                        self._crests[axis_index].append(crest(raw))
-
-                    # Setting alarm stuffs
-                    if not TerminalMode:
-                        if (v and self.alarm_flag):
-                            self.check_alarm_flags(raw)
-
-                    # Setting peak, p2p and scale values
-                    for i, p in enumerate(self._peak):
-                        local_peak = max(self._peaks[i])
-                        if local_peak > p:
-                            self._peak[i] = local_peak
-                        if local_peak > self.scale[i]: 
-                            self.scale[i] = local_peak * 1.2
-
-                    for i, p2p in enumerate(self._p2p):
-                        local_p2p = max(self._p2ps[i])
-                        if local_p2p > p2p:
-                            self._p2p[i] = local_p2p
-
-                    if all(self._peaks):  # Ensure we have values for all axis'
-                        save_to_file(self, self.ID, ax, raw, fft)
-
-                    if self.remove_offsets:
-                        self.remove_offset(method=offset_removal_method)
-                        if self._offset_removed.values() == [True, True, True]:
-                            self.remove_offsets = False
-
-
-                if not frame_got:  # Ensure threading lock not released twice
+                    self._finish_frame()
+                else:
                     self._lock.release()
         except:
             print(traceback.print_exc())
 
+    def _finish_frame(self):
+        '''Swaps in the frame just filled and updates the stats and alarms with it. Called with the
+           lock held, which it releases
+        '''
+        global T_num_axes_en
+
+        self.frame_count += 1
+        self.stage_count = floor(self.frame_count/T_num_axes_en)
+
+        self.frame_end_time = time.clock()
+        self._data_order = (self._data_order[1], self._data_order[0])
+        self.spectrum, self._rx_spectrum = self._rx_spectrum, None
+        self._data_valid = True
+        self._rx_cnt = 0
+        self._lock.release()
+
+        # This where we have a complete frame, update all our stats here
+        raw, fft, ax = self.latest_valid_data()
+
+        print("[{}] {} axis frame complete @ {}".format(id(self), ax, self.frame_end_time))
+        print("[{}] Time between first and last packets = {}s\n".format(id(self), self.frame_end_time - self.frame_start_time))
+
+        # Pages that failed their check on the mote would give false stats and alarms
+        corrupt = self.flash_reader is not None and self.flash_reader['frame_corrupt'] > 0
+        if corrupt:
+            print("[{}] Frame has corrupt flash pages, not used for stats or alarms".format(id(self)))
+
+        # Choose which stat axis list to store data: x,y,z
+        axis_dict = {'x': 0,
+                     'y': 1,
+                     'z': 2}
+        if ax is not None and not corrupt:
+            axis_index = axis_dict[ax]
+            self._peaks[axis_index].append(peak(raw))
+            self._p2ps[axis_index].append(peak_to_peak(raw))
+            self._means[axis_index].append(rms(raw))
+            self._sds[axis_index].append(standard_deviation(raw))
+            self._kurts[axis_index].append(kurtosis(raw))
+            self._skews[axis_index].append(skew(raw))
+            self._crests[axis_index].append(crest(raw))
+
+        # Setting alarm stuffs
+        if not TerminalMode:
+            if (v and self.alarm_flag and not corrupt):
+                self.check_alarm_flags(raw)
+
+        # Setting peak, p2p and scale values
+        for i, p in enumerate(self._peak):
+            local_peak = max(self._peaks[i])
+            if local_peak > p:
+                self._peak[i] = local_peak
+            if local_peak > self.scale[i]: 
+                self.scale[i] = local_peak * 1.2
+
+        for i, p2p in enumerate(self._p2p):
+            local_p2p = max(self._p2ps[i])
+            if local_p2p > p2p:
+                self._p2p[i] = local_p2p
+
+        if all(self._peaks):  # Ensure we have values for all axis'
+            save_to_file(self, self.ID, ax, raw, fft)
+
+        if self.remove_offsets:
+            self.remove_offset(method=offset_removal_method)
+            if self._offset_removed.values() == [True, True, True]:
+                self.remove_offsets = False
+                self.store_calibration()
+
+    def _start_frame(self, bytes):
+        '''Called with the first packet of a frame, which has the alignment bit set'''
+        # START OF FRAME
+        self.frame_start_time = time.clock()
+        # HANDSHAKE: Send ready message to mote. If this stops being sent then sampling will stop.
+        # A streaming mote goes on without it while it has credit
+        if TerminalMode:
+            self.send_terminal_sampling_parameters()
+        elif not mgr.stream_credit:
+            # Only sending to one mote at a time to free up resources
+            mgr.send_sampling_parameters(self.mac)
+        print("[{}] Frame beginning @ {}".format(id(self), self.frame_start_time))
+
+        # Check python and firmware versions match
+        c_version = int(bytes[0] & 0x0F)
+        version_match = int(c_version) == int(py_version)
+        if not version_match:
+            print("Version mismatch - GUI version: {}, Firmware version:{}".format(py_version, c_version))
+
+    def _frame_compressed(self):
+        '''True if the frames of the current capture are sent as compressed flash pages'''
+        return self.archive is not None and self.archive['compressed'] and \
+               self._num_samples > FLASH_PAGE_SAMPLES
+
+    def _add_compressed_bytes(self, cur_data, bytes):
+        '''Decodes the compressed flash pages of a frame as their bytes come in. The first
+           packet starts with the header word, then the pages follow one after the other,
+           each only as long as its header says. The spectrum page, if the mote sends one,
+           comes after the last of them
+
+           @param cur_data: frame being filled, samples go in from index 1 as in raw frames
+           @param bytes: 90 byte packet passed down from handle_packet
+           @returns: True once all the samples of the frame, and its spectrum, have been decoded
+        '''
+        if self._rx_cnt == 0:
+            if bytes[1] != 255:  # Align to the start of a new frame
+                print("[{}] Waiting for start of new frame".format(id(self)))
+                return False
+
+            self._start_frame(bytes)
+            cur_data[0] = (bytes[1] << 8) | bytes[0]
+            self._rx_cnt = 1
+            self._rx_spectrum = None
+            self._page_bytes = list(bytes[2:])
+        else:
+            self._page_bytes.extend(bytes)
+
+        while len(self._page_bytes) >= CODEC_HDR_B and self._rx_cnt <= self._num_samples:
+            hdr = codec_page_header(self._page_bytes)
+            if hdr is None:
+                # Packets have been lost, the pages can't be found again until the next frame
+                print("[{}] Restarting after bad compressed page".format(id(self)))
+                self._rx_cnt = 0
+                return False
+
+            num_bytes = hdr[1]
+            if len(self._page_bytes) < num_bytes:
+                break
+
+            samples = codec_decode_page(self._page_bytes)[:len(cur_data) - self._rx_cnt]
+            cur_data[self._rx_cnt:self._rx_cnt + len(samples)] = samples
+            self._rx_cnt += len(samples)
+            self._page_bytes = self._page_bytes[num_bytes:]
+
+        if self._rx_cnt <= self._num_samples:
+            return False
+        if not self.archive['spectrum']:
+            return True
+
+        if len(self._page_bytes) >= SPEC_HDR_B:
+            hdr = spectrum_page_header(self._page_bytes)
+            if hdr is None:
+                print("[{}] Restarting after bad spectrum page".format(id(self)))
+                self._rx_cnt = 0
+                return False
+
+            num_bytes = SPEC_HDR_B + 2 * hdr['num_bins']
+            if len(self._page_bytes) >= num_bytes:
+                words = self._page_bytes[SPEC_HDR_B:num_bytes]
+                hdr['bins'] = [(words[i + 1] << 8) | words[i] for i in range(0, len(words), 2)]
+                self._rx_spectrum = hdr
+
+        return self._rx_spectrum is not None
+
+    def _add_frame_v2_bytes(self, bytes):
+        '''Places the data of a frame v2 packet at its offset in the frame, whatever order the
+           packets come in. Packets the mote sends again for a frame already ended go in the
+           same way, and the frame is checked again once the last range asked for has come
+
+           @param bytes: packet of | FRAME_V2_DATA | frame id | offset (3) | data |
+           @returns: None
+        '''
+        frame_id = bytes[1]
+        offset = bytes[2] | (bytes[3] << 8) | (bytes[4] << 16)
+        data = bytearray(bytes[FRAME_V2_DATA_HDR_B:])
+
+        frame = self._v2_frames.get(frame_id)
+        if frame is None:
+            frame = self._new_frame_v2(frame_id)
+
+        end = offset + len(data)
+        if end > len(frame['data']):
+            frame['got'].extend(bytearray(end - len(frame['data'])))
+            frame['data'].extend(bytearray(end - len(frame['data'])))
+
+        frame['data'][offset:end] = data
+        frame['got'][offset:end] = bytearray([1]) * len(data)
+
+        if frame['end'] is not None and end >= frame['nack_end']:
+            self._check_frame_v2(frame_id)
+
+    def _new_frame_v2(self, frame_id):
+        '''Starts putting a frame v2 frame together. Only the latest FRAME_V2_KEEP are kept'''
+        if len(self._v2_order) >= FRAME_V2_KEEP:
+            oldest = self._v2_order.pop(0)
+            del self._v2_frames[oldest]
+            self._v2_info.pop(oldest, None)
+            print("[{}] Frame {} dropped, it was never completed".format(id(self), oldest))
+
+        frame = {'data': bytearray(),
+                 'got': bytearray(),
+                 'start_time': time.clock(),
+                 'end': None,       # (bytes, CRC) from the end packet
+                 'nack_end': 0,     # End of the last range asked for again
+                 'nacks': 0}
+        self._v2_frames[frame_id] = frame
+        self._v2_order.append(frame_id)
+        return frame
+
+    def _drop_frame_v2(self, frame_id):
+        del self._v2_frames[frame_id]
+        self._v2_order.remove(frame_id)
+        self._v2_info.pop(frame_id, None)
+
+    def _end_frame_v2(self, bytes):
+        '''Takes the length and CRC of a frame v2 frame from its end packet and checks the frame
+
+           @param bytes: packet of | FRAME_V2_END | frame id | bytes (4) | CRC-32 (4) |
+           @returns: None
+        '''
+        frame_id = bytes[1]
+        frame = self._v2_frames.get(frame_id)
+        if frame is None:
+            frame = self._new_frame_v2(frame_id)
+        frame['end'] = struct.unpack('<2I', bytearray(bytes[2:FRAME_V2_END_LEN]))
+        self._check_frame_v2(frame_id)
+
+    def _check_frame_v2(self, frame_id):
+        '''Asks the mote for the byte ranges of an ended frame that haven't come in, up to
+           FRAME_NACK_MAX times. A frame with all its bytes is checked against its CRC and
+           handed on as a complete frame. Either way the mote is told once it can let the
+           frame go
+        '''
+        frame = self._v2_frames[frame_id]
+        num_bytes, crc = frame['end']
+
+        got = frame['got'][:num_bytes]
+        got.extend(bytearray(num_bytes - len(got)))
+        gaps = frame_gaps(got)
+        if gaps:
+            missing = ", ".join("{}-{}".format(start, end - 1) for start, end in gaps)
+            if frame['nacks'] < FRAME_NACK_MAX:
+                ranges = nack_ranges(gaps)[:FRAME_NACK_MAX_RANGES]
+                frame['nacks'] += 1
+                frame['nack_end'] = ranges[-1][0] + ranges[-1][1]
+                print("[{}] Frame {} missing bytes {}, asking for them again".format(id(self), frame_id, missing))
+                mgr.frame_nack(self.mac, frame_id, ranges)
+                return
+            print("[{}] Frame {} dropped, still missing bytes {}".format(id(self), frame_id, missing))
+            mgr.frame_nack(self.mac, frame_id, [])
+            self._drop_frame_v2(frame_id)
+            return
+
+        data = frame['data'][:num_bytes]
+        start_time = frame['start_time']
+        info = self._v2_info.get(frame_id)
+        self._drop_frame_v2(frame_id)
+        mgr.frame_nack(self.mac, frame_id, [])
+
+        if zlib.crc32(str(data)) & 0xFFFFFFFF != crc:
+            print("[{}] Frame {} failed its CRC".format(id(self), frame_id))
+            return
+
+        if info is not None:
+            self.frame, self.flash_reader = info
+
+        cur_data = self._data_order[0]
+        self._rx_cnt = 0
+
+        if self._frame_compressed():
+            if not self._add_compressed_bytes(cur_data, list(data)):
+                print("[{}] Frame {} is short of samples".format(id(self), frame_id))
+                self._rx_cnt = 0
+                return
+            self._lock.acquire()
+        else:
+            # A frame from flash has only the header word ahead of its samples, they go in
+            # from index 1 as in compressed frames
+            num_words = len(cur_data) - (1 if self._num_samples > FLASH_PAGE_SAMPLES else 0)
+            if num_bytes != 2 * num_words:
+                print("[{}] Frame {} is {} bytes, expected {}".format(id(self), frame_id, num_bytes, 2 * num_words))
+                return
+            self._start_frame(data)
+            self._lock.acquire()
+            cur_data[:num_words] = struct.unpack('<{}H'.format(num_words), str(data))
+            cur_data[num_words:] = [0] * (len(cur_data) - num_words)
+
+        # The ready handshake goes out once the frame is complete, timing is from its first packet
+        self.frame_start_time = start_time
+        self._finish_frame()
+
+    def _handle_frame_info(self, bytes):
+        '''Parses a frame info packet sent by the mote ahead of a frame
+
+        @param bytes: packet starting with FRAME_INFO_MAGIC followed by type, length, payload records
+        @returns: None
+        '''
+        i = len(FRAME_INFO_MAGIC)
+        while i + 2 <= len(bytes):
+            info_type, info_len = bytes[i], bytes[i + 1]
+            self._handle_frame_info_record(info_type, bytearray(bytes[i + 2:i + 2 + info_len]))
+            i += 2 + info_len
+
+        # Frame info goes at a higher priority than frame data, so it can overtake the end of the
+        # frame before. The records of each frame are put back when it is complete
+        if self.frame is not None:
+            self._v2_info[self.frame['id']] = (self.frame, self.flash_reader)
+
+    def _handle_event(self, bytes):
+        '''Reports an event packet, which the mote sends ahead of any data it has queued
+
+        @param bytes: packet of | EVENT_MAGIC | event | value (4) |
+        @returns: None
+        '''
+        event = bytes[1]
+        value = struct.unpack('<I', bytearray(bytes[2:EVENT_LEN]))[0]
+        self.events.append((time.time(), event, value))
+        del self.events[:-EVENT_KEEP]
+        print("[{}] WARNING: mote reports {} {}".format(
+            id(self), value, EVENT_NAMES.get(event, "of event {}".format(event))))
+
+    def _handle_frame_info_record(self, info_type, payload):
+        if info_type == FRAME_INFO_TYPE_CAPTURE:
+            entry, num_entries, freq, num_samples, axes, proc = struct.unpack('<2B2I2B', payload[:12])
+            self.capture = {'entry': entry,
+                            'entries': num_entries,
+                            'sampling_frequency': freq,
+                            'num_samples': num_samples,
+                            'axes': axes,
+                            'fft': (proc & PLAN_PROC_FFT) != 0}
+            self.flash_writer = None  # Only reported for captures stored in flash
+            self.flash_reader = None
+            self.archive = None
+            if num_entries:
+                print("[{}] Capture plan entry {} of {}: {}Hz, {} samples, axes {}".format(
+                    id(self), entry + 1, num_entries, freq, num_samples, axes))
+            # Captures of a plan can each have a different length
+            if num_samples != self._num_samples:
+                self.update(num_samples)
+
+        elif info_type == FRAME_INFO_TYPE_FRAME:
+            frame_id, capture_id, axis, encoding, freq, num_samples = struct.unpack('<BI2B2I', payload[:15])
+            self.frame = {'id': frame_id,
+                          'capture_id': None if capture_id == FRAME_NO_CAPTURE_ID else capture_id,
+                          'axis': axis,
+                          'calibrated': (encoding & ARCH_FLAG_CALIBRATED) != 0,
+                          'compressed': (encoding & ARCH_FLAG_COMPRESSED) != 0,
+                          'spectrum': (encoding & ARCH_FLAG_SPECTRUM) != 0,
+                          'sampling_frequency': freq,
+                          'num_samples': num_samples}
+            print("[{}] Frame {}: axis {}, capture {}, {}Hz, {} samples".format(
+                id(self), frame_id, 'xyz'[axis] if axis < 3 else axis, self.frame['capture_id'], freq, num_samples))
+
+        elif info_type == FRAME_INFO_TYPE_ARCHIVE:
+            seq, timestamp, flags = struct.unpack('<2IB', payload[:9])
+            self.archive = {'seq': seq,
+                            'timestamp': timestamp,
+                            'calibrated': (flags & ARCH_FLAG_CALIBRATED) != 0,
+                            'compressed': (flags & ARCH_FLAG_COMPRESSED) != 0,
+                            'spectrum': (flags & ARCH_FLAG_SPECTRUM) != 0,
+                            'page_crc': (flags & ARCH_FLAG_PAGE_CRC) != 0,
+                            'replay': (flags & ARCH_FLAG_REPLAY) != 0}
+            print("[{}] {} capture {}, taken at RTC {}s".format(
+                id(self), "Archived" if self.archive['replay'] else "New", seq, timestamp))
+
+        elif info_type == FRAME_INFO_TYPE_FLASH_WR:
+            pages, overruns, max_queue, page_us, max_rate = struct.unpack('<IHBHI', payload[:13])
+            self.flash_writer = {'pages': pages,
+                                 'overruns': overruns,
+                                 'max_queue_depth': max_queue,
+                                 'page_time_us': page_us,
+                                 'max_rate_hz': max_rate}
+            print("[{}] Flash: {} pages, {}us per page, {} overruns, max queue {}. Max sustainable rate {}Hz".format(
+                id(self), pages, page_us, overruns, max_queue, max_rate))
+
+        elif info_type == FRAME_INFO_TYPE_FLASH_RD:
+            frame_corrupt, pages, corrected, retries, corrupt = struct.unpack('<HI3H', payload[:12])
+            self.flash_reader = {'frame_corrupt': frame_corrupt,
+                                 'pages': pages,
+                                 'corrected': corrected,
+                                 'retries': retries,
+                                 'corrupt': corrupt}
+            print("[{}] Flash reads: {} pages, {} corrected, {} retries, {} corrupt".format(
+                id(self), pages, corrected, retries, corrupt))
+            if frame_corrupt:
+                print("[{}] WARNING: {} corrupt flash pages in this frame".format(id(self), frame_corrupt))
+
+        elif info_type == FRAME_INFO_TYPE_AUX:
+            vbat_mv, die_temp, sensor_temp, valid = struct.unpack('<H2hB', payload[:7])
+            self.vbat = vbat_mv / 1000.0 if valid & AUX_VBAT_VALID else None
+            self.die_temp = die_temp / 100.0 if valid & AUX_DIE_TEMP_VALID else None
+            self.sensor_temp = sensor_temp / 100.0 if valid & AUX_SENS_TEMP_VALID else None
+            print("[{}] Battery {}V, die temperature {}C, board temperature {}C".format(
+                id(self), self.vbat, self.die_temp, self.sensor_temp))
+
+        elif info_type == FRAME_INFO_TYPE_JITTER:
+            fmt = '<5I{}H'.format(SAMP_JITTER_HIST_BINS)
+            fields = struct.unpack(fmt, payload[:struct.calcsize(fmt)])
+            self.samp_jitter = {'period_us': fields[0],
+                                'samples': fields[1],
+                                'missed': fields[2],
+                                'late': fields[3],
+                                'max_latency_us': fields[4],
+                                'hist': list(fields[5:])}
+            print("[{}] Sampling jitter: {} samples, {} missed, {} late, max latency {}us (period {}us)".format(
+                id(self), fields[1], fields[2], fields[3], fields[4], fields[0]))
+            print("[{}] Latency histogram (<1us, <2us, <4us ... >=64us): {}".format(id(self), list(fields[5:])))
+        else:
+            print("[{}] Unknown frame info type {}".format(id(self), info_type))
+
     def handle_packet(self, packet):
         '''Orders incoming mote packets by timestamp for processing
 
@@ -835,6 +1442,12 @@ class Mote:
         @returns None
         '''
 
+        # Frame v2 packets say where they go in their frame, they needn't wait for older ones.
+        # Events are reported as soon as they come
+        if len(packet[1]) > 0 and (packet[1][0] in (FRAME_V2_DATA, FRAME_V2_END) or is_event(packet[1])):
+            self._handle_bytes(packet[1])
+            return
+
         self._packet_queue.append(packet)  # packet -> (time, data)
         self._packet_queue.sort(key=lambda entry: entry[0], reverse=True)  # Sort by latest timestamp
 
@@ -866,15 +1479,17 @@ class Mote:
 
         with self._lock:
             params = self._data_order[1][0]  # Info on axis - x,y,z
-            raw = self._data_order[1][mgr.adc_param_len:mgr.adc_num_samples]
+            raw = self._data_order[1][mgr.adc_param_len:self._num_samples]
             
             #for d  in self._data_order[1]:
             #    print "Data: ", d
 
-            if mgr.adc_num_samples <= FLASH_PAGE_SAMPLES:
-                fft = self._data_order[1][mgr.adc_num_samples + mgr.adc_param_len:]
+            if self._num_samples <= FLASH_PAGE_SAMPLES:
+                fft = self._data_order[1][self._num_samples + mgr.adc_param_len:]
+            elif self.spectrum is not None:
+                fft = spectrum_to_fft(self.spectrum, self._num_samples)
             else:
-                fft = [0 for x in range(mgr.adc_num_samples//2)]
+                fft = [0 for x in range(self._num_samples//2)]
 
         x_set = (int(params & 0x00F0)) == 144
         y_set = (int(params & 0x00F0)) == 160
@@ -894,6 +1509,12 @@ class Mote:
         #print("{} axis: Average Raw Value = {}".format(ax, raw_avg))
         #print("{} axis: Average Raw Value - offset = {} (O={})".format(ax, raw_avg - self.offset, self.offset))
 
+        if self.calibrated:
+            # Already offset corrected and scaled on the mote, signed milli-g
+            raw = [(x - 65536 if x >= 32768 else x) / 1000.0 for x in raw]
+            fft = [2 * x / 1000.0 for x in fft]
+            return (raw, fft, ax)
+
         if withOffset:
             # Just return raw codes
             pass
@@ -915,6 +1536,12 @@ class Mote:
         if not self._data_valid:
             return
 
+        if self.calibrated:
+            # Mote removes its own offsets. Clear the calibration first to measure new ones
+            print("Mote is calibrated. Offsets not removed")
+            self._offset_removed = {'x': True, 'y': True, 'z': True}
+            return
+
         raw_w_offset, fft, ax = self.latest_valid_data(withOffset=True)
 
         if method == 1:
@@ -959,12 +1586,21 @@ class Mote:
 
 
 
+    def store_calibration(self):
+        '''Sends the measured offsets to the mote so that it corrects the samples itself'''
+        if self.calibrated or not self.mac:
+            return
+        offsets = [ADC_offset + self._x_offset, ADC_offset + self._y_offset, ADC_offset + self._z_offset]
+        mgr.send_calibration(self.mac, offsets)
+        self.calibrated = True
+
     ##############################  Functions for mote updates  #################################
     def update(self, num_samples):
         '''Takes in new num_samples and updates mote values'''
         try:
             print "UPDATING MOTE with mac", self.mac
             self._data_valid = False
+            self._num_samples = num_samples
             if num_samples <= FLASH_PAGE_SAMPLES:
                 self._data1 = (mgr.adc_param_len + 3 * (num_samples / 2)) * [0]
                 self._data2 = (mgr.adc_param_len + 3 * (num_samples / 2)) * [0]
@@ -1505,6 +2141,137 @@ def crest(dataList):
         traceback.print_exc()
 
 
+def field_value(field):
+    '''Value of an 8 character parameter field padded with x, e.g. "512xxxxx"'''
+    digits = field.rstrip('x')
+    return int(digits) if digits else 0
+
+
+def axes_mask(axes):
+    '''Bit per axis of an axis select field, e.g. "101xxxxx" -> x and z'''
+    return sum(1 << i for i, c in enumerate(axes[:3]) if c == '1')
+
+
+def frame_gaps(got):
+    '''Byte ranges of a frame v2 frame that haven't come in, as (start, end) pairs
+
+    @param got: bytearray with 1 for each byte of the frame received and 0 for the rest
+    '''
+    gaps = []
+    start = got.find(b'\x00')
+    while start >= 0:
+        end = got.find(b'\x01', start)
+        if end < 0:
+            end = len(got)
+        gaps.append((start, end))
+        start = got.find(b'\x00', end)
+    return gaps
+
+
+def nack_ranges(gaps):
+    '''Splits the gaps of a frame into (offset, bytes) ranges short enough for a frame NACK'''
+    ranges = []
+    for start, end in gaps:
+        while start < end:
+            num_bytes = min(end - start, FRAME_NACK_MAX_BYTES)
+            ranges.append((start, num_bytes))
+            start += num_bytes
+    return ranges
+
+
+def is_event(data):
+    '''True if a packet from a mote is an event packet'''
+    return len(data) == EVENT_LEN and data[0] == EVENT_MAGIC
+
+
+def codec_page_header(data):
+    '''Returns (flags, num_bytes, num_samples, first) of a compressed page, or None if data
+       doesn't start with one'''
+    if len(data) < CODEC_HDR_B or data[0] != CODEC_PAGE_MAGIC:
+        return None
+    magic, flags, num_bytes, num_samples, first = struct.unpack(CODEC_HDR_FMT, str(bytearray(data[:CODEC_HDR_B])))
+    if num_bytes < CODEC_HDR_B:
+        return None
+    return flags, num_bytes, num_samples, first
+
+
+def spectrum_page_header(data):
+    '''Returns a dict with the FFT length, first bin and number of bins of a spectrum page,
+       or None if data doesn't start with one'''
+    if len(data) < SPEC_HDR_B or data[0] != SPEC_PAGE_MAGIC:
+        return None
+    magic, log2_len, first_bin, num_bins, reserved = struct.unpack(SPEC_HDR_FMT, str(bytearray(data[:SPEC_HDR_B])))
+    if num_bins > SPEC_MAX_BINS:
+        return None
+    return {'length': 1 << log2_len, 'first_bin': first_bin, 'num_bins': num_bins}
+
+
+def spectrum_to_fft(spectrum, num_samples):
+    '''Places the band of a spectrum page in a list of num_samples/2 bins like the FFT of a
+       capture held in RAM. The mote may have transformed fewer samples than were captured,
+       each of its bins then covers more than one of the list and the others stay 0'''
+    fft = [0] * (num_samples // 2)
+    for i, mag in enumerate(spectrum['bins']):
+        idx = (spectrum['first_bin'] + i) * num_samples // spectrum['length']
+        if idx < len(fft):
+            fft[idx] = mag
+    return fft
+
+
+def codec_decode_page(data):
+    '''Decodes one compressed flash page into its samples, see sample_codec.c
+
+    @param data: bytes of the page, at least the number of bytes given in its header
+    @returns: list of samples as sent by the mote, 16 bit codes or milli-g in two's complement
+    '''
+    flags, num_bytes, num_samples, first = codec_page_header(data)
+    signed = (flags & CODEC_FLAG_SIGNED) != 0
+    pos = [CODEC_HDR_B * 8]  # Bit position, MSB first
+
+    def bit():
+        b = (data[pos[0] >> 3] >> (7 - (pos[0] & 7))) & 1
+        pos[0] += 1
+        return b
+
+    def bits(n):
+        v = 0
+        for _ in range(n):
+            v = (v << 1) | bit()
+        return v
+
+    prev1 = prev2 = first ^ 0x8000 if signed else first
+    order, k = 1, CODEC_K_INIT
+    sum1 = sum2 = count = 0
+    out = [prev1]
+    for _ in range(num_samples - 1):
+        q = 0
+        while q < CODEC_ESC_Q and bit():
+            q += 1
+        if q == CODEC_ESC_Q:
+            u = bits(CODEC_RAW_BITS)
+        else:
+            u = (q << k) | bits(k)
+        r = (u >> 1) if (u & 1) == 0 else -((u + 1) >> 1)
+
+        pred1 = prev1
+        pred2 = min(max(2 * prev1 - prev2, 0), 0xFFFF)
+        x = r + (pred1 if order == 1 else pred2)
+        out.append(x)
+
+        sum1 += abs(x - pred1)
+        sum2 += abs(x - pred2)
+        prev2, prev1 = prev1, x
+        count += 1
+        if count == CODEC_BLOCK_LEN:
+            order = 2 if sum2 < sum1 else 1
+            k = min(((sum1 if order == 1 else sum2) >> CODEC_BLOCK_SHIFT).bit_length(), CODEC_K_MAX)
+            sum1 = sum2 = count = 0
+
+    if signed:
+        out = [x ^ 0x8000 for x in out]
+    return out
+
+
 def set_alarm(self):
     for entry in mgr.motes.values():
         mote = entry[0]
@@ -2138,6 +2905,8 @@ try:
     mgr = Manager()
 
     if TerminalMode:
+        # The stages are counted off by the parameters sent with each frame
+        mgr.stream_credit = 0
         numMotes      = 0
 
         while(numMotes != T_num_motes):
@@ -57,6 +57,8 @@ static const uint16_t dn_hdlc_fcstab[256] = {
 
 #define DN_HDLC_MAX_FRAME_LENGTH       128
 #define DN_HDLC_INPUT_BUFFER_SIZE      DN_HDLC_MAX_FRAME_LENGTH
+// every byte of the frame and CRC escaped, plus the two flags
+#define DN_HDLC_OUTPUT_BUFFER_SIZE     (2*(DN_HDLC_MAX_FRAME_LENGTH+2)+2)
 
 //=========================== typedef =========================================
 
@@ -74,6 +76,7 @@ void dn_hdlc_init(dn_hdlc_rxFrame_cbt rxFrame_cb);
 // output
 void dn_hdlc_outputOpen();
 void dn_hdlc_outputWrite(uint8_t b);
+void dn_hdlc_outputWriteBuf(const uint8_t* bytes, uint8_t len);
 void dn_hdlc_outputClose();
 
 #ifdef __cplusplus
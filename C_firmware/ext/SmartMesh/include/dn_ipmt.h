@@ -12,10 +12,15 @@ C library to connect to a SmartMesh IP Mote.
 #include "dn_common.h"
 #include "dn_endianness.h"
 #include "dn_clib_version.h"
+#include "dn_serial_mt.h"
 
 //=========================== defines =========================================
 
 #define MAX_FRAME_LENGTH                    128
+// commands that can be waiting for their reply at once
+#define DN_IPMT_MAX_REQUESTS                4
+// RC of a command the mote didn't reply to in time
+#define DN_IPMT_RC_TIMEOUT                  0xff
 #define DN_SUBCMDID_NONE                    0xff
 
 //===== well-known IPv6 address of the SmartMesh IP manager
@@ -238,6 +243,8 @@ static const uint8_t ipv6Addr_manager[16] = {
 #define DN_SENDTO_REQ_OFFS_PACKETID                                  21
 #define DN_SENDTO_REQ_OFFS_PAYLOAD                                   23
 #define DN_SENDTO_REQ_LEN                                            23
+// payload parts dn_ipmt_sendToSegs() takes
+#define DN_SENDTO_MAX_SEGS                                           3
 
 // search
 #define DN_SEARCH_REQ_LEN                                            0
@@ -808,7 +815,7 @@ typedef struct {
 
 //=== callback signature
 typedef void (*dn_ipmt_notif_cbt)(uint8_t cmdId, uint8_t subCmdId);
-typedef void (*dn_ipmt_reply_cbt)(uint8_t cmdId);
+typedef void (*dn_ipmt_reply_cbt)(uint8_t cmdId, void* tag);
 typedef void (*dn_ipmt_status_cbt)(uint8_t newStatus); // only used in SmartMesh IP manager
 
 //=========================== variables =======================================
@@ -822,6 +829,9 @@ typedef void (*dn_ipmt_status_cbt)(uint8_t newStatus); // only used in SmartMesh
 //==== admin
 void     dn_ipmt_init(dn_ipmt_notif_cbt notifCb, uint8_t* notifBuf, uint8_t notifBufLen, dn_ipmt_reply_cbt replyCb);
 void     dn_ipmt_cancelTx();
+void     dn_ipmt_setNextReply(void* tag, uint32_t timeoutMs);
+uint8_t  dn_ipmt_pending();
+void     dn_ipmt_tick(uint32_t elapsedMs);
 
 
 //==== API
@@ -866,6 +876,7 @@ dn_err_t dn_ipmt_openSocket(uint8_t protocol, dn_ipmt_openSocket_rpt* reply);
 dn_err_t dn_ipmt_closeSocket(uint8_t socketId, dn_ipmt_closeSocket_rpt* reply);
 dn_err_t dn_ipmt_bindSocket(uint8_t socketId, uint16_t port, dn_ipmt_bindSocket_rpt* reply);
 dn_err_t dn_ipmt_sendTo(uint8_t socketId, uint8_t* destIP, uint16_t destPort, uint8_t serviceType, uint8_t priority, uint16_t packetId, uint8_t* payload, uint8_t payloadLen, dn_ipmt_sendTo_rpt* reply);
+dn_err_t dn_ipmt_sendToSegs(uint8_t socketId, uint8_t* destIP, uint16_t destPort, uint8_t serviceType, uint8_t priority, uint16_t packetId, const dn_serial_seg_t* payload, uint8_t numSegs, dn_ipmt_sendTo_rpt* reply);
 dn_err_t dn_ipmt_search(dn_ipmt_search_rpt* reply);
 dn_err_t dn_ipmt_testRadioTxExt(uint8_t testType, uint16_t chanMask, uint16_t repeatCnt, int8_t txPower, uint8_t seqSize, uint8_t pkLen_1, uint16_t delay_1, uint8_t pkLen_2, uint16_t delay_2, uint8_t pkLen_3, uint16_t delay_3, uint8_t pkLen_4, uint16_t delay_4, uint8_t pkLen_5, uint16_t delay_5, uint8_t pkLen_6, uint16_t delay_6, uint8_t pkLen_7, uint16_t delay_7, uint8_t pkLen_8, uint16_t delay_8, uint8_t pkLen_9, uint16_t delay_9, uint8_t pkLen_10, uint16_t delay_10, uint8_t stationId, dn_ipmt_testRadioTxExt_rpt* reply);
 dn_err_t dn_ipmt_zeroize(dn_ipmt_zeroize_rpt* reply);
@@ -27,6 +27,12 @@ Serial connector.
 typedef void (*dn_serial_request_cbt)(uint8_t cmdId, uint8_t flags, uint8_t* payload, uint8_t len);
 typedef void (*dn_serial_reply_cbt)(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len);
 
+// one part of a request payload, the parts are sent one after the other
+typedef struct {
+   const uint8_t*       data;
+   uint8_t              len;
+} dn_serial_seg_t;
+
 //=========================== variables =======================================
 
 //=========================== prototypes ======================================
@@ -39,5 +45,13 @@ dn_err_t dn_serial_mt_sendRequest(
    uint8_t              length,
    dn_serial_reply_cbt  replyCb
 );
+dn_err_t dn_serial_mt_sendRequestSegs(
+   uint8_t              cmdId,
+   uint8_t              extraFlags,
+   const dn_serial_seg_t* segs,
+   uint8_t              numSegs,
+   dn_serial_reply_cbt  replyCb
+);
+void     dn_serial_mt_cancelReply();
 
 #endif
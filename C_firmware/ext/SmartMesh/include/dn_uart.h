@@ -11,7 +11,10 @@ Copyright (c) 2014, Dust Networks. All rights reserved.
 #include <adi_processor.h>
 
 //=========================== defined =========================================
-#define buffer_size      128
+/* Ring of received bytes between the UART interrupt and the main loop. The
+   interrupt empties the RX FIFO into it, buffer_handle() hands the bytes to
+   the HDLC decoder a span at a time */
+#define buffer_size      512
 #define DATASIZE_i2c     8
 
 /* Memory required by the driver for bidirectional mode of operation. */
@@ -29,20 +32,28 @@ Copyright (c) 2014, Dust Networks. All rights reserved.
 #define        UART_DEVICE_NUM 0u
 #define        RESET_SM_PORT   ADI_GPIO_PORT2
 #define        RESET_SM_PIN    ADI_GPIO_PIN_9 
+#define        UART_RX_REG     pREG_UART0_RX
+#define        UART_LSR_REG    pREG_UART0_LSR
 #else
 #define        UART_DEVICE_NUM 1u
 #define        RESET_SM_PORT   ADI_GPIO_PORT0
 #define        RESET_SM_PIN    ADI_GPIO_PIN_14 
+#define        UART_RX_REG     pREG_UART1_RX
+#define        UART_LSR_REG    pREG_UART1_LSR
 #endif  /* End of #ifdef COG*/
 #else
 #error UART driver is not ported for this processor
 #endif /*End of #if defined.... #elif*/
 
+/* Frames the UART driver queues for the TX DMA at once, the HDLC encoder
+   builds each into its own buffer */
+#define DN_UART_TX_FRAMES       2u
+
 /* Timeout value for receiving data. */
 #define UART_GET_BUFFER_TIMEOUT 1000000u
 //=========================== typedef =========================================
 
-typedef void (*dn_uart_rxByte_cbt)(uint8_t byte);
+typedef void (*dn_uart_rxBytes_cbt)(const uint8_t* bytes, uint16_t len);
 
 //=========================== variables =======================================
 
@@ -53,8 +64,10 @@ typedef void (*dn_uart_rxByte_cbt)(uint8_t byte);
  extern "C" {
 #endif
 
-void dn_uart_init(dn_uart_rxByte_cbt rxByte_cb);
+void dn_uart_init(dn_uart_rxBytes_cbt rxBytes_cb);
 void dn_uart_txByte(uint8_t byte);
+void dn_uart_txFrame(const uint8_t* frame, uint16_t len);
+void dn_uart_txWait(uint8_t maxInFlight);
 void dn_uart_txFlush();
 void dn_uart_irq_enable(void);
 void dn_uart_irq_disable(void);
@@ -24,6 +24,9 @@ typedef struct {
    uint8_t              inputBuf[DN_HDLC_INPUT_BUFFER_SIZE];
    // output
    uint16_t             outputCrc;
+   uint8_t              outputIdx;
+   uint16_t             outputFill;
+   uint8_t              outputBuf[DN_UART_TX_FRAMES][DN_HDLC_OUTPUT_BUFFER_SIZE];
 } dn_hdlc_vars_t;
 
 dn_hdlc_vars_t dn_hdlc_vars;
@@ -31,11 +34,7 @@ dn_hdlc_vars_t dn_hdlc_vars;
 //=========================== prototypes ======================================
 
 // callback handlers
-void dn_hdlc_rxByte(uint8_t rxbyte);
-// input
-void dn_hdlc_inputOpen();
-void dn_hdlc_inputWrite(uint8_t b);
-void dn_hdlc_inputClose();
+void dn_hdlc_rxBytes(const uint8_t* bytes, uint16_t len);
 // helpers
 uint16_t dn_hdlc_crcIteration(uint16_t crc, uint8_t data_byte);
 
@@ -52,7 +51,7 @@ void dn_hdlc_init(dn_hdlc_rxFrame_cbt rxFrame_cb) {
    dn_hdlc_vars.rxFrame_cb = rxFrame_cb;
    
    // initialize UART
-   dn_uart_init(dn_hdlc_rxByte);
+   dn_uart_init(dn_hdlc_rxBytes);
 }
 
 //=========================== private =========================================
@@ -60,67 +59,91 @@ void dn_hdlc_init(dn_hdlc_rxFrame_cbt rxFrame_cb) {
 //===== callback_handler
 
 /**
-\brief Function which getted called each time a byte is received over UART.
+\brief Function which gets called with each span of bytes received over UART.
 
-\param[in] rxbyte The received byte.
+The bytes are un-escaped, stored and run through the CRC in one pass, with
+the decoder state held in locals rather than in dn_hdlc_vars. Each frame
+that ends in the span is handed over as soon as its closing flag is seen
+and its CRC checks out.
+
+\param[in] bytes The received bytes.
+\param[in] len   Number of bytes.
 */
-void dn_hdlc_rxByte(uint8_t rxbyte) {
+void dn_hdlc_rxBytes(const uint8_t* bytes, uint16_t len) {
+   uint8_t    rxbyte;
+   uint8_t    b;
+   uint8_t    lastRxByte;
+   bool       busyReceiving;
+   bool       inputEscaping;
+   uint16_t   inputCrc;
+   uint8_t    inputBufFill;
    
    // lock the module
    dn_lock();
    
-   if        (
-         dn_hdlc_vars.busyReceiving==FALSE  &&
-         dn_hdlc_vars.lastRxByte==DN_HDLC_FLAG &&
-         rxbyte!=DN_HDLC_FLAG
-      ) {
-      // start of frame
-      
-      // I'm now receiving
-      dn_hdlc_vars.busyReceiving       = TRUE;
-      
-      // create the HDLC frame
-      dn_hdlc_inputOpen();
-      
-      // add the byte just received
-      dn_hdlc_inputWrite(rxbyte);
-   } else if (
-         dn_hdlc_vars.busyReceiving==TRUE   &&
-         rxbyte!=DN_HDLC_FLAG
-      ){
-      // middle of frame
-      
-      // add the byte just received
-      dn_hdlc_inputWrite(rxbyte);
-      
-      if (dn_hdlc_vars.inputBufFill+1>DN_HDLC_INPUT_BUFFER_SIZE) {
-         // input buffer overflow
-         dn_hdlc_vars.inputBufFill       = 0;
-         dn_hdlc_vars.busyReceiving      = FALSE;
-      }
-   } else if (
-         dn_hdlc_vars.busyReceiving==TRUE   &&
-         rxbyte==DN_HDLC_FLAG
-      ) {
-      // end of frame
-      
-      // finalize the HDLC frame
-      dn_hdlc_inputClose();
+   lastRxByte    = dn_hdlc_vars.lastRxByte;
+   busyReceiving = dn_hdlc_vars.busyReceiving;
+   inputEscaping = dn_hdlc_vars.inputEscaping;
+   inputCrc      = dn_hdlc_vars.inputCrc;
+   inputBufFill  = dn_hdlc_vars.inputBufFill;
+   
+   while (len--) {
+      rxbyte = *bytes++;
       
-      if (dn_hdlc_vars.inputBufFill==0) {
-         // invalid HDLC frame
+      if (rxbyte==DN_HDLC_FLAG) {
+         if (busyReceiving==TRUE) {
+            // end of frame, a good CRC leaves its own two bytes at the end
+            if (inputCrc==DN_HDLC_CRCGOOD && inputBufFill>2) {
+               // hand over frame to upper layer
+               dn_hdlc_vars.rxFrame_cb(&dn_hdlc_vars.inputBuf[0],inputBufFill-2);
+            }
+            
+            inputBufFill  = 0;
+            inputEscaping = FALSE;
+            busyReceiving = FALSE;
+         }
       } else {
-         // hand over frame to upper layer
-         dn_hdlc_vars.rxFrame_cb(&dn_hdlc_vars.inputBuf[0],dn_hdlc_vars.inputBufFill);
+         if (busyReceiving==FALSE) {
+            if (lastRxByte!=DN_HDLC_FLAG) {
+               // between frames
+               lastRxByte = rxbyte;
+               continue;
+            }
+            
+            // start of frame
+            busyReceiving = TRUE;
+            inputBufFill  = 0;
+            inputCrc      = DN_HDLC_CRCINIT;
+         }
          
-         // clear inputBuffer
-         dn_hdlc_vars.inputBufFill=0;
+         if (rxbyte==DN_HDLC_ESCAPE) {
+            inputEscaping = TRUE;
+         } else {
+            b = rxbyte;
+            if (inputEscaping==TRUE) {
+               b = b^DN_HDLC_ESCAPE_MASK;
+               inputEscaping = FALSE;
+            }
+            
+            if (inputBufFill+1>=DN_HDLC_INPUT_BUFFER_SIZE) {
+               // input buffer overflow
+               inputBufFill  = 0;
+               busyReceiving = FALSE;
+            } else {
+               dn_hdlc_vars.inputBuf[inputBufFill++] = b;
+               inputCrc = (inputCrc >> 8) ^ dn_hdlc_fcstab[(inputCrc ^ b) & 0xff];
+            }
+         }
       }
       
-      dn_hdlc_vars.busyReceiving = FALSE;
+      lastRxByte = rxbyte;
    }
    
-   dn_hdlc_vars.lastRxByte = rxbyte;
+   dn_hdlc_vars.lastRxByte    = lastRxByte;
+   dn_hdlc_vars.busyReceiving = busyReceiving;
+   dn_hdlc_vars.inputEscaping = inputEscaping;
+   dn_hdlc_vars.inputCrc      = inputCrc;
+   dn_hdlc_vars.inputBufFill  = inputBufFill;
    
    // unlock the module
    dn_unlock();
@@ -130,13 +153,22 @@ void dn_hdlc_rxByte(uint8_t rxbyte) {
 
 /**
 \brief Start an HDLC frame in the output buffer.
+
+Frames are built in turn into one of DN_UART_TX_FRAMES buffers, so the next
+one can be built while the UART DMA is still sending the last. The buffer is
+only reused once the frame sent from it has gone out.
 */
 void dn_hdlc_outputOpen() {
+   // take the next buffer, waiting for the frame sent from it to be done
+   dn_hdlc_vars.outputIdx = (dn_hdlc_vars.outputIdx+1)%DN_UART_TX_FRAMES;
+   dn_uart_txWait(DN_UART_TX_FRAMES-1);
+   
    // initialize the value of the CRC
-   dn_hdlc_vars.outputCrc = DN_HDLC_CRCINIT;
+   dn_hdlc_vars.outputCrc  = DN_HDLC_CRCINIT;
    
-   // send opening HDLC flag
-   dn_uart_txByte(DN_HDLC_FLAG);
+   // opening HDLC flag
+   dn_hdlc_vars.outputBuf[dn_hdlc_vars.outputIdx][0] = DN_HDLC_FLAG;
+   dn_hdlc_vars.outputFill = 1;
 }
 
 /**
@@ -145,96 +177,86 @@ void dn_hdlc_outputOpen() {
 \param[in] b The byte to add.
 */
 void dn_hdlc_outputWrite(uint8_t b) {
-   
-   // iterate through CRC calculator
-   dn_hdlc_vars.outputCrc = dn_hdlc_crcIteration(dn_hdlc_vars.outputCrc,b);
-   
-   // write optional escape byte
-   if (b==DN_HDLC_FLAG || b==DN_HDLC_ESCAPE) {
-      dn_uart_txByte(DN_HDLC_ESCAPE);
-      b = b^DN_HDLC_ESCAPE_MASK;
-   }
-   
-   // data byte
-   dn_uart_txByte(b);
+   dn_hdlc_outputWriteBuf(&b,1);
 }
 
 /**
-\brief Finalize the outgoing HDLC frame.
-*/
-void dn_hdlc_outputClose() {
-   uint16_t   finalCrc;
-   
-   // finalize the calculation of the CRC
-   finalCrc   = ~dn_hdlc_vars.outputCrc;
-   
-   // write the CRC value
-   dn_hdlc_outputWrite((finalCrc>>0)&0xff);
-   dn_hdlc_outputWrite((finalCrc>>8)&0xff);
-   
-   // write closing HDLC flag
-   dn_uart_txByte(DN_HDLC_FLAG);
-   
-   // flush the UART
-   dn_uart_txFlush();
-}
+\brief Add a run of bytes to the outgoing HDLC frame being built.
 
-//===== input
+The bytes are escaped and run through the CRC in one pass, with the encoder
+state held in locals. Bytes that would not fit in the frame are dropped, the
+CRC then fails at the mote.
 
-/**
-\brief Start an HDLC frame in the input buffer.
+\param[in] bytes The bytes to add.
+\param[in] len   Number of bytes.
 */
-void dn_hdlc_inputOpen() {
-   // reset the input buffer index
-   dn_hdlc_vars.inputBufFill = 0;
+void dn_hdlc_outputWriteBuf(const uint8_t* bytes, uint8_t len) {
+   uint8_t*   out;
+   uint16_t   fill;
+   uint16_t   crc;
+   uint8_t    b;
    
-   // initialize the value of the CRC
-   dn_hdlc_vars.inputCrc = DN_HDLC_CRCINIT;
-}
-
-/**
-\brief Add a byte to the incoming HDLC frame.
-
-\param[in] b The byte to add.
-*/
-void dn_hdlc_inputWrite(uint8_t b) {
-   if (b==DN_HDLC_ESCAPE) {
-      dn_hdlc_vars.inputEscaping = TRUE;
-   } else {
-      if (dn_hdlc_vars.inputEscaping==TRUE) {
-         b = b^DN_HDLC_ESCAPE_MASK;
-         dn_hdlc_vars.inputEscaping = FALSE;
+   out  = dn_hdlc_vars.outputBuf[dn_hdlc_vars.outputIdx];
+   fill = dn_hdlc_vars.outputFill;
+   crc  = dn_hdlc_vars.outputCrc;
+   
+   while (len--) {
+      b   = *bytes++;
+      
+      // room for an escaped byte, the CRC and the closing flag
+      if (fill+2+4+1>DN_HDLC_OUTPUT_BUFFER_SIZE) {
+         break;
       }
       
-      // add byte to input buffer
-      dn_hdlc_vars.inputBuf[dn_hdlc_vars.inputBufFill] = b;
-      dn_hdlc_vars.inputBufFill++;
+      crc = (crc >> 8) ^ dn_hdlc_fcstab[(crc ^ b) & 0xff];
       
-      // iterate through CRC calculator
-      dn_hdlc_vars.inputCrc = dn_hdlc_crcIteration(dn_hdlc_vars.inputCrc,b);
+      // write optional escape byte
+      if (b==DN_HDLC_FLAG || b==DN_HDLC_ESCAPE) {
+         out[fill++] = DN_HDLC_ESCAPE;
+         b           = b^DN_HDLC_ESCAPE_MASK;
+      }
+      
+      // data byte
+      out[fill++] = b;
    }
+   
+   dn_hdlc_vars.outputFill = fill;
+   dn_hdlc_vars.outputCrc  = crc;
 }
 
 /**
-\brief Finalize the incoming HDLC frame.
+\brief Finalize the outgoing HDLC frame and hand it to the UART.
+
+The frame is sent by DMA, this returns before it has gone out.
 */
-void dn_hdlc_inputClose() {
+void dn_hdlc_outputClose() {
+   uint8_t*   out;
+   uint16_t   fill;
+   uint16_t   finalCrc;
+   uint8_t    b;
+   uint8_t    i;
    
-   // verify the validity of the frame
-   if (dn_hdlc_vars.inputCrc==DN_HDLC_CRCGOOD) {
-      // the CRC is correct
-      
-      // remove the CRC from the input buffer
-      dn_hdlc_vars.inputBufFill    -= 2;
-   } else {
-      // the CRC is incorrect
-      
-      // drop the incoming fram
-      dn_hdlc_vars.inputBufFill     = 0;
+   out  = dn_hdlc_vars.outputBuf[dn_hdlc_vars.outputIdx];
+   fill = dn_hdlc_vars.outputFill;
+   
+   // finalize the calculation of the CRC
+   finalCrc   = ~dn_hdlc_vars.outputCrc;
+   
+   // write the CRC value, LSB first
+   for (i=0; i<2; i++) {
+      b = (finalCrc>>(8*i))&0xff;
+      if (b==DN_HDLC_FLAG || b==DN_HDLC_ESCAPE) {
+         out[fill++] = DN_HDLC_ESCAPE;
+         b           = b^DN_HDLC_ESCAPE_MASK;
+      }
+      out[fill++] = b;
    }
    
-   // reset escaping
-   dn_hdlc_vars.inputEscaping = FALSE;
+   // write closing HDLC flag
+   out[fill++] = DN_HDLC_FLAG;
+   
+   // send the frame
+   dn_uart_txFrame(out,fill);
 }
 
 //=========================== helpers =========================================
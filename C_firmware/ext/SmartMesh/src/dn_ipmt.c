@@ -12,15 +12,31 @@ C library to connect to a SmartMesh IP Mote.
 
 //=========================== variables =======================================
 
+// a command handed to the module, on the serial line or waiting for it
 typedef struct {
-   // sending requests
-   uint8_t              outputBuf[MAX_FRAME_LENGTH];
-   bool                 busyTx;
+   // sending the request
    uint8_t              cmdId;
    uint8_t              paramId;
+   uint8_t              extraFlags;
+   uint8_t              length;
+   dn_serial_reply_cbt  serialReplyCb;
+   uint8_t              outputBuf[MAX_FRAME_LENGTH];
+   // receiving the reply
+   uint8_t*             replyContents;
+   void*                tag;
+   uint32_t             timeoutMs;
+} dn_ipmt_req_t;
+
+typedef struct {
+   // sending requests, oldest first. Only the oldest is on the serial line
+   dn_ipmt_req_t        reqs[DN_IPMT_MAX_REQUESTS];
+   uint8_t              reqHead;
+   uint8_t              reqCount;
+   bool                 reqSent;
+   void*                nextTag;
+   uint32_t             nextTimeoutMs;
    // receiving replies
    dn_ipmt_reply_cbt    replyCb;
-   uint8_t*             replyContents;
    // receiving notifications
    dn_ipmt_notif_cbt    notifCb;
    uint8_t*             notifBuf;
@@ -80,6 +96,14 @@ void dn_ipmt_socketInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8
 
 // serial RX
 void dn_ipmt_rxSerialRequest(uint8_t cmdId, uint8_t flags, uint8_t* payload, uint8_t len);
+// request table
+dn_ipmt_req_t* dn_ipmt_reqAlloc();
+void dn_ipmt_reqSend();
+dn_err_t dn_ipmt_reqSubmit(dn_ipmt_req_t* req, uint8_t cmdId, uint8_t extraFlags, uint8_t* payload, uint8_t length, dn_serial_reply_cbt replyCb);
+dn_err_t dn_ipmt_reqSubmitSegs(dn_ipmt_req_t* req, uint8_t cmdId, uint8_t extraFlags, const dn_serial_seg_t* segs, uint8_t numSegs, dn_serial_reply_cbt replyCb);
+dn_ipmt_req_t* dn_ipmt_reqSent(uint8_t cmdId);
+void dn_ipmt_reqDone();
+void dn_ipmt_reqTimeout();
 
 //=========================== public ==========================================
 
@@ -103,12 +127,83 @@ void dn_ipmt_init(dn_ipmt_notif_cbt notifCb, uint8_t* notifBuf, uint8_t notifBuf
    dn_serial_mt_init(dn_ipmt_rxSerialRequest);
 }
 
+/**
+\brief Drop every command that has no reply yet, without calling back.
+*/
 void dn_ipmt_cancelTx() {
    
    // lock the module
    dn_lock();
    
-   dn_ipmt_vars.busyTx=FALSE;
+   dn_ipmt_vars.reqCount  = 0;
+   dn_ipmt_vars.reqSent   = FALSE;
+   
+   // a reply still on its way is not for the next command
+   dn_serial_mt_cancelReply();
+   
+   // unlock the module
+   dn_unlock();
+}
+
+/**
+\brief Set the tag and reply timeout of the next command.
+
+The tag is handed back to the reply callback of the command, so replies can be
+routed to whoever sent it. A timeout of 0 waits for the reply for ever.
+
+\param[in] tag       Returned with the reply.
+\param[in] timeoutMs Time the command may spend on the serial line.
+*/
+void dn_ipmt_setNextReply(void* tag, uint32_t timeoutMs) {
+   
+   // lock the module
+   dn_lock();
+   
+   dn_ipmt_vars.nextTag        = tag;
+   dn_ipmt_vars.nextTimeoutMs  = timeoutMs;
+   
+   // unlock the module
+   dn_unlock();
+}
+
+/**
+\brief Number of commands without a reply yet.
+*/
+uint8_t dn_ipmt_pending() {
+   return dn_ipmt_vars.reqCount;
+}
+
+/**
+\brief Count down the reply timeout of the command on the serial line.
+
+A command that runs out of time has its RC set to DN_IPMT_RC_TIMEOUT and its
+callback called as for a reply, see dn_ipmt_reqTimeout().
+
+\param[in] elapsedMs Time since the last call.
+*/
+void dn_ipmt_tick(uint32_t elapsedMs) {
+   dn_ipmt_req_t* req;
+   
+   // lock the module
+   dn_lock();
+   
+   if (dn_ipmt_vars.reqSent==TRUE) {
+      req = &dn_ipmt_vars.reqs[dn_ipmt_vars.reqHead];
+      
+      if (req->timeoutMs>0) {
+         if (req->timeoutMs>elapsedMs) {
+            req->timeoutMs -= elapsedMs;
+         } else {
+            // a reply that comes in late is dropped, the packet ID of the
+            // next command tells them apart should it have the same cmdId
+            dn_serial_mt_cancelReply();
+            
+            // every reply starts with its RC
+            req->replyContents[0] = DN_IPMT_RC_TIMEOUT;
+            dn_ipmt_reqTimeout();
+         }
+      }
+   }
    
    // unlock the module
    dn_unlock();
@@ -126,13 +221,15 @@ the mote. The new value takes effect after the mote resets.
 */
 dn_err_t dn_ipmt_setParameter_macAddress(uint8_t* macAddress, dn_ipmt_setParameter_macAddress_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -141,31 +238,27 @@ dn_err_t dn_ipmt_setParameter_macAddress(uint8_t* macAddress, dn_ipmt_setParamet
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_SETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_MACADDRESS;
+   req->cmdId                 = CMDID_SETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_MACADDRESS;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_MACADDRESS;
-   memcpy(&dn_ipmt_vars.outputBuf[DN_SETPARAMETER_MACADDRESS_REQ_OFFS_MACADDRESS],macAddress,8);
+   req->outputBuf[0] = PARAMID_MACADDRESS;
+   memcpy(&req->outputBuf[DN_SETPARAMETER_MACADDRESS_REQ_OFFS_MACADDRESS],macAddress,8);
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_SETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_SETPARAMETER_MACADDRESS_REQ_LEN,                       // length
       dn_ipmt_setParameter_macAddress_reply                     // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -175,16 +268,18 @@ dn_err_t dn_ipmt_setParameter_macAddress(uint8_t* macAddress, dn_ipmt_setParamet
 
 void dn_ipmt_setParameter_macAddress_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_setParameter_macAddress_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -194,7 +289,7 @@ void dn_ipmt_setParameter_macAddress_reply(uint8_t cmdId, uint8_t rc, uint8_t* p
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_setParameter_macAddress_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_setParameter_macAddress_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -204,11 +299,8 @@ void dn_ipmt_setParameter_macAddress_reply(uint8_t cmdId, uint8_t rc, uint8_t* p
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== setParameter_joinKey
@@ -222,13 +314,15 @@ Reading the joinKey parameter is prohibited for security reasons.
 */
 dn_err_t dn_ipmt_setParameter_joinKey(uint8_t* joinKey, dn_ipmt_setParameter_joinKey_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -237,31 +331,27 @@ dn_err_t dn_ipmt_setParameter_joinKey(uint8_t* joinKey, dn_ipmt_setParameter_joi
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_SETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_JOINKEY;
+   req->cmdId                 = CMDID_SETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_JOINKEY;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_JOINKEY;
-   memcpy(&dn_ipmt_vars.outputBuf[DN_SETPARAMETER_JOINKEY_REQ_OFFS_JOINKEY],joinKey,16);
+   req->outputBuf[0] = PARAMID_JOINKEY;
+   memcpy(&req->outputBuf[DN_SETPARAMETER_JOINKEY_REQ_OFFS_JOINKEY],joinKey,16);
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_SETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_SETPARAMETER_JOINKEY_REQ_LEN,                          // length
       dn_ipmt_setParameter_joinKey_reply                        // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -271,16 +361,18 @@ dn_err_t dn_ipmt_setParameter_joinKey(uint8_t* joinKey, dn_ipmt_setParameter_joi
 
 void dn_ipmt_setParameter_joinKey_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_setParameter_joinKey_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -290,7 +382,7 @@ void dn_ipmt_setParameter_joinKey_reply(uint8_t cmdId, uint8_t rc, uint8_t* payl
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_setParameter_joinKey_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_setParameter_joinKey_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -300,11 +392,8 @@ void dn_ipmt_setParameter_joinKey_reply(uint8_t cmdId, uint8_t rc, uint8_t* payl
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== setParameter_networkId
@@ -321,13 +410,15 @@ the Manager's network ID to 0xFFFF.
 */
 dn_err_t dn_ipmt_setParameter_networkId(uint16_t networkId, dn_ipmt_setParameter_networkId_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -336,31 +427,27 @@ dn_err_t dn_ipmt_setParameter_networkId(uint16_t networkId, dn_ipmt_setParameter
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_SETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_NETWORKID;
+   req->cmdId                 = CMDID_SETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_NETWORKID;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_NETWORKID;
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_SETPARAMETER_NETWORKID_REQ_OFFS_NETWORKID],networkId);
+   req->outputBuf[0] = PARAMID_NETWORKID;
+   dn_write_uint16_t(&req->outputBuf[DN_SETPARAMETER_NETWORKID_REQ_OFFS_NETWORKID],networkId);
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_SETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_SETPARAMETER_NETWORKID_REQ_LEN,                        // length
       dn_ipmt_setParameter_networkId_reply                      // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -370,16 +457,18 @@ dn_err_t dn_ipmt_setParameter_networkId(uint16_t networkId, dn_ipmt_setParameter
 
 void dn_ipmt_setParameter_networkId_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_setParameter_networkId_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -389,7 +478,7 @@ void dn_ipmt_setParameter_networkId_reply(uint8_t cmdId, uint8_t rc, uint8_t* pa
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_setParameter_networkId_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_setParameter_networkId_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -399,11 +488,8 @@ void dn_ipmt_setParameter_networkId_reply(uint8_t cmdId, uint8_t rc, uint8_t* pa
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== setParameter_txPower
@@ -419,13 +505,15 @@ is disabled, then set the txPower parameter to 0 to turn off the PA.
 */
 dn_err_t dn_ipmt_setParameter_txPower(int8_t txPower, dn_ipmt_setParameter_txPower_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -434,31 +522,27 @@ dn_err_t dn_ipmt_setParameter_txPower(int8_t txPower, dn_ipmt_setParameter_txPow
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_SETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_TXPOWER;
+   req->cmdId                 = CMDID_SETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_TXPOWER;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_TXPOWER;
-   dn_ipmt_vars.outputBuf[DN_SETPARAMETER_TXPOWER_REQ_OFFS_TXPOWER] = (int8_t)txPower;
+   req->outputBuf[0] = PARAMID_TXPOWER;
+   req->outputBuf[DN_SETPARAMETER_TXPOWER_REQ_OFFS_TXPOWER] = (int8_t)txPower;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_SETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_SETPARAMETER_TXPOWER_REQ_LEN,                          // length
       dn_ipmt_setParameter_txPower_reply                        // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -468,16 +552,18 @@ dn_err_t dn_ipmt_setParameter_txPower(int8_t txPower, dn_ipmt_setParameter_txPow
 
 void dn_ipmt_setParameter_txPower_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_setParameter_txPower_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -487,7 +573,7 @@ void dn_ipmt_setParameter_txPower_reply(uint8_t cmdId, uint8_t rc, uint8_t* payl
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_setParameter_txPower_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_setParameter_txPower_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -497,11 +583,8 @@ void dn_ipmt_setParameter_txPower_reply(uint8_t cmdId, uint8_t rc, uint8_t* payl
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== setParameter_joinDutyCycle
@@ -517,13 +600,15 @@ searching for network.
 */
 dn_err_t dn_ipmt_setParameter_joinDutyCycle(uint8_t dutyCycle, dn_ipmt_setParameter_joinDutyCycle_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -532,31 +617,27 @@ dn_err_t dn_ipmt_setParameter_joinDutyCycle(uint8_t dutyCycle, dn_ipmt_setParame
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_SETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_JOINDUTYCYCLE;
+   req->cmdId                 = CMDID_SETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_JOINDUTYCYCLE;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_JOINDUTYCYCLE;
-   dn_ipmt_vars.outputBuf[DN_SETPARAMETER_JOINDUTYCYCLE_REQ_OFFS_DUTYCYCLE] = dutyCycle;
+   req->outputBuf[0] = PARAMID_JOINDUTYCYCLE;
+   req->outputBuf[DN_SETPARAMETER_JOINDUTYCYCLE_REQ_OFFS_DUTYCYCLE] = dutyCycle;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_SETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_SETPARAMETER_JOINDUTYCYCLE_REQ_LEN,                    // length
       dn_ipmt_setParameter_joinDutyCycle_reply                  // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -566,16 +647,18 @@ dn_err_t dn_ipmt_setParameter_joinDutyCycle(uint8_t dutyCycle, dn_ipmt_setParame
 
 void dn_ipmt_setParameter_joinDutyCycle_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_setParameter_joinDutyCycle_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -585,7 +668,7 @@ void dn_ipmt_setParameter_joinDutyCycle_reply(uint8_t cmdId, uint8_t rc, uint8_t
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_setParameter_joinDutyCycle_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_setParameter_joinDutyCycle_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -595,11 +678,8 @@ void dn_ipmt_setParameter_joinDutyCycle_reply(uint8_t cmdId, uint8_t rc, uint8_t
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== setParameter_eventMask
@@ -615,13 +695,15 @@ ignore all unknown events.
 */
 dn_err_t dn_ipmt_setParameter_eventMask(uint32_t eventMask, dn_ipmt_setParameter_eventMask_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -630,31 +712,27 @@ dn_err_t dn_ipmt_setParameter_eventMask(uint32_t eventMask, dn_ipmt_setParameter
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_SETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_EVENTMASK;
+   req->cmdId                 = CMDID_SETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_EVENTMASK;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_EVENTMASK;
-   dn_write_uint32_t(&dn_ipmt_vars.outputBuf[DN_SETPARAMETER_EVENTMASK_REQ_OFFS_EVENTMASK],eventMask);
+   req->outputBuf[0] = PARAMID_EVENTMASK;
+   dn_write_uint32_t(&req->outputBuf[DN_SETPARAMETER_EVENTMASK_REQ_OFFS_EVENTMASK],eventMask);
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_SETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_SETPARAMETER_EVENTMASK_REQ_LEN,                        // length
       dn_ipmt_setParameter_eventMask_reply                      // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -664,16 +742,18 @@ dn_err_t dn_ipmt_setParameter_eventMask(uint32_t eventMask, dn_ipmt_setParameter
 
 void dn_ipmt_setParameter_eventMask_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_setParameter_eventMask_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -683,7 +763,7 @@ void dn_ipmt_setParameter_eventMask_reply(uint8_t cmdId, uint8_t rc, uint8_t* pa
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_setParameter_eventMask_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_setParameter_eventMask_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -693,11 +773,8 @@ void dn_ipmt_setParameter_eventMask_reply(uint8_t cmdId, uint8_t rc, uint8_t* pa
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== setParameter_OTAPLockout
@@ -709,13 +786,15 @@ effect immediately.
 */
 dn_err_t dn_ipmt_setParameter_OTAPLockout(bool mode, dn_ipmt_setParameter_OTAPLockout_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -724,31 +803,27 @@ dn_err_t dn_ipmt_setParameter_OTAPLockout(bool mode, dn_ipmt_setParameter_OTAPLo
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_SETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_OTAPLOCKOUT;
+   req->cmdId                 = CMDID_SETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_OTAPLOCKOUT;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_OTAPLOCKOUT;
-   dn_ipmt_vars.outputBuf[DN_SETPARAMETER_OTAPLOCKOUT_REQ_OFFS_MODE] = mode;
+   req->outputBuf[0] = PARAMID_OTAPLOCKOUT;
+   req->outputBuf[DN_SETPARAMETER_OTAPLOCKOUT_REQ_OFFS_MODE] = mode;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_SETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_SETPARAMETER_OTAPLOCKOUT_REQ_LEN,                      // length
       dn_ipmt_setParameter_OTAPLockout_reply                    // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -758,16 +833,18 @@ dn_err_t dn_ipmt_setParameter_OTAPLockout(bool mode, dn_ipmt_setParameter_OTAPLo
 
 void dn_ipmt_setParameter_OTAPLockout_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_setParameter_OTAPLockout_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -777,7 +854,7 @@ void dn_ipmt_setParameter_OTAPLockout_reply(uint8_t cmdId, uint8_t rc, uint8_t*
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_setParameter_OTAPLockout_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_setParameter_OTAPLockout_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -787,11 +864,8 @@ void dn_ipmt_setParameter_OTAPLockout_reply(uint8_t cmdId, uint8_t rc, uint8_t*
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== setParameter_routingMode
@@ -803,13 +877,15 @@ leaf node.
 */
 dn_err_t dn_ipmt_setParameter_routingMode(bool mode, dn_ipmt_setParameter_routingMode_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -818,31 +894,27 @@ dn_err_t dn_ipmt_setParameter_routingMode(bool mode, dn_ipmt_setParameter_routin
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_SETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_ROUTINGMODE;
+   req->cmdId                 = CMDID_SETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_ROUTINGMODE;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_ROUTINGMODE;
-   dn_ipmt_vars.outputBuf[DN_SETPARAMETER_ROUTINGMODE_REQ_OFFS_MODE] = mode;
+   req->outputBuf[0] = PARAMID_ROUTINGMODE;
+   req->outputBuf[DN_SETPARAMETER_ROUTINGMODE_REQ_OFFS_MODE] = mode;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_SETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_SETPARAMETER_ROUTINGMODE_REQ_LEN,                      // length
       dn_ipmt_setParameter_routingMode_reply                    // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -852,16 +924,18 @@ dn_err_t dn_ipmt_setParameter_routingMode(bool mode, dn_ipmt_setParameter_routin
 
 void dn_ipmt_setParameter_routingMode_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_setParameter_routingMode_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -871,7 +945,7 @@ void dn_ipmt_setParameter_routingMode_reply(uint8_t cmdId, uint8_t rc, uint8_t*
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_setParameter_routingMode_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_setParameter_routingMode_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -881,11 +955,8 @@ void dn_ipmt_setParameter_routingMode_reply(uint8_t cmdId, uint8_t rc, uint8_t*
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== setParameter_powerSrcInfo
@@ -896,13 +967,15 @@ the device. This setting is persistent and is used at network join time.
 */
 dn_err_t dn_ipmt_setParameter_powerSrcInfo(uint16_t maxStCurrent, uint8_t minLifetime, uint16_t currentLimit_0, uint16_t dischargePeriod_0, uint16_t rechargePeriod_0, uint16_t currentLimit_1, uint16_t dischargePeriod_1, uint16_t rechargePeriod_1, uint16_t currentLimit_2, uint16_t dischargePeriod_2, uint16_t rechargePeriod_2, dn_ipmt_setParameter_powerSrcInfo_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -911,41 +984,37 @@ dn_err_t dn_ipmt_setParameter_powerSrcInfo(uint16_t maxStCurrent, uint8_t minLif
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_SETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_POWERSRCINFO;
+   req->cmdId                 = CMDID_SETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_POWERSRCINFO;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_POWERSRCINFO;
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_MAXSTCURRENT],maxStCurrent);
-   dn_ipmt_vars.outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_MINLIFETIME] = minLifetime;
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_CURRENTLIMIT_0],currentLimit_0);
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_DISCHARGEPERIOD_0],dischargePeriod_0);
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_RECHARGEPERIOD_0],rechargePeriod_0);
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_CURRENTLIMIT_1],currentLimit_1);
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_DISCHARGEPERIOD_1],dischargePeriod_1);
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_RECHARGEPERIOD_1],rechargePeriod_1);
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_CURRENTLIMIT_2],currentLimit_2);
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_DISCHARGEPERIOD_2],dischargePeriod_2);
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_RECHARGEPERIOD_2],rechargePeriod_2);
-   
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   req->outputBuf[0] = PARAMID_POWERSRCINFO;
+   dn_write_uint16_t(&req->outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_MAXSTCURRENT],maxStCurrent);
+   req->outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_MINLIFETIME] = minLifetime;
+   dn_write_uint16_t(&req->outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_CURRENTLIMIT_0],currentLimit_0);
+   dn_write_uint16_t(&req->outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_DISCHARGEPERIOD_0],dischargePeriod_0);
+   dn_write_uint16_t(&req->outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_RECHARGEPERIOD_0],rechargePeriod_0);
+   dn_write_uint16_t(&req->outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_CURRENTLIMIT_1],currentLimit_1);
+   dn_write_uint16_t(&req->outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_DISCHARGEPERIOD_1],dischargePeriod_1);
+   dn_write_uint16_t(&req->outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_RECHARGEPERIOD_1],rechargePeriod_1);
+   dn_write_uint16_t(&req->outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_CURRENTLIMIT_2],currentLimit_2);
+   dn_write_uint16_t(&req->outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_DISCHARGEPERIOD_2],dischargePeriod_2);
+   dn_write_uint16_t(&req->outputBuf[DN_SETPARAMETER_POWERSRCINFO_REQ_OFFS_RECHARGEPERIOD_2],rechargePeriod_2);
+   
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_SETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_SETPARAMETER_POWERSRCINFO_REQ_LEN,                     // length
       dn_ipmt_setParameter_powerSrcInfo_reply                   // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -955,16 +1024,18 @@ dn_err_t dn_ipmt_setParameter_powerSrcInfo(uint16_t maxStCurrent, uint8_t minLif
 
 void dn_ipmt_setParameter_powerSrcInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_setParameter_powerSrcInfo_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -974,7 +1045,7 @@ void dn_ipmt_setParameter_powerSrcInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t*
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_setParameter_powerSrcInfo_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_setParameter_powerSrcInfo_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -984,11 +1055,8 @@ void dn_ipmt_setParameter_powerSrcInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t*
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== setParameter_advKey
@@ -1002,13 +1070,15 @@ the mote to join. It can be reset to default via the clearNV command.
 */
 dn_err_t dn_ipmt_setParameter_advKey(uint8_t* advKey, dn_ipmt_setParameter_advKey_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -1017,31 +1087,27 @@ dn_err_t dn_ipmt_setParameter_advKey(uint8_t* advKey, dn_ipmt_setParameter_advKe
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_SETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_ADVKEY;
+   req->cmdId                 = CMDID_SETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_ADVKEY;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_ADVKEY;
-   memcpy(&dn_ipmt_vars.outputBuf[DN_SETPARAMETER_ADVKEY_REQ_OFFS_ADVKEY],advKey,16);
+   req->outputBuf[0] = PARAMID_ADVKEY;
+   memcpy(&req->outputBuf[DN_SETPARAMETER_ADVKEY_REQ_OFFS_ADVKEY],advKey,16);
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_SETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_SETPARAMETER_ADVKEY_REQ_LEN,                           // length
       dn_ipmt_setParameter_advKey_reply                         // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -1051,16 +1117,18 @@ dn_err_t dn_ipmt_setParameter_advKey(uint8_t* advKey, dn_ipmt_setParameter_advKe
 
 void dn_ipmt_setParameter_advKey_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_setParameter_advKey_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -1070,7 +1138,7 @@ void dn_ipmt_setParameter_advKey_reply(uint8_t cmdId, uint8_t rc, uint8_t* paylo
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_setParameter_advKey_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_setParameter_advKey_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -1080,11 +1148,8 @@ void dn_ipmt_setParameter_advKey_reply(uint8_t cmdId, uint8_t rc, uint8_t* paylo
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== setParameter_autoJoin
@@ -1101,13 +1166,15 @@ joining).
 */
 dn_err_t dn_ipmt_setParameter_autoJoin(bool mode, dn_ipmt_setParameter_autoJoin_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -1116,31 +1183,27 @@ dn_err_t dn_ipmt_setParameter_autoJoin(bool mode, dn_ipmt_setParameter_autoJoin_
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_SETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_AUTOJOIN;
+   req->cmdId                 = CMDID_SETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_AUTOJOIN;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_AUTOJOIN;
-   dn_ipmt_vars.outputBuf[DN_SETPARAMETER_AUTOJOIN_REQ_OFFS_MODE] = mode;
+   req->outputBuf[0] = PARAMID_AUTOJOIN;
+   req->outputBuf[DN_SETPARAMETER_AUTOJOIN_REQ_OFFS_MODE] = mode;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_SETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_SETPARAMETER_AUTOJOIN_REQ_LEN,                         // length
       dn_ipmt_setParameter_autoJoin_reply                       // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -1150,16 +1213,18 @@ dn_err_t dn_ipmt_setParameter_autoJoin(bool mode, dn_ipmt_setParameter_autoJoin_
 
 void dn_ipmt_setParameter_autoJoin_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_setParameter_autoJoin_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -1169,7 +1234,7 @@ void dn_ipmt_setParameter_autoJoin_reply(uint8_t cmdId, uint8_t rc, uint8_t* pay
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_setParameter_autoJoin_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_setParameter_autoJoin_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -1179,11 +1244,8 @@ void dn_ipmt_setParameter_autoJoin_reply(uint8_t cmdId, uint8_t rc, uint8_t* pay
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_macAddress
@@ -1195,13 +1257,15 @@ it may be overwritten using the setParameter<macAddress> command.
 */
 dn_err_t dn_ipmt_getParameter_macAddress(dn_ipmt_getParameter_macAddress_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -1210,30 +1274,26 @@ dn_err_t dn_ipmt_getParameter_macAddress(dn_ipmt_getParameter_macAddress_rpt* re
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_MACADDRESS;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_MACADDRESS;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_MACADDRESS;
+   req->outputBuf[0] = PARAMID_MACADDRESS;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_MACADDRESS_REQ_LEN,                       // length
       dn_ipmt_getParameter_macAddress_reply                     // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -1243,16 +1303,18 @@ dn_err_t dn_ipmt_getParameter_macAddress(dn_ipmt_getParameter_macAddress_rpt* re
 
 void dn_ipmt_getParameter_macAddress_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_macAddress_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -1262,7 +1324,7 @@ void dn_ipmt_getParameter_macAddress_reply(uint8_t cmdId, uint8_t rc, uint8_t* p
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_macAddress_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_macAddress_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -1273,11 +1335,8 @@ void dn_ipmt_getParameter_macAddress_reply(uint8_t cmdId, uint8_t rc, uint8_t* p
       memcpy(&reply->macAddress[0],&payload[DN_GETPARAMETER_MACADDRESS_REPLY_OFFS_MACADDRESS],8);
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_networkId
@@ -1287,13 +1346,15 @@ This command returns the network id stored in mote's persistent storage.
 */
 dn_err_t dn_ipmt_getParameter_networkId(dn_ipmt_getParameter_networkId_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -1302,30 +1363,26 @@ dn_err_t dn_ipmt_getParameter_networkId(dn_ipmt_getParameter_networkId_rpt* repl
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_NETWORKID;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_NETWORKID;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_NETWORKID;
+   req->outputBuf[0] = PARAMID_NETWORKID;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_NETWORKID_REQ_LEN,                        // length
       dn_ipmt_getParameter_networkId_reply                      // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -1335,16 +1392,18 @@ dn_err_t dn_ipmt_getParameter_networkId(dn_ipmt_getParameter_networkId_rpt* repl
 
 void dn_ipmt_getParameter_networkId_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_networkId_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -1354,7 +1413,7 @@ void dn_ipmt_getParameter_networkId_reply(uint8_t cmdId, uint8_t rc, uint8_t* pa
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_networkId_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_networkId_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -1365,11 +1424,8 @@ void dn_ipmt_getParameter_networkId_reply(uint8_t cmdId, uint8_t rc, uint8_t* pa
       dn_read_uint16_t(&reply->networkId,&payload[DN_GETPARAMETER_NETWORKID_REPLY_OFFS_NETWORKID]);
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_txPower
@@ -1379,13 +1435,15 @@ Get the radio output power in dBm, excluding any antenna gain.
 */
 dn_err_t dn_ipmt_getParameter_txPower(dn_ipmt_getParameter_txPower_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -1394,30 +1452,26 @@ dn_err_t dn_ipmt_getParameter_txPower(dn_ipmt_getParameter_txPower_rpt* reply) {
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_TXPOWER;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_TXPOWER;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_TXPOWER;
+   req->outputBuf[0] = PARAMID_TXPOWER;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_TXPOWER_REQ_LEN,                          // length
       dn_ipmt_getParameter_txPower_reply                        // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -1427,16 +1481,18 @@ dn_err_t dn_ipmt_getParameter_txPower(dn_ipmt_getParameter_txPower_rpt* reply) {
 
 void dn_ipmt_getParameter_txPower_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_txPower_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -1446,7 +1502,7 @@ void dn_ipmt_getParameter_txPower_reply(uint8_t cmdId, uint8_t rc, uint8_t* payl
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_txPower_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_txPower_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -1457,11 +1513,8 @@ void dn_ipmt_getParameter_txPower_reply(uint8_t cmdId, uint8_t rc, uint8_t* payl
       reply->txPower = (int8_t)payload[DN_GETPARAMETER_TXPOWER_REPLY_OFFS_TXPOWER];
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_joinDutyCycle
@@ -1471,13 +1524,15 @@ This command allows user to retrieve current value of joinDutyCycle parameter.
 */
 dn_err_t dn_ipmt_getParameter_joinDutyCycle(dn_ipmt_getParameter_joinDutyCycle_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -1486,30 +1541,26 @@ dn_err_t dn_ipmt_getParameter_joinDutyCycle(dn_ipmt_getParameter_joinDutyCycle_r
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_JOINDUTYCYCLE;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_JOINDUTYCYCLE;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_JOINDUTYCYCLE;
+   req->outputBuf[0] = PARAMID_JOINDUTYCYCLE;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_JOINDUTYCYCLE_REQ_LEN,                    // length
       dn_ipmt_getParameter_joinDutyCycle_reply                  // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -1519,16 +1570,18 @@ dn_err_t dn_ipmt_getParameter_joinDutyCycle(dn_ipmt_getParameter_joinDutyCycle_r
 
 void dn_ipmt_getParameter_joinDutyCycle_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_joinDutyCycle_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -1538,7 +1591,7 @@ void dn_ipmt_getParameter_joinDutyCycle_reply(uint8_t cmdId, uint8_t rc, uint8_t
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_joinDutyCycle_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_joinDutyCycle_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -1549,11 +1602,8 @@ void dn_ipmt_getParameter_joinDutyCycle_reply(uint8_t cmdId, uint8_t rc, uint8_t
       reply->joinDutyCycle = payload[DN_GETPARAMETER_JOINDUTYCYCLE_REPLY_OFFS_JOINDUTYCYCLE];
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_eventMask
@@ -1564,13 +1614,15 @@ subscribed-to event types.
 */
 dn_err_t dn_ipmt_getParameter_eventMask(dn_ipmt_getParameter_eventMask_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -1579,30 +1631,26 @@ dn_err_t dn_ipmt_getParameter_eventMask(dn_ipmt_getParameter_eventMask_rpt* repl
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_EVENTMASK;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_EVENTMASK;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_EVENTMASK;
+   req->outputBuf[0] = PARAMID_EVENTMASK;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_EVENTMASK_REQ_LEN,                        // length
       dn_ipmt_getParameter_eventMask_reply                      // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -1612,16 +1660,18 @@ dn_err_t dn_ipmt_getParameter_eventMask(dn_ipmt_getParameter_eventMask_rpt* repl
 
 void dn_ipmt_getParameter_eventMask_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_eventMask_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -1631,7 +1681,7 @@ void dn_ipmt_getParameter_eventMask_reply(uint8_t cmdId, uint8_t rc, uint8_t* pa
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_eventMask_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_eventMask_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -1642,11 +1692,8 @@ void dn_ipmt_getParameter_eventMask_reply(uint8_t cmdId, uint8_t rc, uint8_t* pa
       dn_read_uint32_t(&reply->eventMask,&payload[DN_GETPARAMETER_EVENTMASK_REPLY_OFFS_EVENTMASK]);
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_moteInfo
@@ -1657,13 +1704,15 @@ moteshardware and network stack software.
 */
 dn_err_t dn_ipmt_getParameter_moteInfo(dn_ipmt_getParameter_moteInfo_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -1672,30 +1721,26 @@ dn_err_t dn_ipmt_getParameter_moteInfo(dn_ipmt_getParameter_moteInfo_rpt* reply)
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_MOTEINFO;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_MOTEINFO;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_MOTEINFO;
+   req->outputBuf[0] = PARAMID_MOTEINFO;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_MOTEINFO_REQ_LEN,                         // length
       dn_ipmt_getParameter_moteInfo_reply                       // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -1705,16 +1750,18 @@ dn_err_t dn_ipmt_getParameter_moteInfo(dn_ipmt_getParameter_moteInfo_rpt* reply)
 
 void dn_ipmt_getParameter_moteInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_moteInfo_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -1724,7 +1771,7 @@ void dn_ipmt_getParameter_moteInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* pay
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_moteInfo_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_moteInfo_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -1743,11 +1790,8 @@ void dn_ipmt_getParameter_moteInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* pay
       reply->bootSwVer = payload[DN_GETPARAMETER_MOTEINFO_REPLY_OFFS_BOOTSWVER];
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_netInfo
@@ -1758,13 +1802,15 @@ network-related parameters.
 */
 dn_err_t dn_ipmt_getParameter_netInfo(dn_ipmt_getParameter_netInfo_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -1773,30 +1819,26 @@ dn_err_t dn_ipmt_getParameter_netInfo(dn_ipmt_getParameter_netInfo_rpt* reply) {
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_NETINFO;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_NETINFO;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_NETINFO;
+   req->outputBuf[0] = PARAMID_NETINFO;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_NETINFO_REQ_LEN,                          // length
       dn_ipmt_getParameter_netInfo_reply                        // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -1806,16 +1848,18 @@ dn_err_t dn_ipmt_getParameter_netInfo(dn_ipmt_getParameter_netInfo_rpt* reply) {
 
 void dn_ipmt_getParameter_netInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_netInfo_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -1825,7 +1869,7 @@ void dn_ipmt_getParameter_netInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payl
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_netInfo_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_netInfo_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -1839,11 +1883,8 @@ void dn_ipmt_getParameter_netInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payl
       dn_read_uint16_t(&reply->slotSize,&payload[DN_GETPARAMETER_NETINFO_REPLY_OFFS_SLOTSIZE]);
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_moteStatus
@@ -1854,13 +1895,15 @@ andother dynamic information.
 */
 dn_err_t dn_ipmt_getParameter_moteStatus(dn_ipmt_getParameter_moteStatus_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -1869,30 +1912,26 @@ dn_err_t dn_ipmt_getParameter_moteStatus(dn_ipmt_getParameter_moteStatus_rpt* re
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_MOTESTATUS;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_MOTESTATUS;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_MOTESTATUS;
+   req->outputBuf[0] = PARAMID_MOTESTATUS;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_MOTESTATUS_REQ_LEN,                       // length
       dn_ipmt_getParameter_moteStatus_reply                     // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -1902,16 +1941,18 @@ dn_err_t dn_ipmt_getParameter_moteStatus(dn_ipmt_getParameter_moteStatus_rpt* re
 
 void dn_ipmt_getParameter_moteStatus_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_moteStatus_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -1921,7 +1962,7 @@ void dn_ipmt_getParameter_moteStatus_reply(uint8_t cmdId, uint8_t rc, uint8_t* p
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_moteStatus_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_moteStatus_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -1937,11 +1978,8 @@ void dn_ipmt_getParameter_moteStatus_reply(uint8_t cmdId, uint8_t rc, uint8_t* p
       reply->reserved_2 = payload[DN_GETPARAMETER_MOTESTATUS_REPLY_OFFS_RESERVED_2];
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_time
@@ -1954,13 +1992,15 @@ using TIMEn pin (see timeIndication).
 */
 dn_err_t dn_ipmt_getParameter_time(dn_ipmt_getParameter_time_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -1969,30 +2009,26 @@ dn_err_t dn_ipmt_getParameter_time(dn_ipmt_getParameter_time_rpt* reply) {
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_TIME;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_TIME;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_TIME;
+   req->outputBuf[0] = PARAMID_TIME;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_TIME_REQ_LEN,                             // length
       dn_ipmt_getParameter_time_reply                           // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -2002,16 +2038,18 @@ dn_err_t dn_ipmt_getParameter_time(dn_ipmt_getParameter_time_rpt* reply) {
 
 void dn_ipmt_getParameter_time_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_time_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -2021,7 +2059,7 @@ void dn_ipmt_getParameter_time_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_time_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_time_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -2036,11 +2074,8 @@ void dn_ipmt_getParameter_time_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload
       dn_read_uint16_t(&reply->asnOffset,&payload[DN_GETPARAMETER_TIME_REPLY_OFFS_ASNOFFSET]);
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_charge
@@ -2051,13 +2086,15 @@ motesince the last reset.
 */
 dn_err_t dn_ipmt_getParameter_charge(dn_ipmt_getParameter_charge_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -2066,30 +2103,26 @@ dn_err_t dn_ipmt_getParameter_charge(dn_ipmt_getParameter_charge_rpt* reply) {
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_CHARGE;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_CHARGE;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_CHARGE;
+   req->outputBuf[0] = PARAMID_CHARGE;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_CHARGE_REQ_LEN,                           // length
       dn_ipmt_getParameter_charge_reply                         // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -2099,16 +2132,18 @@ dn_err_t dn_ipmt_getParameter_charge(dn_ipmt_getParameter_charge_rpt* reply) {
 
 void dn_ipmt_getParameter_charge_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_charge_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -2118,7 +2153,7 @@ void dn_ipmt_getParameter_charge_reply(uint8_t cmdId, uint8_t rc, uint8_t* paylo
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_charge_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_charge_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -2132,11 +2167,8 @@ void dn_ipmt_getParameter_charge_reply(uint8_t cmdId, uint8_t rc, uint8_t* paylo
       reply->tempFrac = payload[DN_GETPARAMETER_CHARGE_REPLY_OFFS_TEMPFRAC];
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_testRadioRxStats
@@ -2148,13 +2180,15 @@ number of good and bad packets (CRC failures) received during the test
 */
 dn_err_t dn_ipmt_getParameter_testRadioRxStats(dn_ipmt_getParameter_testRadioRxStats_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -2163,30 +2197,26 @@ dn_err_t dn_ipmt_getParameter_testRadioRxStats(dn_ipmt_getParameter_testRadioRxS
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_TESTRADIORXSTATS;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_TESTRADIORXSTATS;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_TESTRADIORXSTATS;
+   req->outputBuf[0] = PARAMID_TESTRADIORXSTATS;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_TESTRADIORXSTATS_REQ_LEN,                 // length
       dn_ipmt_getParameter_testRadioRxStats_reply               // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -2196,16 +2226,18 @@ dn_err_t dn_ipmt_getParameter_testRadioRxStats(dn_ipmt_getParameter_testRadioRxS
 
 void dn_ipmt_getParameter_testRadioRxStats_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_testRadioRxStats_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -2215,7 +2247,7 @@ void dn_ipmt_getParameter_testRadioRxStats_reply(uint8_t cmdId, uint8_t rc, uint
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_testRadioRxStats_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_testRadioRxStats_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -2227,11 +2259,8 @@ void dn_ipmt_getParameter_testRadioRxStats_reply(uint8_t cmdId, uint8_t rc, uint
       dn_read_uint16_t(&reply->rxFailed,&payload[DN_GETPARAMETER_TESTRADIORXSTATS_REPLY_OFFS_RXFAILED]);
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_OTAPLockout
@@ -2242,13 +2271,15 @@ upgrades of software are permitted on this mote.
 */
 dn_err_t dn_ipmt_getParameter_OTAPLockout(dn_ipmt_getParameter_OTAPLockout_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -2257,30 +2288,26 @@ dn_err_t dn_ipmt_getParameter_OTAPLockout(dn_ipmt_getParameter_OTAPLockout_rpt*
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_OTAPLOCKOUT;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_OTAPLOCKOUT;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_OTAPLOCKOUT;
+   req->outputBuf[0] = PARAMID_OTAPLOCKOUT;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_OTAPLOCKOUT_REQ_LEN,                      // length
       dn_ipmt_getParameter_OTAPLockout_reply                    // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -2290,16 +2317,18 @@ dn_err_t dn_ipmt_getParameter_OTAPLockout(dn_ipmt_getParameter_OTAPLockout_rpt*
 
 void dn_ipmt_getParameter_OTAPLockout_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_OTAPLockout_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -2309,7 +2338,7 @@ void dn_ipmt_getParameter_OTAPLockout_reply(uint8_t cmdId, uint8_t rc, uint8_t*
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_OTAPLockout_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_OTAPLockout_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -2320,11 +2349,8 @@ void dn_ipmt_getParameter_OTAPLockout_reply(uint8_t cmdId, uint8_t rc, uint8_t*
       reply->mode = payload[DN_GETPARAMETER_OTAPLOCKOUT_REPLY_OFFS_MODE];
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_moteId
@@ -2335,13 +2361,15 @@ value of 0 is returned.
 */
 dn_err_t dn_ipmt_getParameter_moteId(dn_ipmt_getParameter_moteId_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -2350,30 +2378,26 @@ dn_err_t dn_ipmt_getParameter_moteId(dn_ipmt_getParameter_moteId_rpt* reply) {
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_MOTEID;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_MOTEID;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_MOTEID;
+   req->outputBuf[0] = PARAMID_MOTEID;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_MOTEID_REQ_LEN,                           // length
       dn_ipmt_getParameter_moteId_reply                         // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -2383,16 +2407,18 @@ dn_err_t dn_ipmt_getParameter_moteId(dn_ipmt_getParameter_moteId_rpt* reply) {
 
 void dn_ipmt_getParameter_moteId_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_moteId_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -2402,7 +2428,7 @@ void dn_ipmt_getParameter_moteId_reply(uint8_t cmdId, uint8_t rc, uint8_t* paylo
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_moteId_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_moteId_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -2413,11 +2439,8 @@ void dn_ipmt_getParameter_moteId_reply(uint8_t cmdId, uint8_t rc, uint8_t* paylo
       dn_read_uint16_t(&reply->moteId,&payload[DN_GETPARAMETER_MOTEID_REPLY_OFFS_MOTEID]);
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_ipv6Address
@@ -2428,13 +2451,15 @@ mote. Before the mote has an assigned address it will return all 0s.
 */
 dn_err_t dn_ipmt_getParameter_ipv6Address(dn_ipmt_getParameter_ipv6Address_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -2443,30 +2468,26 @@ dn_err_t dn_ipmt_getParameter_ipv6Address(dn_ipmt_getParameter_ipv6Address_rpt*
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_IPV6ADDRESS;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_IPV6ADDRESS;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_IPV6ADDRESS;
+   req->outputBuf[0] = PARAMID_IPV6ADDRESS;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_IPV6ADDRESS_REQ_LEN,                      // length
       dn_ipmt_getParameter_ipv6Address_reply                    // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -2476,16 +2497,18 @@ dn_err_t dn_ipmt_getParameter_ipv6Address(dn_ipmt_getParameter_ipv6Address_rpt*
 
 void dn_ipmt_getParameter_ipv6Address_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_ipv6Address_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -2495,7 +2518,7 @@ void dn_ipmt_getParameter_ipv6Address_reply(uint8_t cmdId, uint8_t rc, uint8_t*
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_ipv6Address_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_ipv6Address_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -2506,11 +2529,8 @@ void dn_ipmt_getParameter_ipv6Address_reply(uint8_t cmdId, uint8_t rc, uint8_t*
       memcpy(&reply->ipv6Address[0],&payload[DN_GETPARAMETER_IPV6ADDRESS_REPLY_OFFS_IPV6ADDRESS],16);
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_routingMode
@@ -2521,13 +2541,15 @@ the mote.
 */
 dn_err_t dn_ipmt_getParameter_routingMode(dn_ipmt_getParameter_routingMode_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -2536,30 +2558,26 @@ dn_err_t dn_ipmt_getParameter_routingMode(dn_ipmt_getParameter_routingMode_rpt*
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_ROUTINGMODE;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_ROUTINGMODE;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_ROUTINGMODE;
+   req->outputBuf[0] = PARAMID_ROUTINGMODE;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_ROUTINGMODE_REQ_LEN,                      // length
       dn_ipmt_getParameter_routingMode_reply                    // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -2569,16 +2587,18 @@ dn_err_t dn_ipmt_getParameter_routingMode(dn_ipmt_getParameter_routingMode_rpt*
 
 void dn_ipmt_getParameter_routingMode_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_routingMode_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -2588,7 +2608,7 @@ void dn_ipmt_getParameter_routingMode_reply(uint8_t cmdId, uint8_t rc, uint8_t*
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_routingMode_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_routingMode_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -2599,11 +2619,8 @@ void dn_ipmt_getParameter_routingMode_reply(uint8_t cmdId, uint8_t rc, uint8_t*
       reply->routingMode = payload[DN_GETPARAMETER_ROUTINGMODE_REPLY_OFFS_ROUTINGMODE];
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_appInfo
@@ -2613,13 +2630,15 @@ Get the application (as opposed to the network stack) version information.
 */
 dn_err_t dn_ipmt_getParameter_appInfo(dn_ipmt_getParameter_appInfo_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -2628,30 +2647,26 @@ dn_err_t dn_ipmt_getParameter_appInfo(dn_ipmt_getParameter_appInfo_rpt* reply) {
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_APPINFO;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_APPINFO;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_APPINFO;
+   req->outputBuf[0] = PARAMID_APPINFO;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_APPINFO_REQ_LEN,                          // length
       dn_ipmt_getParameter_appInfo_reply                        // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -2661,16 +2676,18 @@ dn_err_t dn_ipmt_getParameter_appInfo(dn_ipmt_getParameter_appInfo_rpt* reply) {
 
 void dn_ipmt_getParameter_appInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_appInfo_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -2680,7 +2697,7 @@ void dn_ipmt_getParameter_appInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payl
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_appInfo_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_appInfo_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -2693,11 +2710,8 @@ void dn_ipmt_getParameter_appInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payl
       memcpy(&reply->appVer[0],&payload[DN_GETPARAMETER_APPINFO_REPLY_OFFS_APPVER],5);
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_powerSrcInfo
@@ -2707,13 +2721,15 @@ This command allows the microprocessor to read a mote's power source settings.
 */
 dn_err_t dn_ipmt_getParameter_powerSrcInfo(dn_ipmt_getParameter_powerSrcInfo_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -2722,30 +2738,26 @@ dn_err_t dn_ipmt_getParameter_powerSrcInfo(dn_ipmt_getParameter_powerSrcInfo_rpt
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_POWERSRCINFO;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_POWERSRCINFO;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_POWERSRCINFO;
+   req->outputBuf[0] = PARAMID_POWERSRCINFO;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_POWERSRCINFO_REQ_LEN,                     // length
       dn_ipmt_getParameter_powerSrcInfo_reply                   // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -2755,16 +2767,18 @@ dn_err_t dn_ipmt_getParameter_powerSrcInfo(dn_ipmt_getParameter_powerSrcInfo_rpt
 
 void dn_ipmt_getParameter_powerSrcInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_powerSrcInfo_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -2774,7 +2788,7 @@ void dn_ipmt_getParameter_powerSrcInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t*
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_powerSrcInfo_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_powerSrcInfo_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -2795,11 +2809,8 @@ void dn_ipmt_getParameter_powerSrcInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t*
       dn_read_uint16_t(&reply->rechargePeriod_2,&payload[DN_GETPARAMETER_POWERSRCINFO_REPLY_OFFS_RECHARGEPERIOD_2]);
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getParameter_autoJoin
@@ -2810,13 +2821,15 @@ setting.
 */
 dn_err_t dn_ipmt_getParameter_autoJoin(dn_ipmt_getParameter_autoJoin_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -2825,30 +2838,26 @@ dn_err_t dn_ipmt_getParameter_autoJoin(dn_ipmt_getParameter_autoJoin_rpt* reply)
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETPARAMETER;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
-   dn_ipmt_vars.paramId        = PARAMID_AUTOJOIN;
+   req->cmdId                 = CMDID_GETPARAMETER;
+   req->replyContents         = (uint8_t*)reply;
+   req->paramId               = PARAMID_AUTOJOIN;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[0] = PARAMID_AUTOJOIN;
+   req->outputBuf[0] = PARAMID_AUTOJOIN;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETPARAMETER,                                       // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETPARAMETER_AUTOJOIN_REQ_LEN,                         // length
       dn_ipmt_getParameter_autoJoin_reply                       // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -2858,16 +2867,18 @@ dn_err_t dn_ipmt_getParameter_autoJoin(dn_ipmt_getParameter_autoJoin_rpt* reply)
 
 void dn_ipmt_getParameter_autoJoin_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getParameter_autoJoin_rpt* reply;
+   dn_ipmt_req_t* req;
    uint8_t paramId;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // verify I'm expecting this paramId
    paramId = payload[0];
-   if (paramId!=dn_ipmt_vars.paramId) {
+   if (paramId!=req->paramId) {
       return;
    }
    
@@ -2877,7 +2888,7 @@ void dn_ipmt_getParameter_autoJoin_reply(uint8_t cmdId, uint8_t rc, uint8_t* pay
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getParameter_autoJoin_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getParameter_autoJoin_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -2888,11 +2899,8 @@ void dn_ipmt_getParameter_autoJoin_reply(uint8_t cmdId, uint8_t rc, uint8_t* pay
       reply->autoJoin = payload[DN_GETPARAMETER_AUTOJOIN_REPLY_OFFS_AUTOJOIN];
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== join
@@ -2905,13 +2913,15 @@ by the maximum current setting.
 */
 dn_err_t dn_ipmt_join(dn_ipmt_join_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -2920,28 +2930,24 @@ dn_err_t dn_ipmt_join(dn_ipmt_join_rpt* reply) {
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_JOIN;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
+   req->cmdId                 = CMDID_JOIN;
+   req->replyContents         = (uint8_t*)reply;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_JOIN,                                               // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_JOIN_REQ_LEN,                                          // length
       dn_ipmt_join_reply                                        // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -2951,16 +2957,18 @@ dn_err_t dn_ipmt_join(dn_ipmt_join_rpt* reply) {
 
 void dn_ipmt_join_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_join_rpt* reply;
+   dn_ipmt_req_t* req;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // do NOT verify length (no return fields expected)
    
    // cast the replyContent
-   reply = (dn_ipmt_join_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_join_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -2970,11 +2978,8 @@ void dn_ipmt_join_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== disconnect
@@ -2988,13 +2993,15 @@ any time.
 */
 dn_err_t dn_ipmt_disconnect(dn_ipmt_disconnect_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -3003,28 +3010,24 @@ dn_err_t dn_ipmt_disconnect(dn_ipmt_disconnect_rpt* reply) {
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_DISCONNECT;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
+   req->cmdId                 = CMDID_DISCONNECT;
+   req->replyContents         = (uint8_t*)reply;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_DISCONNECT,                                         // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_DISCONNECT_REQ_LEN,                                    // length
       dn_ipmt_disconnect_reply                                  // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -3034,16 +3037,18 @@ dn_err_t dn_ipmt_disconnect(dn_ipmt_disconnect_rpt* reply) {
 
 void dn_ipmt_disconnect_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_disconnect_rpt* reply;
+   dn_ipmt_req_t* req;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // do NOT verify length (no return fields expected)
    
    // cast the replyContent
-   reply = (dn_ipmt_disconnect_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_disconnect_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -3053,11 +3058,8 @@ void dn_ipmt_disconnect_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== reset
@@ -3070,13 +3072,15 @@ disconnect gracefully from the network, use the disconnect command
 */
 dn_err_t dn_ipmt_reset(dn_ipmt_reset_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -3085,28 +3089,24 @@ dn_err_t dn_ipmt_reset(dn_ipmt_reset_rpt* reply) {
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_RESET;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
+   req->cmdId                 = CMDID_RESET;
+   req->replyContents         = (uint8_t*)reply;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_RESET,                                              // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_RESET_REQ_LEN,                                         // length
       dn_ipmt_reset_reply                                       // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -3116,16 +3116,18 @@ dn_err_t dn_ipmt_reset(dn_ipmt_reset_rpt* reply) {
 
 void dn_ipmt_reset_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_reset_rpt* reply;
+   dn_ipmt_req_t* req;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // do NOT verify length (no return fields expected)
    
    // cast the replyContent
-   reply = (dn_ipmt_reset_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_reset_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -3135,11 +3137,8 @@ void dn_ipmt_reset_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t le
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== lowPowerSleep
@@ -3155,13 +3154,15 @@ required to bring a mote out of deep sleep mode.
 */
 dn_err_t dn_ipmt_lowPowerSleep(dn_ipmt_lowPowerSleep_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -3170,28 +3171,24 @@ dn_err_t dn_ipmt_lowPowerSleep(dn_ipmt_lowPowerSleep_rpt* reply) {
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_LOWPOWERSLEEP;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
+   req->cmdId                 = CMDID_LOWPOWERSLEEP;
+   req->replyContents         = (uint8_t*)reply;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_LOWPOWERSLEEP,                                      // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_LOWPOWERSLEEP_REQ_LEN,                                 // length
       dn_ipmt_lowPowerSleep_reply                               // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -3201,16 +3198,18 @@ dn_err_t dn_ipmt_lowPowerSleep(dn_ipmt_lowPowerSleep_rpt* reply) {
 
 void dn_ipmt_lowPowerSleep_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_lowPowerSleep_rpt* reply;
+   dn_ipmt_req_t* req;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // do NOT verify length (no return fields expected)
    
    // cast the replyContent
-   reply = (dn_ipmt_lowPowerSleep_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_lowPowerSleep_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -3220,11 +3219,8 @@ void dn_ipmt_lowPowerSleep_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, ui
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== testRadioRx
@@ -3249,13 +3245,15 @@ Channel numbering is 0-15, corresponding to IEEE 2.4 GHz channels 11-26.
 */
 dn_err_t dn_ipmt_testRadioRx(uint16_t channelMask, uint16_t time, uint8_t stationId, dn_ipmt_testRadioRx_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -3264,31 +3262,27 @@ dn_err_t dn_ipmt_testRadioRx(uint16_t channelMask, uint16_t time, uint8_t statio
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_TESTRADIORX;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
+   req->cmdId                 = CMDID_TESTRADIORX;
+   req->replyContents         = (uint8_t*)reply;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_TESTRADIORX_REQ_OFFS_CHANNELMASK],channelMask);
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_TESTRADIORX_REQ_OFFS_TIME],time);
-   dn_ipmt_vars.outputBuf[DN_TESTRADIORX_REQ_OFFS_STATIONID] = stationId;
+   dn_write_uint16_t(&req->outputBuf[DN_TESTRADIORX_REQ_OFFS_CHANNELMASK],channelMask);
+   dn_write_uint16_t(&req->outputBuf[DN_TESTRADIORX_REQ_OFFS_TIME],time);
+   req->outputBuf[DN_TESTRADIORX_REQ_OFFS_STATIONID] = stationId;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_TESTRADIORX,                                        // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_TESTRADIORX_REQ_LEN,                                   // length
       dn_ipmt_testRadioRx_reply                                 // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -3298,16 +3292,18 @@ dn_err_t dn_ipmt_testRadioRx(uint16_t channelMask, uint16_t time, uint8_t statio
 
 void dn_ipmt_testRadioRx_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_testRadioRx_rpt* reply;
+   dn_ipmt_req_t* req;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // do NOT verify length (no return fields expected)
    
    // cast the replyContent
-   reply = (dn_ipmt_testRadioRx_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_testRadioRx_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -3317,11 +3313,8 @@ void dn_ipmt_testRadioRx_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== clearNV
@@ -3334,13 +3327,15 @@ this command should be followed up by mote reset.
 */
 dn_err_t dn_ipmt_clearNV(dn_ipmt_clearNV_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -3349,28 +3344,24 @@ dn_err_t dn_ipmt_clearNV(dn_ipmt_clearNV_rpt* reply) {
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_CLEARNV;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
+   req->cmdId                 = CMDID_CLEARNV;
+   req->replyContents         = (uint8_t*)reply;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_CLEARNV,                                            // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_CLEARNV_REQ_LEN,                                       // length
       dn_ipmt_clearNV_reply                                     // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -3380,16 +3371,18 @@ dn_err_t dn_ipmt_clearNV(dn_ipmt_clearNV_rpt* reply) {
 
 void dn_ipmt_clearNV_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_clearNV_rpt* reply;
+   dn_ipmt_req_t* req;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // do NOT verify length (no return fields expected)
    
    // cast the replyContent
-   reply = (dn_ipmt_clearNV_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_clearNV_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -3399,11 +3392,8 @@ void dn_ipmt_clearNV_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== requestService
@@ -3419,13 +3409,15 @@ allocation.
 */
 dn_err_t dn_ipmt_requestService(uint16_t destAddr, uint8_t serviceType, uint32_t value, dn_ipmt_requestService_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -3434,31 +3426,27 @@ dn_err_t dn_ipmt_requestService(uint16_t destAddr, uint8_t serviceType, uint32_t
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_REQUESTSERVICE;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
+   req->cmdId                 = CMDID_REQUESTSERVICE;
+   req->replyContents         = (uint8_t*)reply;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_REQUESTSERVICE_REQ_OFFS_DESTADDR],destAddr);
-   dn_ipmt_vars.outputBuf[DN_REQUESTSERVICE_REQ_OFFS_SERVICETYPE] = serviceType;
-   dn_write_uint32_t(&dn_ipmt_vars.outputBuf[DN_REQUESTSERVICE_REQ_OFFS_VALUE],value);
+   dn_write_uint16_t(&req->outputBuf[DN_REQUESTSERVICE_REQ_OFFS_DESTADDR],destAddr);
+   req->outputBuf[DN_REQUESTSERVICE_REQ_OFFS_SERVICETYPE] = serviceType;
+   dn_write_uint32_t(&req->outputBuf[DN_REQUESTSERVICE_REQ_OFFS_VALUE],value);
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_REQUESTSERVICE,                                     // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_REQUESTSERVICE_REQ_LEN,                                // length
       dn_ipmt_requestService_reply                              // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -3468,16 +3456,18 @@ dn_err_t dn_ipmt_requestService(uint16_t destAddr, uint8_t serviceType, uint32_t
 
 void dn_ipmt_requestService_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_requestService_rpt* reply;
+   dn_ipmt_req_t* req;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // do NOT verify length (no return fields expected)
    
    // cast the replyContent
-   reply = (dn_ipmt_requestService_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_requestService_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -3487,11 +3477,8 @@ void dn_ipmt_requestService_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, u
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== getServiceInfo
@@ -3502,13 +3489,15 @@ allocated to the mote.
 */
 dn_err_t dn_ipmt_getServiceInfo(uint16_t destAddr, uint8_t type, dn_ipmt_getServiceInfo_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -3517,30 +3506,26 @@ dn_err_t dn_ipmt_getServiceInfo(uint16_t destAddr, uint8_t type, dn_ipmt_getServ
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_GETSERVICEINFO;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
+   req->cmdId                 = CMDID_GETSERVICEINFO;
+   req->replyContents         = (uint8_t*)reply;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_GETSERVICEINFO_REQ_OFFS_DESTADDR],destAddr);
-   dn_ipmt_vars.outputBuf[DN_GETSERVICEINFO_REQ_OFFS_TYPE] = type;
+   dn_write_uint16_t(&req->outputBuf[DN_GETSERVICEINFO_REQ_OFFS_DESTADDR],destAddr);
+   req->outputBuf[DN_GETSERVICEINFO_REQ_OFFS_TYPE] = type;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_GETSERVICEINFO,                                     // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_GETSERVICEINFO_REQ_LEN,                                // length
       dn_ipmt_getServiceInfo_reply                              // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -3550,9 +3535,11 @@ dn_err_t dn_ipmt_getServiceInfo(uint16_t destAddr, uint8_t type, dn_ipmt_getServ
 
 void dn_ipmt_getServiceInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_getServiceInfo_rpt* reply;
+   dn_ipmt_req_t* req;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
@@ -3562,7 +3549,7 @@ void dn_ipmt_getServiceInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, u
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_getServiceInfo_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_getServiceInfo_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -3576,11 +3563,8 @@ void dn_ipmt_getServiceInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, u
       dn_read_uint32_t(&reply->value,&payload[DN_GETSERVICEINFO_REPLY_OFFS_VALUE]);
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== openSocket
@@ -3591,13 +3575,15 @@ ID for the socket.
 */
 dn_err_t dn_ipmt_openSocket(uint8_t protocol, dn_ipmt_openSocket_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -3606,29 +3592,25 @@ dn_err_t dn_ipmt_openSocket(uint8_t protocol, dn_ipmt_openSocket_rpt* reply) {
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_OPENSOCKET;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
+   req->cmdId                 = CMDID_OPENSOCKET;
+   req->replyContents         = (uint8_t*)reply;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[DN_OPENSOCKET_REQ_OFFS_PROTOCOL] = protocol;
+   req->outputBuf[DN_OPENSOCKET_REQ_OFFS_PROTOCOL] = protocol;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_OPENSOCKET,                                         // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_OPENSOCKET_REQ_LEN,                                    // length
       dn_ipmt_openSocket_reply                                  // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -3638,9 +3620,11 @@ dn_err_t dn_ipmt_openSocket(uint8_t protocol, dn_ipmt_openSocket_rpt* reply) {
 
 void dn_ipmt_openSocket_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_openSocket_rpt* reply;
+   dn_ipmt_req_t* req;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
@@ -3650,7 +3634,7 @@ void dn_ipmt_openSocket_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_openSocket_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_openSocket_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -3661,11 +3645,8 @@ void dn_ipmt_openSocket_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8
       reply->socketId = payload[DN_OPENSOCKET_REPLY_OFFS_SOCKETID];
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== closeSocket
@@ -3675,13 +3656,15 @@ Close the previously open socket.
 */
 dn_err_t dn_ipmt_closeSocket(uint8_t socketId, dn_ipmt_closeSocket_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -3690,29 +3673,25 @@ dn_err_t dn_ipmt_closeSocket(uint8_t socketId, dn_ipmt_closeSocket_rpt* reply) {
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_CLOSESOCKET;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
+   req->cmdId                 = CMDID_CLOSESOCKET;
+   req->replyContents         = (uint8_t*)reply;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[DN_CLOSESOCKET_REQ_OFFS_SOCKETID] = socketId;
+   req->outputBuf[DN_CLOSESOCKET_REQ_OFFS_SOCKETID] = socketId;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_CLOSESOCKET,                                        // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_CLOSESOCKET_REQ_LEN,                                   // length
       dn_ipmt_closeSocket_reply                                 // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -3722,16 +3701,18 @@ dn_err_t dn_ipmt_closeSocket(uint8_t socketId, dn_ipmt_closeSocket_rpt* reply) {
 
 void dn_ipmt_closeSocket_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_closeSocket_rpt* reply;
+   dn_ipmt_req_t* req;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // do NOT verify length (no return fields expected)
    
    // cast the replyContent
-   reply = (dn_ipmt_closeSocket_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_closeSocket_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -3741,11 +3722,8 @@ void dn_ipmt_closeSocket_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== bindSocket
@@ -3757,13 +3735,15 @@ performed before the socket can accept connections from other hosts.
 */
 dn_err_t dn_ipmt_bindSocket(uint8_t socketId, uint16_t port, dn_ipmt_bindSocket_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -3772,30 +3752,26 @@ dn_err_t dn_ipmt_bindSocket(uint8_t socketId, uint16_t port, dn_ipmt_bindSocket_
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_BINDSOCKET;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
+   req->cmdId                 = CMDID_BINDSOCKET;
+   req->replyContents         = (uint8_t*)reply;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[DN_BINDSOCKET_REQ_OFFS_SOCKETID] = socketId;
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_BINDSOCKET_REQ_OFFS_PORT],port);
+   req->outputBuf[DN_BINDSOCKET_REQ_OFFS_SOCKETID] = socketId;
+   dn_write_uint16_t(&req->outputBuf[DN_BINDSOCKET_REQ_OFFS_PORT],port);
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_BINDSOCKET,                                         // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_BINDSOCKET_REQ_LEN,                                    // length
       dn_ipmt_bindSocket_reply                                  // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -3805,16 +3781,18 @@ dn_err_t dn_ipmt_bindSocket(uint8_t socketId, uint16_t port, dn_ipmt_bindSocket_
 
 void dn_ipmt_bindSocket_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_bindSocket_rpt* reply;
+   dn_ipmt_req_t* req;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // do NOT verify length (no return fields expected)
    
    // cast the replyContent
-   reply = (dn_ipmt_bindSocket_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_bindSocket_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -3824,11 +3802,8 @@ void dn_ipmt_bindSocket_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== sendTo
@@ -3844,14 +3819,35 @@ destination port should be in the range 0xF0B8-F0BF (61624-61631) to maximize
 payload. 
 */
 dn_err_t dn_ipmt_sendTo(uint8_t socketId, uint8_t* destIP, uint16_t destPort, uint8_t serviceType, uint8_t priority, uint16_t packetId, uint8_t* payload, uint8_t payloadLen, dn_ipmt_sendTo_rpt* reply) {
+   dn_serial_seg_t seg;
+   
+   seg.data = payload;
+   seg.len  = payloadLen;
+   
+   return dn_ipmt_sendToSegs(socketId,destIP,destPort,serviceType,priority,packetId,&seg,1,reply);
+}
+
+/**
+\brief sendTo with the payload in several parts, each encoded straight from
+where it is rather than copied into outputBuf first.
+*/
+dn_err_t dn_ipmt_sendToSegs(uint8_t socketId, uint8_t* destIP, uint16_t destPort, uint8_t serviceType, uint8_t priority, uint16_t packetId, const dn_serial_seg_t* payload, uint8_t numSegs, dn_ipmt_sendTo_rpt* reply) {
+   dn_serial_seg_t segs[1+DN_SENDTO_MAX_SEGS];
    uint8_t    extraFlags;
+   uint8_t    i;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
+   if (numSegs>DN_SENDTO_MAX_SEGS) {
+      return DN_ERR_MALFORMED;
+   }
+   
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -3860,35 +3856,37 @@ dn_err_t dn_ipmt_sendTo(uint8_t socketId, uint8_t* destIP, uint16_t destPort, ui
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_SENDTO;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
+   req->cmdId                 = CMDID_SENDTO;
+   req->replyContents         = (uint8_t*)reply;
    
    // extraFlags
    extraFlags = 0x00;
    
-   // build outputBuf
-   dn_ipmt_vars.outputBuf[DN_SENDTO_REQ_OFFS_SOCKETID] = socketId;
-   memcpy(&dn_ipmt_vars.outputBuf[DN_SENDTO_REQ_OFFS_DESTIP],destIP,16);
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_SENDTO_REQ_OFFS_DESTPORT],destPort);
-   dn_ipmt_vars.outputBuf[DN_SENDTO_REQ_OFFS_SERVICETYPE] = serviceType;
-   dn_ipmt_vars.outputBuf[DN_SENDTO_REQ_OFFS_PRIORITY] = priority;
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_SENDTO_REQ_OFFS_PACKETID],packetId);
-   memcpy(&dn_ipmt_vars.outputBuf[DN_SENDTO_REQ_OFFS_PAYLOAD],payload,payloadLen);
-   
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // build the header in outputBuf
+   req->outputBuf[DN_SENDTO_REQ_OFFS_SOCKETID] = socketId;
+   memcpy(&req->outputBuf[DN_SENDTO_REQ_OFFS_DESTIP],destIP,16);
+   dn_write_uint16_t(&req->outputBuf[DN_SENDTO_REQ_OFFS_DESTPORT],destPort);
+   req->outputBuf[DN_SENDTO_REQ_OFFS_SERVICETYPE] = serviceType;
+   req->outputBuf[DN_SENDTO_REQ_OFFS_PRIORITY] = priority;
+   dn_write_uint16_t(&req->outputBuf[DN_SENDTO_REQ_OFFS_PACKETID],packetId);
+   
+   // the payload parts follow the header
+   segs[0].data = req->outputBuf;
+   segs[0].len  = DN_SENDTO_REQ_LEN;
+   for (i=0; i<numSegs; i++) {
+      segs[1+i] = payload[i];
+   }
+   
+   // send header and payload, or queue them behind the commands before it
+   rc = dn_ipmt_reqSubmitSegs(
+      req,                                                      // req
       CMDID_SENDTO,                                             // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
-      DN_SENDTO_REQ_LEN+payloadLen,                             // length
+      segs,                                                     // segs
+      1+numSegs,                                                // numSegs
       dn_ipmt_sendTo_reply                                      // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -3898,16 +3896,18 @@ dn_err_t dn_ipmt_sendTo(uint8_t socketId, uint8_t* destIP, uint16_t destPort, ui
 
 void dn_ipmt_sendTo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_sendTo_rpt* reply;
+   dn_ipmt_req_t* req;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // do NOT verify length (no return fields expected)
    
    // cast the replyContent
-   reply = (dn_ipmt_sendTo_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_sendTo_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -3917,11 +3917,8 @@ void dn_ipmt_sendTo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t l
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== search
@@ -3935,13 +3932,15 @@ or the reset command.
 */
 dn_err_t dn_ipmt_search(dn_ipmt_search_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -3950,28 +3949,24 @@ dn_err_t dn_ipmt_search(dn_ipmt_search_rpt* reply) {
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_SEARCH;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
+   req->cmdId                 = CMDID_SEARCH;
+   req->replyContents         = (uint8_t*)reply;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_SEARCH,                                             // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_SEARCH_REQ_LEN,                                        // length
       dn_ipmt_search_reply                                      // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -3981,16 +3976,18 @@ dn_err_t dn_ipmt_search(dn_ipmt_search_rpt* reply) {
 
 void dn_ipmt_search_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_search_rpt* reply;
+   dn_ipmt_req_t* req;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // do NOT verify length (no return fields expected)
    
    // cast the replyContent
-   reply = (dn_ipmt_search_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_search_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -4000,11 +3997,8 @@ void dn_ipmt_search_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t l
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== testRadioTxExt
@@ -4050,13 +4044,15 @@ Channel numbering is 0-15, corresponding to IEEE 2.4 GHz channels 11-26.
 */
 dn_err_t dn_ipmt_testRadioTxExt(uint8_t testType, uint16_t chanMask, uint16_t repeatCnt, int8_t txPower, uint8_t seqSize, uint8_t pkLen_1, uint16_t delay_1, uint8_t pkLen_2, uint16_t delay_2, uint8_t pkLen_3, uint16_t delay_3, uint8_t pkLen_4, uint16_t delay_4, uint8_t pkLen_5, uint16_t delay_5, uint8_t pkLen_6, uint16_t delay_6, uint8_t pkLen_7, uint16_t delay_7, uint8_t pkLen_8, uint16_t delay_8, uint8_t pkLen_9, uint16_t delay_9, uint8_t pkLen_10, uint16_t delay_10, uint8_t stationId, dn_ipmt_testRadioTxExt_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -4065,54 +4061,50 @@ dn_err_t dn_ipmt_testRadioTxExt(uint8_t testType, uint16_t chanMask, uint16_t re
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_TESTRADIOTXEXT;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
+   req->cmdId                 = CMDID_TESTRADIOTXEXT;
+   req->replyContents         = (uint8_t*)reply;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_TESTTYPE] = testType;
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_CHANMASK],chanMask);
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_REPEATCNT],repeatCnt);
-   dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_TXPOWER] = (int8_t)txPower;
-   dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_SEQSIZE] = seqSize;
-   dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_1] = pkLen_1;
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_1],delay_1);
-   dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_2] = pkLen_2;
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_2],delay_2);
-   dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_3] = pkLen_3;
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_3],delay_3);
-   dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_4] = pkLen_4;
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_4],delay_4);
-   dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_5] = pkLen_5;
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_5],delay_5);
-   dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_6] = pkLen_6;
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_6],delay_6);
-   dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_7] = pkLen_7;
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_7],delay_7);
-   dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_8] = pkLen_8;
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_8],delay_8);
-   dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_9] = pkLen_9;
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_9],delay_9);
-   dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_10] = pkLen_10;
-   dn_write_uint16_t(&dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_10],delay_10);
-   dn_ipmt_vars.outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_STATIONID] = stationId;
-   
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_TESTTYPE] = testType;
+   dn_write_uint16_t(&req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_CHANMASK],chanMask);
+   dn_write_uint16_t(&req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_REPEATCNT],repeatCnt);
+   req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_TXPOWER] = (int8_t)txPower;
+   req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_SEQSIZE] = seqSize;
+   req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_1] = pkLen_1;
+   dn_write_uint16_t(&req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_1],delay_1);
+   req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_2] = pkLen_2;
+   dn_write_uint16_t(&req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_2],delay_2);
+   req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_3] = pkLen_3;
+   dn_write_uint16_t(&req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_3],delay_3);
+   req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_4] = pkLen_4;
+   dn_write_uint16_t(&req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_4],delay_4);
+   req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_5] = pkLen_5;
+   dn_write_uint16_t(&req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_5],delay_5);
+   req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_6] = pkLen_6;
+   dn_write_uint16_t(&req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_6],delay_6);
+   req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_7] = pkLen_7;
+   dn_write_uint16_t(&req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_7],delay_7);
+   req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_8] = pkLen_8;
+   dn_write_uint16_t(&req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_8],delay_8);
+   req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_9] = pkLen_9;
+   dn_write_uint16_t(&req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_9],delay_9);
+   req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_PKLEN_10] = pkLen_10;
+   dn_write_uint16_t(&req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_DELAY_10],delay_10);
+   req->outputBuf[DN_TESTRADIOTXEXT_REQ_OFFS_STATIONID] = stationId;
+   
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_TESTRADIOTXEXT,                                     // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_TESTRADIOTXEXT_REQ_LEN,                                // length
       dn_ipmt_testRadioTxExt_reply                              // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -4122,16 +4114,18 @@ dn_err_t dn_ipmt_testRadioTxExt(uint8_t testType, uint16_t chanMask, uint16_t re
 
 void dn_ipmt_testRadioTxExt_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_testRadioTxExt_rpt* reply;
+   dn_ipmt_req_t* req;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // do NOT verify length (no return fields expected)
    
    // cast the replyContent
-   reply = (dn_ipmt_testRadioTxExt_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_testRadioTxExt_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -4141,11 +4135,8 @@ void dn_ipmt_testRadioTxExt_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, u
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== zeroize
@@ -4161,13 +4152,15 @@ via SPI or JTAG in order to be useable.
 */
 dn_err_t dn_ipmt_zeroize(dn_ipmt_zeroize_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -4176,28 +4169,24 @@ dn_err_t dn_ipmt_zeroize(dn_ipmt_zeroize_rpt* reply) {
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_ZEROIZE;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
+   req->cmdId                 = CMDID_ZEROIZE;
+   req->replyContents         = (uint8_t*)reply;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_ZEROIZE,                                            // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_ZEROIZE_REQ_LEN,                                       // length
       dn_ipmt_zeroize_reply                                     // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -4207,16 +4196,18 @@ dn_err_t dn_ipmt_zeroize(dn_ipmt_zeroize_rpt* reply) {
 
 void dn_ipmt_zeroize_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_zeroize_rpt* reply;
+   dn_ipmt_req_t* req;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
    // do NOT verify length (no return fields expected)
    
    // cast the replyContent
-   reply = (dn_ipmt_zeroize_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_zeroize_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -4226,11 +4217,8 @@ void dn_ipmt_zeroize_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t
       
    }
    
-   // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
-   
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
 }
 
 //===== socketInfo
@@ -4240,13 +4228,15 @@ Retrieve information about a socket. (Available in IP Mote >= 1.4.0)
 */
 dn_err_t dn_ipmt_socketInfo(uint8_t index, dn_ipmt_socketInfo_rpt* reply) {
    uint8_t    extraFlags;
+   dn_ipmt_req_t* req;
    dn_err_t   rc;
    
    // lock the module
    dn_lock();
    
-   // verify no ongoing transmissions
-   if (dn_ipmt_vars.busyTx) {
+   // take a free entry in the request table
+   req = dn_ipmt_reqAlloc();
+   if (req==NULL) {
       // unlock the module
       dn_unlock();
       
@@ -4255,29 +4245,25 @@ dn_err_t dn_ipmt_socketInfo(uint8_t index, dn_ipmt_socketInfo_rpt* reply) {
    }
    
    // store callback information
-   dn_ipmt_vars.cmdId          = CMDID_SOCKETINFO;
-   dn_ipmt_vars.replyContents  = (uint8_t*)reply;
+   req->cmdId                 = CMDID_SOCKETINFO;
+   req->replyContents         = (uint8_t*)reply;
    
    // extraFlags
    extraFlags = 0x00;
    
    // build outputBuf
-   dn_ipmt_vars.outputBuf[DN_SOCKETINFO_REQ_OFFS_INDEX] = index;
+   req->outputBuf[DN_SOCKETINFO_REQ_OFFS_INDEX] = index;
    
-   // send outputBuf
-   rc = dn_serial_mt_sendRequest(
+   // send outputBuf, or queue it behind the commands before it
+   rc = dn_ipmt_reqSubmit(
+      req,                                                      // req
       CMDID_SOCKETINFO,                                         // cmdId
       extraFlags,                                               // extraFlags
-      dn_ipmt_vars.outputBuf,                                   // payload
+      req->outputBuf,                                           // payload
       DN_SOCKETINFO_REQ_LEN,                                    // length
       dn_ipmt_socketInfo_reply                                  // replyCb
    );
    
-   if (rc==DN_ERR_NONE) {
-      // I'm now busy transmitting
-      dn_ipmt_vars.busyTx         = TRUE;
-   }
-   
    // unlock the module
    dn_unlock();
    
@@ -4287,9 +4273,11 @@ dn_err_t dn_ipmt_socketInfo(uint8_t index, dn_ipmt_socketInfo_rpt* reply) {
 
 void dn_ipmt_socketInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8_t len) {
    dn_ipmt_socketInfo_rpt* reply;
+   dn_ipmt_req_t* req;
    
    // verify I'm expecting this answer
-   if (dn_ipmt_vars.busyTx==FALSE || dn_ipmt_vars.cmdId!=cmdId) {
+   req = dn_ipmt_reqSent(cmdId);
+   if (req==NULL) {
       return;
    }
    
@@ -4299,7 +4287,7 @@ void dn_ipmt_socketInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8
    }
    
    // cast the replyContent
-   reply = (dn_ipmt_socketInfo_rpt*)dn_ipmt_vars.replyContents;
+   reply = (dn_ipmt_socketInfo_rpt*)req->replyContents;
    
    // store RC
    reply->RC = rc;
@@ -4314,11 +4302,186 @@ void dn_ipmt_socketInfo_reply(uint8_t cmdId, uint8_t rc, uint8_t* payload, uint8
       dn_read_uint16_t(&reply->port,&payload[DN_SOCKETINFO_REPLY_OFFS_PORT]);
    }
    
+   // call the callback, and send the next command
+   dn_ipmt_reqDone();
+}
+
+//========== request table
+
+/**
+\brief Take the next free entry of the request table, or NULL if it is full.
+
+The entry only counts once dn_ipmt_reqSubmit() has been called on it.
+*/
+dn_ipmt_req_t* dn_ipmt_reqAlloc() {
+   dn_ipmt_req_t* req;
+   
+   if (dn_ipmt_vars.reqCount>=DN_IPMT_MAX_REQUESTS) {
+      return NULL;
+   }
+   
+   req = &dn_ipmt_vars.reqs[(dn_ipmt_vars.reqHead+dn_ipmt_vars.reqCount)%DN_IPMT_MAX_REQUESTS];
+   
+   req->paramId               = 0;
+   req->tag                   = dn_ipmt_vars.nextTag;
+   req->timeoutMs             = dn_ipmt_vars.nextTimeoutMs;
+   
+   // the tag is for this command only
+   dn_ipmt_vars.nextTag       = NULL;
+   
+   return req;
+}
+
+/**
+\brief Send the oldest command.
+*/
+void dn_ipmt_reqSend() {
+   dn_ipmt_req_t* req;
+   
+   req = &dn_ipmt_vars.reqs[dn_ipmt_vars.reqHead];
+   
+   dn_serial_mt_sendRequest(
+      req->cmdId,
+      req->extraFlags,
+      req->outputBuf,
+      req->length,
+      req->serialReplyCb
+   );
+   
+   dn_ipmt_vars.reqSent = TRUE;
+}
+
+/**
+\brief Add a command whose request is in its outputBuf to the table.
+
+It is sent at once if the serial line is free, otherwise when the replies to
+the commands before it have come back.
+*/
+dn_err_t dn_ipmt_reqSubmit(dn_ipmt_req_t* req, uint8_t cmdId, uint8_t extraFlags, uint8_t* payload, uint8_t length, dn_serial_reply_cbt replyCb) {
+   dn_serial_seg_t seg;
+   
+   seg.data = payload;
+   seg.len  = length;
+   
+   return dn_ipmt_reqSubmitSegs(req,cmdId,extraFlags,&seg,1,replyCb);
+}
+
+/**
+\brief Add a command whose request is in several parts to the table.
+
+With the serial line free the parts are encoded straight into the HDLC frame.
+Otherwise they are copied into the outputBuf of the entry to wait their turn,
+the first part may already be there.
+*/
+dn_err_t dn_ipmt_reqSubmitSegs(dn_ipmt_req_t* req, uint8_t cmdId, uint8_t extraFlags, const dn_serial_seg_t* segs, uint8_t numSegs, dn_serial_reply_cbt replyCb) {
+   uint16_t   length;
+   uint8_t    i;
+   
+   length = 0;
+   for (i=0; i<numSegs; i++) {
+      length += segs[i].len;
+   }
+   if (length>MAX_FRAME_LENGTH) {
+      return DN_ERR_MALFORMED;
+   }
+   
+   req->cmdId                 = cmdId;
+   req->extraFlags            = extraFlags;
+   req->length                = (uint8_t)length;
+   req->serialReplyCb         = replyCb;
+   
+   dn_ipmt_vars.reqCount++;
+   
+   if (dn_ipmt_vars.reqCount==1) {
+      // the serial line is free
+      dn_serial_mt_sendRequestSegs(cmdId,extraFlags,segs,numSegs,replyCb);
+      dn_ipmt_vars.reqSent = TRUE;
+   } else {
+      length = 0;
+      for (i=0; i<numSegs; i++) {
+         if (segs[i].data!=&req->outputBuf[length]) {
+            memcpy(&req->outputBuf[length],segs[i].data,segs[i].len);
+         }
+         length += segs[i].len;
+      }
+   }
+   
+   return DN_ERR_NONE;
+}
+
+/**
+\brief The command on the serial line, if a reply to cmdId is for it.
+*/
+dn_ipmt_req_t* dn_ipmt_reqSent(uint8_t cmdId) {
+   dn_ipmt_req_t* req;
+   
+   if (dn_ipmt_vars.reqSent==FALSE) {
+      return NULL;
+   }
+   
+   req = &dn_ipmt_vars.reqs[dn_ipmt_vars.reqHead];
+   if (req->cmdId!=cmdId) {
+      return NULL;
+   }
+   
+   return req;
+}
+
+/**
+\brief The command on the serial line is done with.
+
+The next command goes out before the callback runs, so the mote is already
+working on it while the reply is handled. The reply stays in the
+replyContents of the command until the next reply comes in.
+*/
+void dn_ipmt_reqDone() {
+   uint8_t    cmdId;
+   void*      tag;
+   
+   cmdId      = dn_ipmt_vars.reqs[dn_ipmt_vars.reqHead].cmdId;
+   tag        = dn_ipmt_vars.reqs[dn_ipmt_vars.reqHead].tag;
+   
+   // free the entry
+   dn_ipmt_vars.reqHead  = (dn_ipmt_vars.reqHead+1)%DN_IPMT_MAX_REQUESTS;
+   dn_ipmt_vars.reqCount--;
+   dn_ipmt_vars.reqSent  = FALSE;
+   
+   // send the next command
+   if (dn_ipmt_vars.reqCount>0) {
+      dn_ipmt_reqSend();
+   }
+   
+   // call the callback
+   dn_ipmt_vars.replyCb(cmdId,tag);
+}
+
+/**
+\brief The command on the serial line had no reply in time.
+
+Unlike dn_ipmt_reqDone(), the callback runs before the next command goes out.
+The commands queued behind the one that timed out may no longer be wanted, the
+callback can drop them with dn_ipmt_cancelTx() before any reaches the mote.
+Those it leaves are sent once it returns.
+*/
+void dn_ipmt_reqTimeout() {
+   uint8_t    cmdId;
+   void*      tag;
+   
+   cmdId      = dn_ipmt_vars.reqs[dn_ipmt_vars.reqHead].cmdId;
+   tag        = dn_ipmt_vars.reqs[dn_ipmt_vars.reqHead].tag;
+   
+   // free the entry
+   dn_ipmt_vars.reqHead  = (dn_ipmt_vars.reqHead+1)%DN_IPMT_MAX_REQUESTS;
+   dn_ipmt_vars.reqCount--;
+   dn_ipmt_vars.reqSent  = FALSE;
+   
    // call the callback
-   dn_ipmt_vars.replyCb(cmdId);
+   dn_ipmt_vars.replyCb(cmdId,tag);
    
-   // I'm not busy transmitting anymore
-   dn_ipmt_vars.busyTx=FALSE;
+   // send the next command, unless the callback sent one of its own
+   if (dn_ipmt_vars.reqCount>0 && dn_ipmt_vars.reqSent==FALSE) {
+      dn_ipmt_reqSend();
+   }
 }
 
 //========== serialRX
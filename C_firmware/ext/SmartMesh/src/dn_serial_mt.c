@@ -17,6 +17,7 @@ typedef struct {
    uint8_t                   rxPacketId;
    // reply callback
    uint8_t                   replyCmdId;
+   uint8_t                   replyPacketId;
    dn_serial_reply_cbt       replyCb;
    // request callback
    dn_serial_request_cbt     requestCb;
@@ -27,7 +28,7 @@ dn_serial_mt_vars_t dn_serial_mt_vars;
 //=========================== prototype =======================================
 
 void dn_serial_mt_rxHdlcFrame(uint8_t* rxFrame, uint8_t rxFrameLen);
-void dn_serial_mt_dispatch_response(uint8_t cmdId, uint8_t *payload, uint8_t length);
+void dn_serial_mt_dispatch_response(uint8_t cmdId, uint8_t packetId, uint8_t *payload, uint8_t length);
 void dn_serial_sendReply(uint8_t cmdId, uint8_t rc, uint8_t *payload, uint8_t length);
 
 //=========================== public ==========================================
@@ -49,8 +50,25 @@ void dn_serial_mt_init(dn_serial_request_cbt requestCb) {
 }
 
 dn_err_t dn_serial_mt_sendRequest(uint8_t cmdId,  uint8_t extraFlags, uint8_t* payload, uint8_t length, dn_serial_reply_cbt replyCb) {
+   dn_serial_seg_t seg;
+   
+   seg.data = payload;
+   seg.len  = length;
+   
+   return dn_serial_mt_sendRequestSegs(cmdId,extraFlags,&seg,1,replyCb);
+}
+
+/**
+\brief Send a request whose payload is in several parts.
+
+The parts are encoded straight into the HDLC frame, so a payload header and
+the data behind it don't need to be copied together first. They only need to
+stay valid until this returns.
+*/
+dn_err_t dn_serial_mt_sendRequestSegs(uint8_t cmdId,  uint8_t extraFlags, const dn_serial_seg_t* segs, uint8_t numSegs, dn_serial_reply_cbt replyCb) {
    uint8_t i;
    uint8_t flags;
+   uint8_t length;
    
    // register reply callback
    dn_serial_mt_vars.replyCmdId      = cmdId;
@@ -67,13 +85,22 @@ dn_err_t dn_serial_mt_sendRequest(uint8_t cmdId,  uint8_t extraFlags, uint8_t* p
    }
    flags     |= extraFlags;
    
+   // the reply carries the packet ID of its request
+   dn_serial_mt_vars.replyPacketId   = dn_serial_mt_vars.txPacketId;
+   
+   // total length of the payload
+   length     = 0;
+   for (i=0; i<numSegs; i++) {
+      length += segs[i].len;
+   }
+   
    // send the frame over serial
    dn_hdlc_outputOpen();
    dn_hdlc_outputWrite(cmdId);                   // cmdId
    dn_hdlc_outputWrite(length);                  // length
    dn_hdlc_outputWrite(flags);                   // flags
-   for (i=0; i<length; i++) {                    // payload
-      dn_hdlc_outputWrite(payload[i]);
+   for (i=0; i<numSegs; i++) {                   // payload
+      dn_hdlc_outputWriteBuf(segs[i].data,segs[i].len);
    }
    dn_hdlc_outputClose();
    
@@ -87,6 +114,17 @@ dn_err_t dn_serial_mt_sendRequest(uint8_t cmdId,  uint8_t extraFlags, uint8_t* p
    return DN_ERR_NONE;
 }
 
+/**
+\brief Stop waiting for the reply to the last request.
+
+A reply that still comes in for it is dropped, rather than taken for the reply
+to a later request with the same command ID.
+*/
+void dn_serial_mt_cancelReply() {
+   dn_serial_mt_vars.replyCmdId      = 0x00;
+   dn_serial_mt_vars.replyCb         = NULL;
+}
+
 //=========================== private =========================================
 
 void dn_serial_mt_rxHdlcFrame(uint8_t* rxFrame, uint8_t rxFrameLen) {
@@ -117,7 +155,7 @@ void dn_serial_mt_rxHdlcFrame(uint8_t* rxFrame, uint8_t rxFrameLen) {
    if (isResponse) {
       // dispatch
       
-      dn_serial_mt_dispatch_response(cmdId,&rxFrame[3],length);
+      dn_serial_mt_dispatch_response(cmdId,packetId,&rxFrame[3],length);
    } else {
       if (isSync || packetId!=dn_serial_mt_vars.rxPacketId) {
          isRepeatId          = FALSE;
@@ -140,31 +178,29 @@ void dn_serial_mt_rxHdlcFrame(uint8_t* rxFrame, uint8_t rxFrameLen) {
 \note Not public, only used for sending ACK.
 */
 void dn_serial_sendReply(uint8_t cmdId, uint8_t rc, uint8_t *payload, uint8_t length) {
-   uint8_t i;
-   
    dn_hdlc_outputOpen();
    dn_hdlc_outputWrite(cmdId);                                                    // cmdId
    dn_hdlc_outputWrite(length);                                                   // length
    dn_hdlc_outputWrite(DN_SERIAL_API_MASK_RESPONSE | (dn_serial_mt_vars.rxPacketId<<1));   // flags
    dn_hdlc_outputWrite(rc);                                                       // rc
-   for (i=0; i<length; i++) {                                                  // payload
-      dn_hdlc_outputWrite(payload[i]);
-   }
+   dn_hdlc_outputWriteBuf(payload,length);                                        // payload
    dn_hdlc_outputClose();
 }
 
-void dn_serial_mt_dispatch_response(uint8_t cmdId, uint8_t* payload, uint8_t length) {
+void dn_serial_mt_dispatch_response(uint8_t cmdId, uint8_t packetId, uint8_t* payload, uint8_t length) {
    uint8_t rc;
+   dn_serial_reply_cbt replyCb;
    
    rc = payload[0];
-   if (cmdId==dn_serial_mt_vars.replyCmdId && dn_serial_mt_vars.replyCb!=NULL) {
-      
-      // call the callback
-      (dn_serial_mt_vars.replyCb)(cmdId,rc,&payload[1],length);
+   if (cmdId==dn_serial_mt_vars.replyCmdId && packetId==dn_serial_mt_vars.replyPacketId && dn_serial_mt_vars.replyCb!=NULL) {
       
-      // reset
+      // reset first, the callback may send the next request
+      replyCb                        = dn_serial_mt_vars.replyCb;
       dn_serial_mt_vars.replyCmdId   = 0x00;
       dn_serial_mt_vars.replyCb      = NULL;
+      
+      // call the callback
+      replyCb(cmdId,rc,&payload[1],length);
    }
 }
 
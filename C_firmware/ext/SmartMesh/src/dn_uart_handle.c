@@ -50,7 +50,7 @@ char inbuf_mote_boot[16];
 /*=========================== Variables =======================================*/
 typedef struct 
 {
-   dn_uart_rxByte_cbt   ipmt_uart_rxByte_cb;
+   dn_uart_rxBytes_cbt  ipmt_uart_rxBytes_cb;
 } dn_uart_vars_t;
 
 dn_uart_vars_t dn_uart_vars;
@@ -59,10 +59,18 @@ dn_uart_vars_t dn_uart_vars;
 uint8_t *Rx_buff;
 
 /*Buffer variables*/
-extern int head,tail,next,max_len;
+extern volatile int head,tail;
+extern int next,max_len;
 extern uint8_t  buffer_uart[buffer_size];
 extern bool full,empty;
 
+uint32_t uartRxOverflow_DBG = 0;   /* Bytes dropped because the ring was full */
+uint32_t uartTxError_DBG    = 0;   /* Frames the driver wouldn't take for DMA */
+
+/* Frames handed to the DMA whose transfer hasn't finished. The driver holds
+   at most DN_UART_TX_FRAMES of them */
+static volatile uint8_t txInFlight = 0;
+
 /* data array statics for temp sensor */
 uint8_t rxData[DATASIZE_i2c];
 
@@ -86,50 +94,71 @@ uint32_t hwError_i2c;
 
 /*=========================== Flush ===========================================*/  
 
+/* Waits for every frame handed to dn_uart_txFrame() to have gone out. Needed
+   before the UART clock stops */
 void dn_uart_txFlush()
 {
-  /*noting here*/
+  dn_uart_txWait(0);
+}
+
+/* Waits until no more than maxInFlight frames are still being sent */
+void dn_uart_txWait(uint8_t maxInFlight)
+{
+  while (txInFlight > maxInFlight)
+     ;
 }
 /*=========================== Receive ISR  ====================================*/                  
-/* SmartMesh_RF_cog_receive_ISR handles the interrupt for Rx_buffer full and places the incoming data in a buffer,byte oriented receive implemented */
+/* SmartMesh_RF_cog_receive_ISR handles the RX FIFO interrupt and places the incoming data in a buffer.
+   The interrupt comes once the FIFO holds ADI_UARTx_CFG_TRIG_LEVEL bytes, or once the line has gone
+   quiet for a few characters with bytes still in it, and every byte in the FIFO is taken */
 
 void SmartMesh_RF_cog_receive_ISR(void *pcbParam,uint32_t Event,void *pArg)
 { 
-  next=head+1;
-
-  if(next>=max_len)
-     next=0;
-  if(next==tail)
-     full=true;
-  else
-  { 
-#ifdef COG
-       /*COG Board Hardware*/
-       buffer_uart[head]=*pREG_UART0_RX;
-#else  
-       /*CMG MVP Hardware*/
-       buffer_uart[head]=*pREG_UART1_RX;   
-       //adi_uart_Read(hDevice, Rx_buff, 1, DMA_mode, &pHwError_uart);
-       //buffer_uart[head]=*Rx_buff;
-#endif
-       head=next;
+  int     in = head;
+  int     nextIn;
+  uint8_t byte;
+
+  /* The DMA has finished sending a frame, the same callback gets it */
+  if ((Event == ADI_UART_EVENT_TX_BUFFER_PROCESSED) && (txInFlight > 0))
+     txInFlight--;
+
+  while (*UART_LSR_REG & BITM_UART_LSR_DR)
+  {
+     byte   = (uint8_t)*UART_RX_REG;
+     nextIn = in + 1;
+     if (nextIn >= max_len)
+        nextIn = 0;
+
+     if (nextIn == tail)
+     {
+        /* The byte has to be read to clear the interrupt, it is lost */
+        full = true;
+        uartRxOverflow_DBG++;
+        continue;
+     }
+
+     buffer_uart[in] = byte;
+     in = nextIn;
   }
+
+  head = in;
 }
 
 /*=============================Buffer handle ==================================*/
-void Smartmesh_RF_cog_receive(void)
+/* Hands a span of received bytes to the HDLC decoder. Called from the application level */
+void Smartmesh_RF_cog_receive(const uint8_t* bytes, uint16_t len)
 {
-  dn_uart_vars.ipmt_uart_rxByte_cb(buffer_uart[tail]);                          /* This function is called from the application level */
+  dn_uart_vars.ipmt_uart_rxBytes_cb(bytes, len);
 }
 
 /*=========================== Uart Initialization  ============================*/
 
 /* dn_uart_init  Initialises the uart and registers for the Rx buffer full call back */
-void dn_uart_init(dn_uart_rxByte_cbt rxByte_cb)
+void dn_uart_init(dn_uart_rxBytes_cbt rxBytes_cb)
 {
 
    /*call back function*/
-   dn_uart_vars.ipmt_uart_rxByte_cb = rxByte_cb;
+   dn_uart_vars.ipmt_uart_rxBytes_cb = rxBytes_cb;
   
    /*enabling RF reset*/
    adi_gpio_OutputEnable( RESET_SM_PORT, RESET_SM_PIN, true); 
@@ -230,7 +259,31 @@ void dn_uart_irq_disable(void)
 
 /*=========================== Transmission ========================================*/
 
-/*dn_uart_txByte is called by the C-library for transmission of packets,byte oriented transfer is implemented */
+/* dn_uart_txFrame hands a whole HDLC frame to the UART TX DMA and returns at once. The frame
+   buffer must stay as it is until the transfer has finished, see dn_uart_txWait(). Frames go
+   out in the order they are given */
+void dn_uart_txFrame(const uint8_t* frame, uint16_t len)
+{
+   ADI_UART_RESULT eResult;
+
+   dn_uart_txWait(DN_UART_TX_FRAMES - 1u);
+
+   __disable_irq();
+   txInFlight++;
+   __enable_irq();
+
+   eResult = adi_uart_SubmitTxBuffer(hDevice, (void*)frame, len, true);
+   if (eResult != ADI_UART_SUCCESS)
+   {
+      /* The mote never sees the frame, the command times out */
+      __disable_irq();
+      txInFlight--;
+      __enable_irq();
+      uartTxError_DBG++;
+   }
+}
+
+/*dn_uart_txByte sends a single byte and waits for it, the HDLC frames go through dn_uart_txFrame */
 
    void dn_uart_txByte(uint8_t byte)
 { 
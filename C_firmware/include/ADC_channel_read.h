@@ -28,6 +28,9 @@ License Agreement.
 // Defined if using an old 1ax mote in the newer 3-axis system
 //#define OLD_MOTE
 
+// Defined if the ADT7420 temperature sensor is fitted on the I2C bus
+//#define AUX_TEMP_SENSOR
+
 /* Write samples to file */
 //#ifndef __CC_ARM
 //#define WRITE_SAMPLES_TO_FILE
@@ -92,7 +95,27 @@ extern uint32_t ADC_DATA_LEN;
 
 /*16.16 representation of Vref*/
 #define VREF = (uint32_t)(3.3*65536)  
-#define VERSION 1.06
+#define VERSION 1.07
+
+/* Auxiliary scan. Reference for the battery and die temperature conversions in 16.16 */
+#define ADC_AUX_VREF_Q16        ((uint32_t)(3.3*65536))
+#define ADT7420_I2C_ADDR        0x48
+#define ADT7420_REG_TEMP        0x00
+#define ADT7420_REG_ID          0x0B
+#define ADT7420_ID              0xCB
+
+/* Bits of adc_aux_t.valid */
+#define ADC_AUX_VBAT_VALID      0x01
+#define ADC_AUX_DIE_TEMP_VALID  0x02
+#define ADC_AUX_SENS_TEMP_VALID 0x04
+
+typedef struct
+{
+   uint16_t vbat_mV;
+   int16_t  dieTemp_cC;     // MCU die temperature in 0.01 degC
+   int16_t  sensTemp_cC;    // ADT7420 temperature in 0.01 degC
+   uint8_t  valid;          // ADC_AUX_x_VALID bits, cleared if a reading failed
+} adc_aux_t;
 
 /* The below arrays are sized to accomodate the following:
  *    - flash page size = 2048B
@@ -114,6 +137,10 @@ void ADC_SampleData_Blocking_Oversampling(uint8_t, uint8_t);
 void ADC_SampleData_Blocking_Averaging(uint8_t, uint16_t);
 void ADC_Disable(void);
 void ADC_Calc_FFT();
+void ADC_Clear_FFT(void);
+void ADC_Aux_Scan(void);
+const adc_aux_t* getAdcAux(void);
 void updateAdcParams(uint32_t, bool);
+float sampleToFloat(uint16_t, bool);
 
 #endif  // ADC_CHANNEL_READ__
@@ -33,6 +33,11 @@ License Agreement.
 #define BUFFERSIZE1                256u   
 #define SPI_MASTER_DEVICE_NUM1     (1u) 
 
+/* Halves of the sample arrays, written to flash in turn while acquiring */
+#define AD7685_PING_BUFF           0u
+#define AD7685_PONG_BUFF           1u
+#define AD7685_NO_BUFF             2u
+
 
 /*****/
 /*=============  PROTOTYPES  =============*/
@@ -74,6 +74,85 @@ License Agreement.
 #define TX_PAYLOAD_RAW            90u
 #define TX_PAYLOAD_FFT            90u
 
+/* Frame info packet. Sent ahead of the first data packet of a frame and
+ * identified by the manager from its first three bytes. The magic is
+ * followed by records of | type | length | payload | */
+#define FRAME_INFO_MAGIC_0        0xFE
+#define FRAME_INFO_MAGIC_1        0xED
+#define FRAME_INFO_MAGIC_2        0xCB
+#define FRAME_INFO_TYPE_JITTER    0x01
+#define FRAME_INFO_TYPE_AUX       0x02
+#define FRAME_INFO_TYPE_CAPTURE   0x03
+#define FRAME_INFO_TYPE_FLASH_WR  0x04
+#define FRAME_INFO_TYPE_ARCHIVE   0x05
+#define FRAME_INFO_TYPE_FLASH_RD  0x06
+#define FRAME_INFO_TYPE_FRAME     0x07
+#define FRAME_INFO_MAX_LEN        90u   /* One SmartMesh payload */
+
+/* Flags of the frame info archive record */
+#define FRAME_ARCH_FLAG_CALIBRATED 0x01  /* Same as ARCH_FLAG_CALIBRATED */
+#define FRAME_ARCH_FLAG_COMPRESSED 0x02  /* Same as ARCH_FLAG_COMPRESSED */
+#define FRAME_ARCH_FLAG_SPECTRUM   0x04  /* Same as ARCH_FLAG_SPECTRUM */
+#define FRAME_ARCH_FLAG_PAGE_CRC   0x08  /* Same as ARCH_FLAG_PAGE_CRC */
+#define FRAME_ARCH_FLAG_REPLAY     0x80  /* An earlier capture sent again */
+
+/* Encoding of the frame record, the same bits as the archive record */
+#define FRAME_ENC_MASK            (FRAME_ARCH_FLAG_CALIBRATED | FRAME_ARCH_FLAG_COMPRESSED | FRAME_ARCH_FLAG_SPECTRUM)
+#define FRAME_NO_CAPTURE_ID       0xFFFFFFFFu   /* The capture isn't in the archive */
+
+/* Frame v2. Each axis is a frame, its data packets carry the frame ID and
+ * the byte offset of their data in the frame so the manager can place them
+ * whatever order they arrive in. An end packet closes the frame:
+ *  | D2 | frame ID (1) | offset (3) | data... |
+ *  | D3 | frame ID (1) | bytes (4) | CRC-32 of the bytes (4) | */
+#define FRAME_V2_DATA             0xD2
+#define FRAME_V2_END              0xD3
+#define FRAME_V2_DATA_HDR_B       5u
+#define FRAME_V2_END_LEN          10u
+#define FRAME_V2_MAX_BYTES        (1ul << 24)   /* Reach of the 3 byte offset, see PLAN_MAX_SAMPLES */
+
+/* The frames of a capture are kept once sent, until the manager has all of
+ * them or FRAME_NACK_WAIT_S has passed without it asking for anything. The
+ * byte ranges it asks for are sent again with their original offsets */
+#define FRAME_RETAIN_MAX          3u    /* One per axis */
+#define FRAME_RETX_MAX_RANGES     8u
+#define FRAME_NACK_WAIT_S         10u
+
+/* Streaming. The manager grants credit for up to 127 frames past one it has
+ * had, and the mote starts captures while any is left without waiting for a
+ * ready message. Top-ups come with the frame acks, see DL_TYPE_CREDIT */
+#define STREAM_MAX_CREDIT         127u
+
+/* Flags sent in the 5th byte of the ready message */
+#define READY_FLAG_CALIBRATED     0x01  /* Samples are sent in milli-g */
+
+/* Command descriptors in the 6th field of a downstream message */
+#define CMD_MGR_READY             11
+#define CMD_SAMPLING_PARAMS       22
+#define CMD_AXIS_INFO             33
+#define CMD_ALARM                 44
+#define CMD_ALARM_RESET           55    /* Handled by the manager only */
+#define CMD_CALIBRATION           66
+#define CMD_PLAN_ENTRY            77
+#define CMD_ARCHIVE_GET           88
+
+/* Binary downlink commands, told apart from the text ones above by their
+ * first byte. A header, records of | type | length | value | and a CRC-32,
+ * see handleBinaryCmd(). Axes are a bit per axis_t */
+#define DL_CMD_MAGIC              0xB5
+#define DL_CMD_VERSION            1
+#define DL_CMD_HDR_B              4u
+#define DL_CMD_CRC_B              4u
+#define DL_TYPE_READY             0x01  /* No value */
+#define DL_TYPE_SAMPLING          0x02  /* rate Hz (4) | samples (4) | sleep s (4) | axes (1) | final stage (1) */
+#define DL_TYPE_AXES              0x03  /* axes (1) */
+#define DL_TYPE_ALARM             0x04  /* alarm (1) */
+#define DL_TYPE_CAL_ROW           0x05  /* axis (1) | offset code (2) | X, Y, Z Q14 coefficients (3 x 2) | op (1) */
+#define DL_TYPE_PLAN_ENTRY        0x06  /* index (1) | op (1) | rate Hz (4) | samples (4) | axes (1) | processing (1) | first bin (2) */
+#define DL_TYPE_ARCHIVE_GET       0x07  /* seq (4) */
+#define DL_TYPE_FRAME_NACK        0x08  /* frame ID (1) | byte ranges missed, offset (4) | bytes (2) ... none once it has the frame */
+#define DL_TYPE_CREDIT            0x09  /* frames (1) | after frame ID (1), left out to count from the last frame started. 0 frames ends streaming */
+
 /* dummy data */
 #define dummy_data                0x08
 
@@ -84,8 +163,52 @@ License Agreement.
 #define delay_count_ten_sec       260000000
 #define delay_count_dara          2600000
 
+/* A command with no reply this long after it went to the mote is cancelled,
+ * with those queued behind it, and the mote's status read again, see
+ * api_response_timeout(). The time only runs while the command is on the
+ * serial line, counted in steps of API_TICK_MS */
+#define RESPONSE_TIMEOUT_MS       90000u
+#define API_TICK_MS               1000u
+
 /* Receive Correct */
 #define RC_OK                     0x00
+#define RC_NO_RESOURCES           0x0C  /* Mote has no buffer free for the packet */
+
+/* Packets handed to the mote that may wait in its queue for a TXDONE at the
+ * same time. Packet IDs count up below TX_PACKET_ID_MASK */
+#define TX_WINDOW_PACKETS         4u
+#define TX_PACKET_ID_MASK         0x7FFFu
+#define TXDONE_STATUS_OK          0x00
+
+/* A packet whose TXDONE hasn't come back after TX_WINDOW_MAX_AGE checks of
+ * the window, every TX_WINDOW_CHECK_MS, is taken as lost. A packet the mote
+ * refuses TX_SEND_RETRIES times with anything but RC_NO_RESOURCES is given
+ * up on, the manager asks for missing frame bytes again. RC_NO_RESOURCES
+ * with no packets in the window to free its buffers is tried again after
+ * TX_FULL_BACKOFF_MS */
+#define TX_WINDOW_CHECK_MS        10000u
+#define TX_WINDOW_MAX_AGE         6u
+#define TX_SEND_RETRIES           5u
+#define TX_FULL_BACKOFF_MS        1000u
+
+/* Classes of the transmit queue. api_sendTo() picks the highest class with
+ * something to send before every packet, so an event only ever waits for
+ * the packet already with the mote. High class packets may take one slot
+ * more than the window */
+#define TX_CLASS_HIGH             0u    /* Events and the ready message, HIGH_PRIORITY */
+#define TX_CLASS_MED              1u    /* Frame info and status messages, MED_PRIORITY */
+#define TX_CLASS_LOW              2u    /* Frame data, ends and resends, LOW_PRIORITY */
+#define TX_NUM_CLASSES            3u
+#define TX_MSG_QUEUE_LEN          4u    /* Short messages held per class */
+#define TX_MSG_MAX_LEN            8u
+
+/* Event packet, queued in the high class when something goes wrong that the
+ * manager should hear about before the rest of the data:
+ *  | EE | event (1) | value (4) | */
+#define EVENT_MAGIC               0xEE
+#define EVENT_LEN                 6u
+#define EVENT_FLASH_CORRUPT       0x01  /* value: pages of the capture that failed their check, once all are read */
+#define EVENT_WRITER_OVERRUN      0x02  /* value: sets of pages the flash writer dropped */
 
 /* Sensor data acquisition */
 #define Sensor_data_enable        0
@@ -110,9 +233,7 @@ typedef enum {
   Mote_Status,                                            /* Flag_Check value for getting mote status */
   Open_Socket,                                            /* Flag_Check value for opening a socket for communication */
   Bind_Socket,                                            /* Flag_Check value for binding the socket with a source por t */
-  Set_NetID,                                              /* Flag Check for getting the network ID*/
-  Get_NetID,                                              /* Flag Check for setting the network ID*/
-  Set_JoinDC,                                              /* Flag Check for setting the join duty cycle*/
+  Set_NetID,                                              /* Flag Check for setting and reading back the network ID and the join duty cycle */
   Join,                                                   /* Flag_Check value for joining a network */
   Request_Service,                                        /* Flag Check value for requesting bandwidth*/
   Get_Service_Info,
@@ -136,8 +257,6 @@ typedef enum {
 typedef struct {
    /* event */
    timer_callback   eventCb;
-   /* reply */
-   reply_callback   replyCb;
    /* app */
    uint8_t              secUntilTx;
    uint8_t              direction;
@@ -150,7 +269,7 @@ typedef struct {
 /*=========================== Prototypes =======================================*/
 /* ipmt */
 void dn_ipmt_notif_cb(uint8_t cmdId, uint8_t subCmdId);
-void dn_ipmt_reply_cb(uint8_t cmdId);
+void dn_ipmt_reply_cb(uint8_t cmdId, void* tag);
 
 void buffer_handle(void);
 
@@ -183,9 +302,17 @@ void api_getServiceInfo(void);
 void api_getServiceInfo_reply(void);
 
 void scheduleEvent(timer_callback cb);
-void startTx(bool, axis_t);
+void startTx(bool, axis_t, uint16_t*, bool);
+void startRetx(const uint8_t*, uint32_t, uint32_t);
+bool txRetxNext(axis_t*, uint32_t*, uint32_t*);
+bool txRetxPage(uint32_t, uint16_t*, uint32_t*, uint32_t*);
+void txRetxDone(uint32_t);
+bool txFramesAcked(void);
+void txFramesRelease(void);
+uint16_t frameHeaderWord(axis_t);
 int txRunning(void);
 int gotFinalAck(void);
+bool txAllDone(void);
 uint32_t getAdcNumSamples(void);
 uint32_t getSampFreq(void);
 uint32_t getSleepDur(void);
@@ -198,8 +325,11 @@ uint8_t getAxisInfo(void);
 
 bool getMgrReady(void);
 void clearMgrReady(void);
+bool streamCredit(void);
 void sendMgrReady(void);
-void api_readySignal_reply(void);
+bool txQueueMsg(uint8_t, const uint8_t*, uint8_t);
+bool txQueueEvent(uint8_t, uint32_t);
+bool txMsgsQueued(void);
 
 void sendMsg(uint8_t, uint8_t, uint8_t, uint8_t);
 void sendStartingTx(void);
@@ -0,0 +1,56 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+/*!
+* @file      calibration.h
+* @brief     Main header file for calibration.c
+*
+* @details   Per-mote accelerometer calibration, stored in external flash and
+*            applied to the AD7685 samples as they are acquired
+*
+*/
+
+#ifndef CALIBRATION__
+#define CALIBRATION__
+
+/*=============  I N C L U D E S   =============*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*=============  D E F I N E S  =============*/
+#define CAL_MAGIC           0xCA1Bu
+#define CAL_NUM_AXES        3u
+
+// Matrix coefficients are signed Q2.14 and convert offset corrected ADC
+// codes into milli-g. The nominal gain for the ADXL356 at +/-20g is
+// 0.6866 mg/code, which is 11249 in Q14
+#define CAL_COEFF_FRAC_BITS 14u
+
+// Operations requested by the manager along with a calibration row
+#define CAL_OP_STAGE        0u  // Store the row, don't apply it yet
+#define CAL_OP_COMMIT       1u  // Store the row and save all rows to flash
+#define CAL_OP_ERASE        2u  // Erase the calibration, send raw codes again
+
+/*=============  TYPEDEFS  =============*/
+typedef struct
+{
+   uint16_t magic;
+   uint16_t reserved;
+   uint16_t offset[CAL_NUM_AXES];               // ADC code at 0g for each axis
+   int16_t  coeff[CAL_NUM_AXES][CAL_NUM_AXES];  // Row = output axis, column = input axis
+   uint32_t crc;                                // CRC-32 of all fields above
+} cal_t;
+
+/*=============  PROTOTYPES  =============*/
+void calInit(void);
+bool calIsValid(void);
+void calApply(uint16_t *x, uint16_t *y, uint16_t *z);
+void calSetRow(uint8_t axis, uint16_t offset, int16_t cx, int16_t cy, int16_t cz);
+void calCommit(void);
+void calErase(void);
+
+#endif // CALIBRATION__
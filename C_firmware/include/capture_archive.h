@@ -0,0 +1,143 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+/*!
+* @file      capture_archive.h
+* @brief     Main header file for capture_archive.c
+*
+* @details   Append-only log of captures in the external flash. Every capture
+*            gets a header record that says where its pages are so it can be
+*            read back later
+*
+*/
+
+#ifndef CAPTURE_ARCHIVE__
+#define CAPTURE_ARCHIVE__
+
+/*=============  I N C L U D E S   =============*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ext_flash.h"
+#include "capture_plan.h"
+
+/*=============  D E F I N E S  =============*/
+#define ARCH_REC_MAGIC      0xCA7Eu
+#define ARCH_REC_VERSION    5u
+#define ARCH_NUM_AXES       3u
+
+#define ARCH_SUPER_MAGIC    0xCA75u
+#define ARCH_SUPER_PAGES    ((uint32_t)FLASH_SUPER_BLOCKS * NUM_FLASH_PAGES_PER_BLOCK)
+#define ARCH_SEQ_NONE       0xFFFFFFFFu
+
+// Pages of sample data the archive holds before the oldest captures are overwritten
+#define ARCH_DATA_PAGES     ((uint32_t)NUM_FLASH_DATA_BLOCKS * NUM_FLASH_PAGES_PER_BLOCK)
+
+// Header records kept before the oldest are overwritten, one per page of the log
+#define ARCH_LOG_PAGES      ((uint32_t)FLASH_LOG_BLOCKS * NUM_FLASH_PAGES_PER_BLOCK)
+
+// Blocks kept erased ahead of the write position. Erasing them early costs
+// this many blocks of history, but the writer only has to wait for an erase
+// once a capture runs past all of them
+#define ARCH_ERASE_AHEAD_BLOCKS 8u
+
+// Bits of arch_rec_t.flags
+#define ARCH_FLAG_CALIBRATED 0x01  // Samples are milli-g rather than ADC codes
+#define ARCH_FLAG_COMPRESSED 0x02  // Pages are coded by sample_codec.c
+#define ARCH_FLAG_SPECTRUM   0x04  // The last page of each axis is its spectrum, see flash_fft.h
+#define ARCH_FLAG_PAGE_CRC   0x08  // Every page has a CRC-32 at FLASH_PAGE_CRC_COL
+
+/*=============  TYPEDEFS  =============*/
+// All enabled axes share the data area. Their pages are interleaved in X, Y,
+// Z order, one page of each at a time, so page k of the n-th enabled axis
+// is startPage + k * (number of axes) + n. Pages are numbered from the start
+// of the area and keep counting up when it wraps, so an old number is
+// never reused
+typedef struct
+{
+   uint16_t      magic;
+   uint8_t       version;
+   uint8_t       axisInfo;
+   uint32_t      seq;          // Increases by at least one for every capture
+   uint32_t      timestamp;    // RTC count at the end of the capture, s
+   uint32_t      sampFreq;     // Hz
+   uint32_t      numSamples;   // Per axis
+   uint8_t       proc;         // PLAN_PROC_x bits the capture was taken with
+   uint8_t       flags;        // ARCH_FLAG_x bits
+   uint16_t      reserved;
+   uint32_t      startPage;
+   uint16_t      nPages;       // Per axis
+   uint8_t       axisMask;     // Bit per axis_t stored
+   uint8_t       numAxes;
+   uint32_t      crc;          // CRC-32 of all fields above
+} arch_rec_t;
+
+// Where the archive is up to. Written to the next superblock page after
+// every record and once a capture has been sent, so a reset doesn't lose
+// track of a capture that was stored but not sent
+typedef struct
+{
+   uint16_t      magic;
+   uint8_t       version;      // ARCH_REC_VERSION, the layout the pages are in
+   uint8_t       reserved;
+   uint32_t      gen;          // Increases by one for every copy written
+   uint32_t      nextSeq;      // seq of the next record
+   uint32_t      head;         // Next page number to write
+   uint32_t      unsentSeq;    // Newest capture not yet sent in full, ARCH_SEQ_NONE if all were
+   uint32_t      crc;          // CRC-32 of all fields above
+} arch_super_t;
+
+// Checks of pages read back, since power up
+typedef struct
+{
+   uint32_t      pagesRead;
+   uint16_t      corrected;    // Reads the flash had to correct bit errors in
+   uint16_t      retries;      // Reads repeated after a failed check
+   uint16_t      corrupt;      // Reads still failing after every retry
+} arch_check_stats_t;
+
+/*=============  PROTOTYPES  =============*/
+void              archInit(void);
+
+// Write side, used while acquiring
+void              archStartCapture(bool compressed);
+uint16_t          archWrRow(void);
+uint16_t          archCapRow(uint32_t page);
+void              archMarkSpectrum(void);
+bool              archWrAdvance(void);
+bool              archWrFailed(void);
+void              archWrEraseFailed(void);
+uint32_t          archMaxSamples(uint8_t axisMask);
+void              archCommitCapture(const plan_entry_t *capture);
+
+// Erase-ahead pool, topped up while the flash is otherwise idle
+void              archEraseService(void);
+void              archEraseWait(void);
+
+// Read side
+bool              archOpen(uint32_t seq);
+bool              archRdDone(axis_t axis);
+bool              archRdAllDone(void);
+uint16_t          archRdRow(axis_t axis);
+void              archRdAdvance(axis_t axis);
+uint16_t          archAxisRow(axis_t axis, uint16_t k);
+const arch_rec_t* archCurrentRecord(void);
+bool              archIsReplay(void);
+void              archMarkSent(void);
+void              archMarkCorrupt(axis_t axis);
+uint8_t           archCheckPage(uint16_t row);
+void              archCountCheck(uint8_t result, uint8_t retries);
+uint16_t          archCorruptPages(uint8_t axisMask);
+const arch_check_stats_t* getArchCheckStats(void);
+uint32_t          archOldestSeq(void);
+uint32_t          archNextSeq(void);
+
+// Requests from the manager to send an old capture again
+void              archRequestReplay(uint32_t seq);
+bool              archTakeReplay(uint32_t *seq);
+
+#endif // CAPTURE_ARCHIVE__
@@ -0,0 +1,62 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+/*!
+* @file      capture_plan.h
+* @brief     Main header file for capture_plan.c
+*
+* @details   List of captures run back to back in one wake, without waiting
+*            for the manager between them
+*
+*/
+
+#ifndef CAPTURE_PLAN__
+#define CAPTURE_PLAN__
+
+/*=============  I N C L U D E S   =============*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*=============  D E F I N E S  =============*/
+#define PLAN_MAX_ENTRIES    4u
+
+// Longest capture per axis, that of the longest FFT, FLASH_FFT_MAX_LEN in
+// flash_fft.h. The flash could hold more but longer ones haven't been tried.
+// Their frames must also stay in reach of FRAME_V2_MAX_BYTES
+#define PLAN_MAX_SAMPLES    65536u
+
+// Processing applied to a capture
+#define PLAN_PROC_FFT       0x01  // Calculate the FFT. Of captures kept in flash only a band of bins, see flash_fft.h
+
+// Operations requested by the manager along with a plan entry
+#define PLAN_OP_STAGE       0u    // Store the entry, don't run it yet
+#define PLAN_OP_COMMIT      1u    // Store the entry, it is the last one of the plan
+#define PLAN_OP_CLEAR       2u    // Remove the plan, run the manager's sampling parameters again
+
+/*=============  TYPEDEFS  =============*/
+typedef struct
+{
+   uint32_t sampFreq;     // Hz
+   uint32_t numSamples;   // Per axis
+   uint8_t  axisInfo;     // Same encoding as the manager's axis select, e.g. XYZ
+   uint8_t  proc;         // PLAN_PROC_x bits
+   uint16_t fftFirstBin;  // First bin of the band sent for captures kept in flash
+} plan_entry_t;
+
+/*=============  PROTOTYPES  =============*/
+void                planSetEntry(uint8_t idx, const plan_entry_t *entry);
+void                planCommit(uint8_t numEntries);
+void                planClear(void);
+uint8_t             planNumEntries(void);
+const plan_entry_t* planStartCapture(void);
+const plan_entry_t* planReplayCapture(const plan_entry_t *entry);
+uint8_t             planAxisMask(uint8_t axisInfo);
+bool                planCaptureRemaining(void);
+uint8_t             planCaptureIdx(void);
+const plan_entry_t* planCurrentCapture(void);
+
+#endif // CAPTURE_PLAN__
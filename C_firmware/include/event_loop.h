@@ -0,0 +1,58 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+/*!
+* @file      event_loop.h
+* @brief     Main header file for event_loop.c
+*
+* @details   Run to completion events and one shot timers for the main loop,
+*            and the idle hook that lets the core sleep when there is no work
+*
+*/
+
+#ifndef EVENT_LOOP__
+#define EVENT_LOOP__
+
+/*=============  I N C L U D E S   =============*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*=============  D E F I N E S  =============*/
+// Events waiting to run at once
+#define EV_QUEUE_LEN            8u
+
+// Period of the GP0 tick that drives the timers. Delays are rounded up to it
+#define EV_TICK_MS              100u
+
+// Slots of the timer wheel, a power of two. Timers further off than one turn
+// of the wheel stay in their slot until their turn comes round
+#define EV_WHEEL_SLOTS          32u
+
+/*=============  TYPEDEFS  =============*/
+typedef void (*ev_handler_t)(void);
+
+// Owned by the caller, usually static. Don't change it while it is running
+typedef struct ev_timer
+{
+   struct ev_timer *next;      // In its wheel slot
+   uint32_t        expiry;     // Tick it fires on
+   ev_handler_t    handler;    // May be NULL, evTimerActive() then tells it has fired
+   bool            active;
+} ev_timer_t;
+
+/*=============  PROTOTYPES  =============*/
+void evInit(void);
+bool evPost(ev_handler_t handler);
+bool evPending(void);
+void evRun(void);
+void evTick(void);
+void evTimerStart(ev_timer_t *timer, uint32_t delay_ms, ev_handler_t handler);
+void evTimerStop(ev_timer_t *timer);
+bool evTimerActive(const ev_timer_t *timer);
+void evIdle(bool (*idleOk)(void));
+
+#endif // EVENT_LOOP__
@@ -16,10 +16,44 @@
 #define NUM_FLASH_PAGES_PER_BLOCK  64u
 #define NUM_FLASH_BLOCKS           1024u
 
-#define NUM_FLASH_BLOCKS_PER_AXIS  341u   // floor(1024/3)
-#define X_AXIS_BLOCK_BOUNDARY      NUM_FLASH_BLOCKS_PER_AXIS
-#define Y_AXIS_BLOCK_BOUNDARY      NUM_FLASH_BLOCKS_PER_AXIS*2
-#define Z_AXIS_BLOCK_BOUNDARY      NUM_FLASH_BLOCKS_PER_AXIS*3
+// Reserved blocks at the top of the flash
+#define FLASH_CAL_BLOCK            (NUM_FLASH_BLOCKS - 1u)  // Per-mote calibration
+#define FLASH_LOG_BLOCKS           8u                       // Capture archive headers, one page each
+#define FLASH_LOG_START_BLOCK      (FLASH_CAL_BLOCK - FLASH_LOG_BLOCKS)
+#define FLASH_BBT_BLOCK            (FLASH_LOG_START_BLOCK - 1u)  // Bad block table
+#define FLASH_SPARE_BLOCKS         16u                      // Replacements for bad data blocks
+#define FLASH_SPARE_START_BLOCK    (FLASH_BBT_BLOCK - FLASH_SPARE_BLOCKS)
+#define FLASH_FFT_BLOCKS           4u                       // Scratch for the FFT of long captures
+#define FLASH_FFT_START_BLOCK      (FLASH_SPARE_START_BLOCK - FLASH_FFT_BLOCKS)
+#define FLASH_SUPER_BLOCKS         2u                       // Archive superblock, the blocks used in turn
+#define FLASH_SUPER_START_BLOCK    (FLASH_FFT_START_BLOCK - FLASH_SUPER_BLOCKS)
+
+// Everything below the reserved blocks holds sample data, shared by the axes being sampled
+#define NUM_FLASH_DATA_BLOCKS      FLASH_SUPER_START_BLOCK
+
+// A row is the page number across the whole flash, block * 64 + page
+#define FLASH_ROW(block, page)     (uint16_t)(((uint32_t)(block) << 6) | ((page) & 0x3Fu))
+#define FLASH_ROW_BLOCK(row)       (uint16_t)((row) >> 6)
+#define FLASH_ROW_PAGE(row)        (uint8_t)((row) & 0x3Fu)
+
+// Bytes at the start of a program load buffer that are overwritten with the
+// command and column address
+#define FLASH_PROG_LOAD_HDR_B      3u
+
+// The first byte of the spare area of page 0 is not 0xFF in a bad block
+#define FLASH_BAD_BLOCK_COL        0x800u
+
+// CRC-32 of the data of a sample page, written to its spare area along with it
+#define FLASH_PAGE_CRC_COL         0x804u
+
+// Results of checking a page read back from the flash
+#define FLASH_PAGE_OK              0u
+#define FLASH_PAGE_CORRECTED       1u   // Intact after the flash corrected bit errors
+#define FLASH_PAGE_ECC_FAILED      2u   // Too many bit errors for the flash to correct
+#define FLASH_PAGE_CRC_FAILED      3u
+
+// Extra reads of a page that fails its check before it is taken as corrupt
+#define FLASH_READ_RETRIES         2u
 
 // Declare typedef to a function that returns an uint16_t 
 // and accepts no parameters
@@ -43,6 +77,7 @@ typedef struct
 #define WRITE_ENABLE_FLASH     0x06
 #define WRITE_DISABLE_FLASH    0x04
 #define PROGRAM_LOAD_FLASH     0x02
+#define PROGRAM_LOAD_RANDOM_FLASH 0x84  // Loads without clearing the rest of the cache
 #define PROGRAM_EXE_FLASH      0x10
 #define GET_FEATURES_FLASH     0x0F
 #define SET_FEATURES_FLASH     0x1F
@@ -58,13 +93,22 @@ typedef struct
 
 #define BITP_FLSH_STAT_OIP 0  // Operation in Progress
 #define BITP_FLSH_STAT_WEL 1  // Write Enable
+#define BITP_FLSH_STAT_E_FAIL 2  // Last erase failed
+#define BITP_FLSH_STAT_P_FAIL 3  // Last program failed
+#define BITP_FLSH_STAT_ECC 4  // ECC status of the last page read, 2 bits
 
 #define BITM_FLSH_STAT_OIP 0x00000001  // Operation in Progress
 #define BITM_FLSH_STAT_WEL 0x00000010  // Write Enable
+#define BITM_FLSH_STAT_E_FAIL 0x00000004  // Last erase failed
+#define BITM_FLSH_STAT_P_FAIL 0x00000008  // Last program failed
+#define BITM_FLSH_STAT_ECC 0x00000030  // 0 no errors, 2 uncorrectable, otherwise corrected
+#define FLSH_STAT_ECC_FAILED 0x00000020
 
 void initExtFlashSPI();
 void spiWriteFlash(uint8_t *tx_data, SpiRW_s spi_rw);
 void spiReadFlash(uint8_t *rx_buffer, uint8_t *tx_cmd, SpiRW_s spi_rw);
+void spiWriteFlashStart(uint8_t *tx_data, SpiRW_s spi_rw);
+void spiReadFlashStart(uint8_t *rx_buffer, uint8_t *tx_cmd, SpiRW_s spi_rw);
 
 void flashUnlockBlocks(void);
 uint8_t flashGetFeatures(uint8_t);
@@ -100,14 +144,23 @@ void flashWriteDisable(void);
 
 void prepareFlash(void);
 
-void updatePagePointers(bool, axis_t);
-bool checkPagePointers(axis_t);
-bool checkAllPagePointers();
-void resetPagePointers(axis_t);
-uint16_t getBlockAddrRd(axis_t);
-uint8_t  getPageAddrRd(axis_t);
-uint16_t getBlockAddrWr(axis_t);
-uint8_t  getPageAddrWr(axis_t);
+// ----- Metadata Pages ----- //
+void flashWritePage(uint16_t, uint8_t, uint8_t*, uint32_t);
+void flashReadPage(uint16_t, uint8_t, uint8_t*, uint32_t);
+uint32_t flashCrc32(uint32_t, const uint8_t*, uint32_t);
+// ---------------------------- //
+
+// ----- Page Integrity ----- //
+uint8_t flashCheckPageData(const uint8_t*, uint32_t, uint8_t);
+uint8_t flashCheckPage(uint16_t, uint8_t, bool);
+// ---------------------------- //
+
+// ----- Bad Blocks ----- //
+bool flashOpFailed(void);
+bool flashCopyPage(uint16_t, uint8_t, uint16_t, uint8_t);
+bool flashBlockMarkedBad(uint16_t);
+void flashMarkBlockBad(uint16_t);
+// ---------------------------- //
 
 #endif  // EXT_FLASH__
 
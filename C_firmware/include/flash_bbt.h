@@ -0,0 +1,54 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+/*!
+* @file      flash_bbt.h
+* @brief     Main header file for flash_bbt.c
+*
+* @details   Bad block table for the data blocks of the external flash. A bad
+*            block is replaced by one of the spare blocks so the layout of
+*            the data area doesn't change
+*
+*/
+
+#ifndef FLASH_BBT__
+#define FLASH_BBT__
+
+/*=============  I N C L U D E S   =============*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ext_flash.h"
+
+/*=============  D E F I N E S  =============*/
+#define BBT_MAGIC           0xBB7Au
+
+/*=============  TYPEDEFS  =============*/
+typedef struct
+{
+   uint16_t slot;    // Data block as laid out
+   uint16_t block;   // Spare block used in its place
+} bbt_remap_t;
+
+// Written to the next page of FLASH_BBT_BLOCK each time it changes
+typedef struct
+{
+   uint16_t    magic;
+   uint16_t    gen;                          // Increases by one for every update
+   uint16_t    sparesUsed;                   // Bit per spare block, allocated or bad
+   uint8_t     numRemaps;
+   uint8_t     reserved;
+   bbt_remap_t remap[FLASH_SPARE_BLOCKS];
+   uint32_t    crc;                          // CRC-32 of all fields above
+} bbt_t;
+
+/*=============  PROTOTYPES  =============*/
+void     bbtInit(void);
+uint16_t bbtMap(uint16_t slot);
+bool     bbtRetire(uint16_t slot);
+
+#endif // FLASH_BBT__
@@ -0,0 +1,61 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+/*!
+* @file      flash_fft.h
+* @brief     Main header file for flash_fft.c
+*
+* @details   FFT of captures too long to be held in RAM, worked through the
+*            external flash. Only a band of magnitude bins is kept, in a
+*            spectrum page stored after the samples of each axis
+*
+*/
+
+#ifndef FLASH_FFT__
+#define FLASH_FFT__
+
+/*=============  I N C L U D E S   =============*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ext_flash.h"
+#include "ADC_channel_read.h"
+
+/*=============  D E F I N E S  =============*/
+// Samples transformed, a power of two. Longer captures use their first
+// FLASH_FFT_MAX_LEN samples
+#define FLASH_FFT_MIN_LEN       1024u
+#define FLASH_FFT_MAX_LEN       65536u
+
+// Complex points held in RAM at once, fftOutBuf
+#define FLASH_FFT_WORK_LEN      1024u
+
+// Complex points in one page of the scratch blocks
+#define FLASH_FFT_PAGE_LEN      (FLASH_PAGE_SIZE_B / (2u * sizeof(float)))
+
+#define SPEC_PAGE_MAGIC         0x5Bu
+#define SPEC_HDR_B              8u
+#define SPEC_MAX_BINS           ((FLASH_PAGE_SIZE_B - SPEC_HDR_B) / 2u)
+
+/*=============  TYPEDEFS  =============*/
+// Start of a spectrum page. The bins follow as uint16_t, each the magnitude
+// divided by the FFT length, the same scale as the FFT of short captures
+typedef struct
+{
+   uint8_t  magic;
+   uint8_t  log2Len;     // The FFT was of 2^log2Len samples
+   uint16_t firstBin;
+   uint16_t numBins;
+   uint16_t reserved;
+} spec_page_hdr_t;
+
+/*=============  PROTOTYPES  =============*/
+uint32_t flashFftLen(uint32_t numSamples);
+bool     flashFftRun(uint8_t axisIdx, uint8_t numAxes, uint32_t numSamples, uint16_t firstBin, uint8_t *specPage);
+uint16_t flashFftPageBytes(const uint8_t *page);
+
+#endif // FLASH_FFT__
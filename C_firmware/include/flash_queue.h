@@ -0,0 +1,65 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+/*!
+* @file      flash_queue.h
+* @brief     Main header file for flash_queue.c
+*
+* @details   Queue of external flash commands that run from interrupts. Each
+*            command calls back once the flash has finished with it
+*
+*/
+
+#ifndef FLASH_QUEUE__
+#define FLASH_QUEUE__
+
+/*=============  I N C L U D E S   =============*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*=============  D E F I N E S  =============*/
+#define FLASH_QUEUE_LEN         8u
+
+// Period of the GP2 timer that polls the status register while the flash is busy
+#define FLASH_QUEUE_POLL_US     50u
+
+/*=============  TYPEDEFS  =============*/
+typedef enum
+{
+   FQ_CMD_WRITE_ENABLE,
+   FQ_CMD_PROGRAM_LOAD,     // pBuf starts with FLASH_PROG_LOAD_HDR_B bytes for the command
+   FQ_CMD_PROGRAM_LOAD_RANDOM,  // As PROGRAM_LOAD, but the rest of the cache is kept
+   FQ_CMD_PROGRAM_EXECUTE,
+   FQ_CMD_PAGE_READ,
+   FQ_CMD_READ_CACHE,
+   FQ_CMD_ERASE
+} fq_cmd_t;
+
+// Called from interrupt context. status is the flash status register once
+// the command has finished, which has the fail bits of a program or erase
+typedef void (*fq_callback_t)(void *param, uint8_t status);
+
+typedef struct
+{
+   fq_cmd_t      cmd;
+   uint16_t      block;
+   uint8_t       page;
+   uint16_t      column;     // Program load and read cache only
+   uint8_t       *pBuf;
+   uint32_t      nBytes;     // Of data, not including any command bytes
+   fq_callback_t callback;   // May be NULL
+   void          *param;
+} fq_job_t;
+
+/*=============  PROTOTYPES  =============*/
+void flashQueueInit(void);
+bool flashQueueSubmit(const fq_job_t *job);
+bool flashQueueBusy(void);
+uint8_t flashQueueRoom(void);
+void flashQueueSpiDone(void);
+
+#endif // FLASH_QUEUE__
@@ -0,0 +1,53 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+/*!
+* @file      flash_writer.h
+* @brief     Main header file for flash_writer.c
+*
+* @details   Queued page writer that streams the sample buffers of several
+*            axes into the external flash while sampling carries on
+*
+*/
+
+#ifndef FLASH_WRITER__
+#define FLASH_WRITER__
+
+/*=============  I N C L U D E S   =============*/
+#include <stdint.h>
+#include <stdbool.h>
+
+/*=============  D E F I N E S  =============*/
+// One stream per axis. Each stream has a ping and a pong buffer so at most
+// two of its pages can be waiting at any time
+#define FLASH_WR_MAX_STREAMS    3u
+#define FLASH_WR_BUFS_PER_STREAM 2u
+#define FLASH_WR_QUEUE_LEN      (FLASH_WR_MAX_STREAMS * FLASH_WR_BUFS_PER_STREAM)
+
+// Bytes of a page added to its CRC per call of flashWrService()
+#define FLASH_WR_CRC_CHUNK_B    128u
+
+/*=============  TYPEDEFS  =============*/
+typedef struct
+{
+   uint32_t pagesWritten;
+   uint64_t busyCycles;      // Core cycles the flash spent loading, programming and erasing
+   uint16_t overruns;        // Sets of pages dropped while a stream's buffers were both still waiting
+   uint8_t  maxQueueDepth;
+   uint8_t  numStreams;
+} flash_wr_stats_t;
+
+/*=============  PROTOTYPES  =============*/
+void                    flashWrStart(uint8_t numStreams);
+bool                    flashWrQueueSet(uint8_t streamMask, uint8_t *pBufs[]);
+void                    flashWrService(void);
+bool                    flashWrIdle(void);
+const flash_wr_stats_t* getFlashWrStats(void);
+uint32_t                flashWrPageTime_us(void);
+uint32_t                flashWrMaxRate_Hz(void);
+
+#endif // FLASH_WRITER__
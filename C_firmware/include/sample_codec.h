@@ -0,0 +1,106 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+/*!
+* @file      sample_codec.h
+* @brief     Main header file for sample_codec.c
+*
+* @details   Lossless compression of the samples of one axis into flash pages.
+*            Every page can be decoded on its own, here or by the manager,
+*            CBM_app.py
+*
+*/
+
+#ifndef SAMPLE_CODEC__
+#define SAMPLE_CODEC__
+
+/*=============  I N C L U D E S   =============*/
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ADC_channel_read.h"
+
+/*=============  D E F I N E S  =============*/
+#define CODEC_PAGE_MAGIC        0xC5u
+
+// Bits of codec_page_hdr_t.flags
+#define CODEC_FLAG_SIGNED       0x01u   // Samples are two's complement, calibrated milli-g
+
+// Residuals are Rice coded in blocks of this many samples. The parameters
+// of a block come from the samples of the block before it
+#define CODEC_BLOCK_SHIFT       4u
+#define CODEC_BLOCK_LEN         (1u << CODEC_BLOCK_SHIFT)
+#define CODEC_K_INIT            4u
+#define CODEC_K_MAX             16u
+
+// A unary prefix this long is followed by the residual in full instead
+#define CODEC_ESC_Q             8u
+#define CODEC_RAW_BITS          17u
+#define CODEC_MAX_SAMPLE_BITS   (CODEC_ESC_Q + CODEC_RAW_BITS)
+
+#define CODEC_HDR_B             8u
+#define CODEC_PAGE_BITS         ((FLASH_PAGE_SIZE_B - CODEC_HDR_B) * 8u)
+
+// Fewest samples a page holds, when every residual has to be escaped
+#define CODEC_MIN_PAGE_SAMPLES  (CODEC_PAGE_BITS / CODEC_MAX_SAMPLE_BITS + 1u)
+
+/*=============  TYPEDEFS  =============*/
+// Start of every compressed page
+typedef struct
+{
+   uint8_t  magic;
+   uint8_t  flags;       // CODEC_FLAG_x bits
+   uint16_t nBytes;      // Used bytes of the page, including this header
+   uint16_t nSamples;
+   uint16_t first;       // First sample, as is. The rest are coded
+} codec_page_hdr_t;
+
+// Prediction state, the same in the encoder and the decoder
+typedef struct
+{
+   uint16_t prev1;       // Last two samples, offset binary
+   uint16_t prev2;
+   uint32_t sumAbs1;     // Residuals of the block so far, first and second order
+   uint32_t sumAbs2;
+   uint8_t  blkCount;
+   uint8_t  order;       // Predictor of the current block, 1 or 2
+   uint8_t  k;           // Rice parameter of the current block
+} codec_model_t;
+
+typedef struct
+{
+   uint8_t       *page;
+   uint32_t      acc;         // Bits not yet written to the page, MSB first
+   uint8_t       accBits;
+   uint8_t       flags;
+   uint16_t      nBytes;      // Written after the header
+   uint16_t      nSamples;
+   uint16_t      first;
+   codec_model_t model;
+} codec_enc_t;
+
+typedef struct
+{
+   const uint8_t *page;
+   uint16_t      bitPos;
+   uint16_t      endBit;      // Of the used part of the page
+   uint16_t      left;        // Samples not yet read
+   uint8_t       flags;
+   bool          firstDone;
+   codec_model_t model;
+} codec_dec_t;
+
+/*=============  PROTOTYPES  =============*/
+void     codecStart(codec_enc_t *enc, uint8_t *page, uint16_t first, bool isSigned);
+bool     codecRoom(const codec_enc_t *enc);
+void     codecPut(codec_enc_t *enc, uint16_t sample);
+uint16_t codecFinish(codec_enc_t *enc);
+uint16_t codecPageBytes(const uint8_t *page);
+bool     codecDecStart(codec_dec_t *dec, const uint8_t *page);
+bool     codecGet(codec_dec_t *dec, uint16_t *sample);
+
+#endif // SAMPLE_CODEC__
@@ -22,8 +22,6 @@ License Agreement.
 #include <drivers/pwr/adi_pwr.h>
 #include <drivers/tmr/adi_tmr.h>
 
-extern bool timerTicked;
-
 /*=============  TYPEDEFS  =============*/
 typedef enum
 {
@@ -58,11 +56,30 @@ typedef struct
 #error TMR is not ported for this processor
 #endif
 
+/* Sampling jitter instrumentation. When defined, the DWT cycle counter is
+ * latched on every sampling timer tick and on every AD7685 CONV edge, and a
+ * per-capture latency histogram is sent to the manager with the frame */
+//#define SAMP_JITTER_PROFILING
+
+// Latency histogram bins. Bin 0 holds latencies < 1us, bin n holds
+// [2^(n-1), 2^n) us and the last bin holds everything above that
+#define SAMP_JITTER_HIST_BINS 8u
+
 /*=============  DATA  =============*/
 #define SAMPLING_SCHEDULER_CLOCK_USEC 10
 
 extern bool check_ad7685;
 
+typedef struct
+{
+  uint32_t period_us;                         // Requested sampling period
+  uint32_t numSamples;                        // CONV edges seen in the capture
+  uint32_t numMissed;                         // Ticks that fired before the previous one was serviced
+  uint32_t numLate;                           // CONV edges more than half a period after their tick
+  uint32_t maxLatency_us;                     // Worst tick to CONV latency
+  uint16_t hist[SAMP_JITTER_HIST_BINS];       // Tick to CONV latency histogram
+} samp_jitter_t;
+
 /*==========================  PROTOTYPES  ====================================*/
 
 void    StartScheduler(scheduler_t);
@@ -74,6 +91,9 @@ void    EnableSamplingTimer(void);
 void    DisableSamplingTimer(void);
 void    GP0CallbackFunction(void *pCBParam, uint32_t Event, void  * pArg);
 void    SamplingTimeCallbackFunction(void *pCBParam, uint32_t Event, void  * pArg);
+void    sampJitterReset(uint32_t period_us);
+void    sampJitterConvEdge(void);
+const samp_jitter_t* getSampJitter(void);
 /*=============  L O C A L    F U N C T I O N S  =============*/
 
 
@@ -20,6 +20,7 @@ ADI_RTC_RESULT rtc_UpdateAlarm (uint32_t alarmTime_s);
 ADI_RTC_RESULT rtc_SetAlarm(uint32_t alarmTime_s);
 /* prototypes for RTC time reporting function */
 void rtc_ReportTime(void);
+uint32_t rtc_GetTime(void);
 /* prototypes for RTC seconds computation */
 uint32_t BuildSeconds(void);
 /* prototypes for clock initialization */
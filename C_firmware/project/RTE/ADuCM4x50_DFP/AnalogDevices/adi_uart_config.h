@@ -182,7 +182,7 @@ These are calculated with the UarDivCalculator tool.
    2 - 8 bytes to trig RX interrupt. \n
    3 - 14 bytes to trig RX interrupt.
 */
-#define ADI_UART0_CFG_TRIG_LEVEL                     0
+#define ADI_UART0_CFG_TRIG_LEVEL                     2
 
 
 /*!
@@ -353,7 +353,7 @@ These are calculated with the UarDivCalculator tool.
    2 - 8 bytes to trig RX interrupt. \n
    3 - 14 bytes to trig RX interrupt.
 */
-#define ADI_UART1_CFG_TRIG_LEVEL                       0
+#define ADI_UART1_CFG_TRIG_LEVEL                       2
 
 
 /*!
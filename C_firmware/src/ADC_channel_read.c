@@ -20,6 +20,8 @@ License Agreement.
 
 /* Managed drivers and/or services include */
 #include <drivers/adc/adi_adc.h>
+#include <drivers/i2c/adi_i2c.h>
+#include <drivers/gpio/adi_gpio.h>
 #include <drivers/pwr/adi_pwr.h>
 #include <drivers/general/adi_drivers_general.h>
 #include <common.h>
@@ -30,6 +32,7 @@ License Agreement.
 
 /* ADC example include */
 #include "ADC_channel_read.h"
+#include "calibration.h"
 
 /* FFT operation selects */ 
 #define FFT_FORWARD_TRANSFORM   0
@@ -67,6 +70,10 @@ float ADC_FFT_SCALER;
 /*Battery Voltage*/
 uint32_t *pVbat;
 
+/* Result of the last auxiliary scan */
+static adc_aux_t adcAux;
+static uint32_t  adcAuxVbat_q16;
+
 /*====================  L O C A L    F U N C T I O N S  ======================*/
 
 static void usleep(uint32_t usec);
@@ -75,6 +82,19 @@ static void usleep(uint32_t usec);
 
 extern uint32_t aclock_freq;
 
+/* I2C variables, declared with the UART */
+#ifdef AUX_TEMP_SENSOR
+#include "dn_uart.h"
+
+extern uint8_t              devMem[ADI_I2C_MEMORY_SIZE];
+extern ADI_I2C_HANDLE       i2cDevice;
+extern ADI_I2C_TRANSACTION  xfr;
+extern uint32_t             hwError_i2c;
+extern uint8_t              rxData[DATASIZE_i2c];
+
+static bool tempSensorRead(int16_t *temp_cC);
+#endif
+
 /*===================== C O D E  =============================================*/
 
 void ADC_Init(void)
@@ -190,11 +210,17 @@ void ADC_SampleData_Blocking_Oversampling(uint8_t extra_bits, uint8_t samp_time)
 
 void ADC_Calc_FFT()
 {
+#ifndef OLD_MOTE
+    bool cal_en = calIsValid();
+#else
+    bool cal_en = false;
+#endif
+
     //X_AXIS      
     // NOTE: ADC_PARAM_LEN was 2, which would have been referring to the 3rd sample but header only takes up 1 sample slot (2B)
     for (int i = 0; i < ADC_NUM_SAMPLES; i++)
         //fftInBuf[i] = (float)adcDataX[i + ADC_PARAM_LEN_S]; 
-        fftInBuf[i] = (float)adcDataX[i + ADC_PARAM_LEN]; 
+        fftInBuf[i] = sampleToFloat(adcDataX[i + ADC_PARAM_LEN], cal_en);
 
     arm_rfft_fast_f32(&fftInst, fftInBuf, fftOutBuf, 0);
     arm_cmplx_mag_f32(fftOutBuf, fftMagOutBuf, ADC_NUM_SAMPLES >> 1);
@@ -213,7 +239,7 @@ void ADC_Calc_FFT()
     //Y_AXIS
     for (int i = 0; i < ADC_NUM_SAMPLES; i++)
         //fftInBuf[i] = adcDataY[i + ADC_PARAM_LEN_S];
-        fftInBuf[i] = adcDataY[i + ADC_PARAM_LEN];
+        fftInBuf[i] = sampleToFloat(adcDataY[i + ADC_PARAM_LEN], cal_en);
 
     arm_rfft_fast_f32(&fftInst, fftInBuf, fftOutBuf, 0);
     arm_cmplx_mag_f32(fftOutBuf, fftMagOutBuf, ADC_NUM_SAMPLES >> 1);
@@ -224,7 +250,7 @@ void ADC_Calc_FFT()
     //Z_AXIS
     for (int i = 0; i < ADC_NUM_SAMPLES; i++)
         //fftInBuf[i] = adcDataZ[i + ADC_PARAM_LEN_S];
-        fftInBuf[i] = adcDataZ[i + ADC_PARAM_LEN];
+        fftInBuf[i] = sampleToFloat(adcDataZ[i + ADC_PARAM_LEN], cal_en);
 
     arm_rfft_fast_f32(&fftInst, fftInBuf, fftOutBuf, 0);
     arm_cmplx_mag_f32(fftOutBuf, fftMagOutBuf, ADC_NUM_SAMPLES >> 1);
@@ -255,6 +281,133 @@ void ADC_Disable(void)
 }
 
 
+// Zero the FFT part of each axis' buffer, for captures that are sent without
+// the FFT. Keeps the frame layout the manager expects
+void ADC_Clear_FFT(void)
+{
+    memset(&adcDataX[ADC_FFT_IDX], 0, sizeof(uint16_t)*(ADC_NUM_SAMPLES >> 1));
+    memset(&adcDataY[ADC_FFT_IDX], 0, sizeof(uint16_t)*(ADC_NUM_SAMPLES >> 1));
+    memset(&adcDataZ[ADC_FFT_IDX], 0, sizeof(uint16_t)*(ADC_NUM_SAMPLES >> 1));
+}
+
+
+// Sample battery voltage, die temperature and the board temperature sensor once.
+// The on-chip ADC must have been initialised with ADC_Init(). It's powered down
+// again afterwards since the accelerometer samples come from the AD7685.
+// The battery and temperature inputs are internal channels that the driver
+// only converts one at a time, so they're read in turn rather than as a DMA scan
+void ADC_Aux_Scan(void)
+{
+    ADI_ADC_RESULT eResult;
+    int32_t        dieTemp_q16;
+
+    adcAux.valid = 0;
+
+    eResult = adi_adc_GetBatteryVoltage(hDevice, ADC_AUX_VREF_Q16, &adcAuxVbat_q16);
+    DEBUG_RESULT("Failed to read battery voltage", eResult, ADI_ADC_SUCCESS);
+    if (eResult == ADI_ADC_SUCCESS)
+    {
+        pVbat          = &adcAuxVbat_q16;
+        adcAux.vbat_mV = (uint16_t)((adcAuxVbat_q16 * 1000u) >> 16);
+        adcAux.valid  |= ADC_AUX_VBAT_VALID;
+    }
+
+    eResult = adi_adc_EnableTemperatureSensor(hDevice, true);
+    DEBUG_RESULT("Failed to enable temperature sensor", eResult, ADI_ADC_SUCCESS);
+
+    eResult = adi_adc_GetTemperature(hDevice, ADC_AUX_VREF_Q16, &dieTemp_q16);
+    DEBUG_RESULT("Failed to read die temperature", eResult, ADI_ADC_SUCCESS);
+    if (eResult == ADI_ADC_SUCCESS)
+    {
+        adcAux.dieTemp_cC = (int16_t)(((int64_t)dieTemp_q16 * 100) >> 16);
+        adcAux.valid     |= ADC_AUX_DIE_TEMP_VALID;
+    }
+
+    adi_adc_EnableTemperatureSensor(hDevice, false);
+    adi_adc_EnableADCSubSystem(hDevice, false);
+    adi_adc_PowerUp(hDevice, false);
+
+#ifdef AUX_TEMP_SENSOR
+    if (tempSensorRead(&adcAux.sensTemp_cC))
+        adcAux.valid |= ADC_AUX_SENS_TEMP_VALID;
+#endif
+}
+
+
+const adc_aux_t* getAdcAux(void)
+{
+    return &adcAux;
+}
+
+
+#ifdef AUX_TEMP_SENSOR
+// Read the ADT7420. The I2C is opened on first use and the chip ID checked so a
+// missing sensor is reported as invalid rather than as a bogus temperature
+static bool tempSensorRead(int16_t *temp_cC)
+{
+    static bool i2cOpen  = false;
+    static bool sensorOk = false;
+    uint8_t     prologue[1];
+    int16_t     raw;
+
+    if (!i2cOpen)
+    {
+        i2cOpen = true;
+
+        adi_gpio_OutputEnable( ADI_GPIO_PORT2, ADI_GPIO_PIN_2, true); 
+        adi_gpio_SetLow( ADI_GPIO_PORT2, ADI_GPIO_PIN_2); 
+
+        if (adi_i2c_Open(0, &devMem, ADI_I2C_MEMORY_SIZE, &i2cDevice) != ADI_I2C_SUCCESS)
+            return false;
+        adi_i2c_Reset(i2cDevice); 
+        adi_i2c_SetBitRate(i2cDevice, 400000);
+        adi_i2c_SetSlaveAddress(i2cDevice, ADT7420_I2C_ADDR);
+
+        prologue[0]       = ADT7420_REG_ID;
+        xfr.pPrologue     = prologue;
+        xfr.nPrologueSize = 1;
+        xfr.pData         = rxData;
+        xfr.nDataSize     = 1;
+        xfr.bReadNotWrite = true;
+        xfr.bRepeatStart  = true;
+        rxData[0]         = 0;
+
+        sensorOk = (adi_i2c_ReadWrite(i2cDevice, &xfr, &hwError_i2c) == ADI_I2C_SUCCESS) &&
+                   (rxData[0] == ADT7420_ID);
+    }
+
+    if (!sensorOk)
+        return false;
+
+    // Temperature MSB then LSB. 13 bit two's complement in the top bits, 0.0625 degC/LSB
+    prologue[0]       = ADT7420_REG_TEMP;
+    xfr.pPrologue     = prologue;
+    xfr.nPrologueSize = 1;
+    xfr.pData         = rxData;
+    xfr.nDataSize     = 2;
+    xfr.bReadNotWrite = true;
+    xfr.bRepeatStart  = true;
+
+    if (adi_i2c_ReadWrite(i2cDevice, &xfr, &hwError_i2c) != ADI_I2C_SUCCESS)
+        return false;
+
+    raw      = (int16_t)(((uint16_t)rxData[0] << 8) | rxData[1]) >> 3;
+    *temp_cC = (int16_t)((raw * 25) / 4);
+    return true;
+}
+#endif
+
+
+/* Calibrated samples are signed milli-g, uncalibrated ones are unsigned ADC codes */
+float sampleToFloat(uint16_t sample, bool cal_en)
+{
+    if (cal_en)
+        return (float)(int16_t)sample;
+    else
+        return (float)sample;
+}
+
+
 /* Approximately wait for minimum 1 usec */
 static void usleep(uint32_t usec)
 {
@@ -34,6 +34,12 @@ License Agreement.
 #include "SmartMesh_RF_cog.h"
 #include "SPI1_AD7685.h"
 #include "ext_flash.h"
+#include "calibration.h"
+#include "capture_plan.h"
+#include "flash_writer.h"
+#include "capture_archive.h"
+#include "sample_codec.h"
+#include "flash_fft.h"
 
 #if 0
   #define DEBUG_PRINT(a) printf a
@@ -60,6 +66,75 @@ uint32_t masterHWErrors1;
 
 /*===================  L O C A L    F U N C T I O N S  =======================*/
 
+// Start of the program load buffer for one half of an axis' sample array.
+// The first byte of the array is reserved/unused when acquiring
+static uint8_t* pageLoadBuf(axis_t axis, uint8_t buff)
+{
+    uint16_t *data;
+
+    switch (axis)
+    {
+        case y_active: data = adcDataY; break;
+        case z_active: data = adcDataZ; break;
+        default:       data = adcDataX; break;
+    }
+
+    if (buff == AD7685_PONG_BUFF)
+        data = &data[FLSH_CMD_2ND_START_S];
+
+    return (uint8_t*)data + 1;
+}
+
+
+// Finish the compressed page of every enabled axis and queue them for the flash
+static void queueCodecPages(uint8_t stream_mask, codec_enc_t *enc, uint8_t buff)
+{
+    uint8_t *page_bufs[FLASH_WR_MAX_STREAMS];
+
+    for (uint8_t s = 0; s < FLASH_WR_MAX_STREAMS; s++)
+    {
+        page_bufs[s] = pageLoadBuf((axis_t)s, buff);
+
+        if (stream_mask & (1u << s))
+            codecFinish(&enc[s]);
+    }
+
+    flashWrQueueSet(stream_mask, page_bufs);
+}
+
+
+// Work out the spectrum of every enabled axis from its pages in the flash
+// and store them after the samples. Nothing is stored unless all succeed
+static void storeSpectra(uint8_t stream_mask, uint8_t num_streams, uint32_t numSamples)
+{
+    uint8_t *page_bufs[FLASH_WR_MAX_STREAMS];
+    uint8_t n = 0;
+
+    archEraseWait();
+
+    for (uint8_t s = 0; s < FLASH_WR_MAX_STREAMS; s++)
+    {
+        page_bufs[s] = pageLoadBuf((axis_t)s, AD7685_PING_BUFF);
+
+        if (!(stream_mask & (1u << s)))
+            continue;
+
+        if (!flashFftRun(n, num_streams, numSamples, planCurrentCapture()->fftFirstBin,
+                         page_bufs[s] + FLASH_PROG_LOAD_HDR_B))
+        {
+            DEBUG_PRINT(("No spectrum, axis %d\n", s));
+            return;
+        }
+        n++;
+    }
+
+    flashWrQueueSet(stream_mask, page_bufs);
+    while (!flashWrIdle())
+        flashWrService();
+
+    archMarkSpectrum();
+}
+
 /*===================  C O D E  ==============================================*/
 void ad7685init(void)
 {
@@ -89,6 +164,7 @@ void ad7685Read(unsigned char count, unsigned char *buf)
 
     /*Enable CONV, P2_11 ... This will begin ADC conversions*/
     adi_gpio_SetHigh(ADI_GPIO_PORT2, ADI_GPIO_PIN_1);
+    sampJitterConvEdge();
 
     /*Acquisition*/
     Mtransceive1.pTransmitter     = masterTx1;
@@ -131,37 +207,42 @@ void ad7685disable(void)
 void ad7685_SampleData_Blocking(void)
 {
   // Collect the defined number of samples, at the sample rate defined by the FFT scheduler
-  uint16_t i = 0, j = 0;
+  uint32_t i = 0;   // Samples taken, captures can be longer than 16 bits count
+  uint16_t j = 0;   // Position in the ping pong buffers
   uint32_t numSamples;
   uint8_t  axis_info;
-  uint16_t block_addr;
-  uint8_t  page_addr;
-  bool x_en      = 0, y_en      = 0, z_en      = 0;
-  bool load_x    = 0, load_y    = 0, load_z    = 0;
-  bool loading_x = 0, loading_y = 0, loading_z = 0;
-  bool active_wr_buff_x = 0;
-  bool active_wr_buff_y = 0;
-  bool active_wr_buff_z = 0;
-
-  uint8_t *wr_ptr;  // Pointer to a byte
+  uint8_t  stream_mask;
+  uint8_t  num_streams = 0;
+  uint8_t  filled;
+  uint8_t  *page_bufs[FLASH_WR_MAX_STREAMS];
+  bool     cal_en;
+  uint16_t smp[FLASH_WR_MAX_STREAMS];
 
+  // Captures sent from the flash are compressed on the way in
+  bool        compress  = ext_flash_needed;
+  bool        page_open = false;
+  bool        page_full;
+  uint8_t     page_buff = AD7685_PING_BUFF;
+  codec_enc_t enc[FLASH_WR_MAX_STREAMS];
 
-  axis_info = getAxisInfo();
-  if (axis_info == XYZ || axis_info == XY || axis_info == XZ || axis_info == X) 
-      x_en = 1;
 
-  if  (axis_info == XYZ || axis_info == XY || axis_info == YZ || axis_info == Y)
-      y_en = 1;
+  axis_info   = planCurrentCapture()->axisInfo;
+  stream_mask = planAxisMask(axis_info);
 
-  if  (axis_info == XYZ || axis_info == XZ || axis_info == YZ || axis_info == Z)
-      z_en = 1;
+  DEBUG_PRINT(("Axis mask %x\n", stream_mask));
 
-  DEBUG_PRINT(("x%d, y%d, z%d\n", x_en, y_en, z_en));
+  for (uint8_t s = 0; s < FLASH_WR_MAX_STREAMS; s++)
+      num_streams += (stream_mask >> s) & 1u;
 
-  numSamples = getAdcNumSamples(); 
+  numSamples = planCurrentCapture()->numSamples;
+  cal_en     = calIsValid();
   j          = ADC_DATA_START_1ST_S;
 
-  while(i < numSamples || (load_x || loading_x || load_y || loading_y || load_z || loading_z))
+  // Every capture is archived, including those short enough to be sent from RAM
+  archStartCapture(compress);
+  flashWrStart(num_streams);
+
+  while(i < numSamples || !flashWrIdle())
   { 
     // Check to see if ad7685 set
     if(check_ad7685 == true && i < numSamples) 
@@ -169,132 +250,98 @@ void ad7685_SampleData_Blocking(void)
       check_ad7685 = false;
       // If set, read data to x,y,z buffers, shift data to 16 bit
       ad7685Read(6, masterRx1);
-      adcDataX[j] = (((uint16_t)masterRx1[0])<<8) | masterRx1[1];  //X-axis data
-      adcDataY[j] = (((uint16_t)masterRx1[2])<<8) | masterRx1[3];  //Y-axis data
-      adcDataZ[j] = (((uint16_t)masterRx1[4])<<8) | masterRx1[5];  //Z-axis data
+      smp[x_active] = (((uint16_t)masterRx1[0])<<8) | masterRx1[1];  //X-axis data
+      smp[y_active] = (((uint16_t)masterRx1[2])<<8) | masterRx1[3];  //Y-axis data
+      smp[z_active] = (((uint16_t)masterRx1[4])<<8) | masterRx1[5];  //Z-axis data
+
+      // Convert to milli-g in place if this mote has been calibrated
+      if (cal_en)
+          calApply(&smp[x_active], &smp[y_active], &smp[z_active]);
       
       i++;
 
-      // Control write pointer, j... And begin SPI transactions to flash if required
-      // Due to limitations in SPI driver TX fifo cannot be preloaded with flash command
-      // so it needs to be stored in the same array as the data to allow the required 
-      // continuous transfers... Jump over those positions in the array when they are reached
-      if (j == ADC_DATA_END_1ST_S)
-      {
-          j = ADC_DATA_START_2ND_S;
-          load_x = x_en;
-          load_y = y_en;
-          load_z = z_en;
-      }
-      else if (j == ADC_DATA_END_2ND_S)
+      if (compress)
       {
-          j = ADC_DATA_START_1ST_S;
-          load_x = x_en;
-          load_y = y_en;
-          load_z = z_en;
+          // The pages of all axes are closed together, as soon as one of them
+          // is full, so that page k of every axis holds the same samples
+          page_full = false;
+          for (uint8_t s = 0; s < FLASH_WR_MAX_STREAMS; s++)
+          {
+              if (page_open && (stream_mask & (1u << s)) && !codecRoom(&enc[s]))
+                  page_full = true;
+          }
+
+          if (page_full)
+          {
+              queueCodecPages(stream_mask, enc, page_buff);
+              page_buff ^= 1u;
+              page_open  = false;
+          }
+
+          for (uint8_t s = 0; s < FLASH_WR_MAX_STREAMS; s++)
+          {
+              if (!(stream_mask & (1u << s)))
+                  continue;
+
+              // Page data follows the program load command bytes
+              if (!page_open)
+                  codecStart(&enc[s], pageLoadBuf((axis_t)s, page_buff) + FLASH_PROG_LOAD_HDR_B, smp[s], cal_en);
+              else
+                  codecPut(&enc[s], smp[s]);
+          }
+          page_open = true;
+
+          if (i == numSamples)
+              queueCodecPages(stream_mask, enc, page_buff);
       }
       else
       {
-          j++;
-      }
-
-      if ((i == numSamples - 1) && ext_flash_needed)
-      {
-          load_x = x_en;
-          load_y = y_en;
-          load_z = z_en;
+          adcDataX[j] = smp[x_active];
+          adcDataY[j] = smp[y_active];
+          adcDataZ[j] = smp[z_active];
+
+          // Control write pointer, j... And queue the buffer for the flash when it is full
+          // Due to limitations in SPI driver TX fifo cannot be preloaded with flash command
+          // so it needs to be stored in the same array as the data to allow the required 
+          // continuous transfers... Jump over those positions in the array when they are reached
+          filled = AD7685_NO_BUFF;
+          if (j == ADC_DATA_END_1ST_S)
+          {
+              j      = ADC_DATA_START_2ND_S;
+              filled = AD7685_PING_BUFF;
+          }
+          else if (j == ADC_DATA_END_2ND_S)
+          {
+              j      = ADC_DATA_START_1ST_S;
+              filled = AD7685_PONG_BUFF;
+          }
+          else
+          {
+              j++;
+
+              // Last, partly filled, page
+              if (i == numSamples)
+                  filled = (j <= ADC_DATA_END_1ST_S) ? AD7685_PING_BUFF : AD7685_PONG_BUFF;
+          }
+
+          // All axes are queued together so their pages stay interleaved in the archive
+          if (filled != AD7685_NO_BUFF)
+          {
+              for (uint8_t s = 0; s < FLASH_WR_MAX_STREAMS; s++)
+                  page_bufs[s] = pageLoadBuf((axis_t)s, filled);
+
+              flashWrQueueSet(stream_mask, page_bufs);
+          }
       }
     } 
 
-    if (load_x)
-    {
-        load_x    = false;
-        loading_x = true;
-        if (!active_wr_buff_x)  // Ping
-        {
-            wr_ptr = (uint8_t*)&adcDataX[0];
-            wr_ptr++;  // First byte of array is reserved/unused when acquiring
-            flashProgramLoad(0x0, wr_ptr, FLASH_PAGE_SIZE_B);
-        }
-        else  //Pong
-        {   
-            wr_ptr = (uint8_t*)&adcDataX[FLSH_CMD_2ND_START_S];
-            wr_ptr++;
-            flashProgramLoad(0x0, wr_ptr, FLASH_PAGE_SIZE_B);
-        }
-        active_wr_buff_x = !active_wr_buff_x;
-    }
-    else if (loading_x)
-    {   
-        if (!isSpi2Busy())  // Check if program load has completed
-        {  
-            loading_x = false;
-            DEBUG_PRINT(("X Ex\n"));
-            block_addr = getBlockAddrWr(x_active);
-            page_addr  = getPageAddrWr(x_active);
-            flashProgramExecute(block_addr, page_addr);
-            updatePagePointers(true, x_active);
-        }
-    }
-    else if (load_y)
-    {
-        load_y    = false;
-        loading_y = true;
-        if (!active_wr_buff_y)
-        {
-            wr_ptr = (uint8_t*)&adcDataY[0];
-            wr_ptr++;  // First byte of array is reserved/unused when acquiring
-            flashProgramLoad(0x0, wr_ptr, FLASH_PAGE_SIZE_B);
-        }
-        else  //Pong
-        {
-            wr_ptr = (uint8_t*)&adcDataY[FLSH_CMD_2ND_START_S];
-            wr_ptr++;
-            flashProgramLoad(0x0, wr_ptr, FLASH_PAGE_SIZE_B);
-        }
-        active_wr_buff_y = !active_wr_buff_y;
-    }
-    else if (loading_y)
-    {   
-        if (!isSpi2Busy())
-        {  
-            loading_y = false;
-            DEBUG_PRINT(("Y Ex\n"));
-            block_addr = getBlockAddrWr(y_active);
-            page_addr  = getPageAddrWr(y_active);
-            flashProgramExecute(block_addr, page_addr);
-            updatePagePointers(true, y_active);
-        }
-    }
-    else if (load_z)
-    {
-        load_z    = false;
-        loading_z = true;
-        if (!active_wr_buff_z) // Ping
-        {
-            wr_ptr = (uint8_t*)&adcDataZ[0];
-            wr_ptr++;  // First byte of array is reserved/unused when acquiring
-            flashProgramLoad(0x0, wr_ptr, FLASH_PAGE_SIZE_B);
-        }
-        else  //Pong
-        {
-            wr_ptr = (uint8_t*)&adcDataZ[FLSH_CMD_2ND_START_S];
-            wr_ptr++;
-            flashProgramLoad(0x0, wr_ptr, FLASH_PAGE_SIZE_B);
-        }
-        active_wr_buff_z = !active_wr_buff_z;
-    }
-    else if (loading_z)
-    {   
-        if (!isSpi2Busy())
-        {  
-            loading_z  = false;
-            DEBUG_PRINT(("Z Ex\n"));
-            block_addr = getBlockAddrWr(z_active);
-            page_addr  = getPageAddrWr(z_active);
-            flashProgramExecute(block_addr, page_addr);
-            updatePagePointers(true, z_active);
-        }
-    }
+    flashWrService();
   }
+
+  // The FFT of a capture too long for RAM is worked out here, while the
+  // samples are in flash and before the record says where they are
+  if (compress && (planCurrentCapture()->proc & PLAN_PROC_FFT))
+      storeSpectra(stream_mask, num_streams, numSamples);
+
+  archCommitCapture(planCurrentCapture());
 }
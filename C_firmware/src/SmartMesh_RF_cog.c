@@ -49,6 +49,7 @@ POSSIBILITY OF SUCH DAMAGE.
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <drivers/i2c/adi_i2c.h>
 #include <common.h>
 #include <adi_processor.h>
@@ -60,6 +61,12 @@ POSSIBILITY OF SUCH DAMAGE.
 #include "SmartMesh_RF_cog.h"
 #include "scheduler.h"
 #include "ext_flash.h"
+#include "calibration.h"
+#include "capture_plan.h"
+#include "flash_writer.h"
+#include "capture_archive.h"
+#include "event_loop.h"
+#include "sample_codec.h"
 
 
 /*=======================  D E F I N E S   ===================================*/
@@ -75,7 +82,8 @@ State_Check                 Flag_Check = Boot_Status;
 
 /* Buffer variables */
 uint8_t                     buffer_uart[buffer_size];
-int                         head,tail,next,max_len;
+volatile int                head,tail;     /* head is moved by the UART interrupt */
+int                         next,max_len;
 
 /* Delay Variable */
 uint32_t                    delay_count=0;
@@ -142,17 +150,104 @@ extern uint8_t join_duty;
 extern uint32_t            *pVbat;
 uint32_t                   Vbat;
 
-/* Packet Sent Flag */
-static int txPacketDone = 1;
+/* Packets queued in the mote, by packet ID, until their TXDONE comes back.
+ * The next packet goes to the mote as soon as the last one has been
+ * accepted, so the radio always has the next one to send rather than each
+ * waiting on the serial and mesh round trip of the one before. The extra
+ * slot is only for high class packets */
+typedef struct
+{
+    uint16_t id;
+    uint8_t  age;     /* Checks of the window it has been in, see txWindowCheck() */
+} tx_window_t;
+
+static tx_window_t txWindow[TX_WINDOW_PACKETS + 1u];
+static uint8_t     txInFlight = 0;
+static uint16_t    txNextId   = 0;
+static bool        txMoteFull = false;   /* Mote refused the last packet, wait for a TXDONE */
+static uint8_t     txRetries  = 0;       /* Refusals in a row, other than RC_NO_RESOURCES */
+static ev_timer_t  txWindowTimer;        /* Every TX_WINDOW_CHECK_MS while packets are in the window */
+static ev_timer_t  txFullTimer;          /* Mote full with an empty window, see txMoteFullWait() */
+
+/* sendTo waiting on its reply. The data pointers only move on once the mote
+ * has accepted the packet, a refused one is sent again */
+typedef enum
+{
+    TX_PKT_DATA,
+    TX_PKT_INFO,
+    TX_PKT_END,
+    TX_PKT_MSG
+} tx_pkt_t;
+
+static uint16_t txPendingId;
+static uint8_t  txPendingLen;     /* Frame bytes in a data packet */
+static tx_pkt_t txPendingKind;
+static uint8_t  txPendingClass;   /* Queue of a message packet */
+
+/* Short messages waiting to be sent, a ring per class. Frame packets don't
+ * go through these, they are built from the frame state when their turn
+ * comes */
+typedef struct
+{
+    uint8_t len;
+    uint8_t data[TX_MSG_MAX_LEN];
+} tx_msg_t;
+
+static tx_msg_t txMsgs[TX_NUM_CLASSES][TX_MSG_QUEUE_LEN];
+static uint8_t  txMsgHead[TX_NUM_CLASSES];
+static uint8_t  txMsgCount[TX_NUM_CLASSES];
+
+static const uint8_t txClassPriority[TX_NUM_CLASSES] = { HIGH_PRIORITY, MED_PRIORITY, LOW_PRIORITY };
+
+uint32_t        txDoneFailed_DBG = 0;   /* Packets the mote gave up on */
+uint32_t        txDoneLost_DBG   = 0;   /* Packets whose TXDONE never came */
+uint32_t        txDropped_DBG    = 0;   /* Packets the mote refused TX_SEND_RETRIES times */
+uint32_t        rspTimeouts_DBG  = 0;   /* Commands that never had a reply */
+
+/* Frames of the capture sent, kept for the ranges the manager asks for
+ * again. The ranges are queued in the order they come in. The offset each
+ * flash page of a frame was sent from is kept with it, so the page a range
+ * starts in is found without going through the ones before it */
+#define TX_FRAME_MAX_PAGES  (PLAN_MAX_SAMPLES / CODEC_MIN_PAGE_SAMPLES + 2u)
+
+typedef struct
+{
+    uint8_t  id;
+    axis_t   axis;
+    uint32_t numBytes;
+    bool     complete;      /* The manager has all of it */
+    uint16_t nPages;
+    uint32_t pageStart[TX_FRAME_MAX_PAGES];
+} tx_frame_t;
+
+typedef struct
+{
+    uint8_t  frame;         /* Index in txFrames */
+    uint32_t offset;
+    uint32_t numBytes;
+} tx_retx_t;
+
+static tx_frame_t txFrames[FRAME_RETAIN_MAX];
+static uint8_t    txNumFrames = 0;
+static tx_retx_t  txRetx[FRAME_RETX_MAX_RANGES];
+static uint8_t    txRetxHead  = 0;
+static uint8_t    txRetxCount = 0;
+static bool       txRetxRun   = false;   /* Data being sent is a range sent again */
+
+static ev_timer_t apiTickTimer;           /* Counts down the reply timeouts while commands are waiting */
+static bool       paramSetupFailed = false;   /* A reply of the parameter setup batch wasn't OK */
 
 /*=======================  I N C L U D E S   =================================*/
 
 /* event */
 void      cancelEvent(void);
 void      setCallback(reply_callback cb);
+static void apiTick(void);
+static void streamGrant(const uint8_t*, uint8_t);
+static void txPacketDone(void);
 
 /* app */
-void      Smartmesh_RF_cog_receive(void);
+void      Smartmesh_RF_cog_receive(const uint8_t*, uint16_t);
 
 
 /*=========================== Buffer handle ==================================*/
@@ -164,6 +259,8 @@ void      Smartmesh_RF_cog_receive(void);
  * @return  void
  *
  * Retrieves the data written to the circular buffer by the interrupt handler and processes the data.
+ * The bytes are handed over in spans, everything up to head or to the end of the ring at once,
+ * so the HDLC decoder works through them in one pass.
  *
  * @sa      Smartmesh_RF_cog_receive().
  *
@@ -172,14 +269,20 @@ void      Smartmesh_RF_cog_receive(void);
 
 void buffer_handle(void)
 {
+  int end;
+
   while(head!=tail)
   {
-   next = tail+1;
+   /* head can move on meanwhile, the bytes after it are taken next time round */
+   end = head;
+   if(end<tail)
+      end = max_len;
+
+   Smartmesh_RF_cog_receive(&buffer_uart[tail], (uint16_t)(end - tail));
 
+   next = end;
    if(next>=max_len)
       next = 0;
-
-   Smartmesh_RF_cog_receive();
    tail = next;
   }
 }
@@ -193,19 +296,18 @@ void buffer_handle(void)
  *
  * @return  void.
  *
- * This function currently executes the event that was scheduled.
+ * The event runs from the main loop once the current one has finished, so
+ * a reply callback can schedule the next command without it being sent
+ * from inside the reply.
  *
- * @sa     app_vars.eventCb().
+ * @sa     evPost().
  *
- * @note    This function is provided for implementing time delays using RTC
- *          interrupts, currently the application is developed using software delays.
+ * @note    An event that is already waiting to run is not queued twice.
  */
 
 void scheduleEvent(timer_callback cb)
 {
-  /* select function to call */
-   app_vars.eventCb = cb;
-   app_vars.eventCb();
+   evPost(cb);
 }
 
 /*=========================== Cancel Event ===================================*/
@@ -216,15 +318,16 @@ void scheduleEvent(timer_callback cb)
  *
  * @return  void.
  *
- * Clears the function call pointer to NULL.
+ * Stops the reply timeout tick started by setCallback() once no command
+ * is left waiting for its reply. Called first by every reply callback.
  *
  * @note    NA.
  */
 
 void cancelEvent(void)
 {
-   /* clear function to call */
-   app_vars.eventCb = NULL;
+   if (dn_ipmt_pending() == 0)
+      evTimerStop(&apiTickTimer);
 }
 
 /*=========================== Set Callback ===================================*/
@@ -236,16 +339,456 @@ void cancelEvent(void)
  * @return  void.
  *
  * Function to be called on receving reply from the API is set here.
+ * It goes with the command issued next as its tag, so several commands
+ * can wait for their replies at once, each coming back to its own
+ * callback. dn_ipmt sends them to the mote one after the other.
  *
  * @note    NA.
  */
 
 void setCallback(reply_callback cb)
 {
-  /* set callback */
-  app_vars.replyCb = cb;
+  /* the command is issued next, give up on it if no reply comes */
+  dn_ipmt_setNextReply((void*)cb, RESPONSE_TIMEOUT_MS);
+
+  if (!evTimerActive(&apiTickTimer))
+     evTimerStart(&apiTickTimer, API_TICK_MS, apiTick);
+}
+
+
+/* Counts down the reply timeout of the command on the serial line */
+static void apiTick(void)
+{
+  dn_ipmt_tick(API_TICK_MS);
+
+  if (dn_ipmt_pending() > 0)
+     evTimerStart(&apiTickTimer, API_TICK_MS, apiTick);
+}
+
+
+static void txWindowDrop(uint8_t i)
+{
+    txInFlight--;
+    for (; i < txInFlight; i++)
+        txWindow[i] = txWindow[i + 1];
+}
+
+/* Age the packets in the window and take those too old as lost, so a
+ * TXDONE that never comes doesn't hold its place for ever */
+static void txWindowCheck(void)
+{
+    uint8_t i = 0;
+
+    while (i < txInFlight)
+    {
+        if (++txWindow[i].age < TX_WINDOW_MAX_AGE)
+        {
+            i++;
+            continue;
+        }
+
+        DEBUG_PRINT(("No TXDONE for packet %d\n", txWindow[i].id));
+        txDoneLost_DBG++;
+        txWindowDrop(i);
+        txMoteFull = false;
+    }
+
+    if (txInFlight > 0)
+        evTimerStart(&txWindowTimer, TX_WINDOW_CHECK_MS, txWindowCheck);
+}
+
+/* Packet accepted by the mote, a TXDONE will follow */
+static void txWindowAdd(uint16_t packetId)
+{
+    if (txInFlight < TX_WINDOW_PACKETS + 1u)
+    {
+        txWindow[txInFlight].id  = packetId;
+        txWindow[txInFlight].age = 0;
+        txInFlight++;
+    }
+
+    if (!evTimerActive(&txWindowTimer))
+        evTimerStart(&txWindowTimer, TX_WINDOW_CHECK_MS, txWindowCheck);
+}
+
+/* TXDONE for a packet. They normally come in the order the packets were
+ * sent, but the entry is searched for in case one went missing */
+static void txWindowRemove(uint16_t packetId)
+{
+    for (uint8_t i = 0; i < txInFlight; i++)
+    {
+        if (txWindow[i].id == packetId)
+        {
+            txWindowDrop(i);
+            break;
+        }
+    }
+
+    if (txInFlight == 0)
+        evTimerStop(&txWindowTimer);
+}
+
+static void txWindowClear(void)
+{
+    txInFlight = 0;
+    txMoteFull = false;
+    txRetries  = 0;
+    evTimerStop(&txWindowTimer);
+    evTimerStop(&txFullTimer);
+}
+
+static void txMoteFullDone(void)
+{
+    txMoteFull = false;
+}
+
+/* The mote had no room for a packet. A TXDONE frees its buffers, but with
+ * none in the window, as once txWindowCheck() has given up on them, the
+ * packet is held back for TX_FULL_BACKOFF_MS instead */
+static void txMoteFullWait(void)
+{
+    txMoteFull = true;
+    if (txInFlight == 0)
+        evTimerStart(&txFullTimer, TX_FULL_BACKOFF_MS, txMoteFullDone);
+}
+
+/*=========================== Downlink commands ==============================*/
+
+/* Little endian readers for binary command fields */
+static uint16_t getU16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t* p)
+{
+    return getU16(p) | ((uint32_t)getU16(p + 2) << 16);
+}
+
+
+/* The manager is missing ranges of a frame it has the end of. They are
+ * queued to be sent again, and no ranges at all means it has the frame.
+ * Frames that have been released are no longer known and are ignored */
+static void txFrameNack(const uint8_t* v, uint8_t vLen)
+{
+    const uint8_t* r;
+    tx_retx_t*     retx;
+    uint32_t       offset, numBytes;
+    uint8_t        i;
+
+    for (i = 0; (i < txNumFrames) && (txFrames[i].id != v[0]); i++)
+        ;
+
+    if (i == txNumFrames)
+        return;
+
+    if (vLen == 1)
+    {
+        txFrames[i].complete = true;
+        return;
+    }
+
+    for (r = v + 1; (r + 6 <= v + vLen) && (txRetxCount < FRAME_RETX_MAX_RANGES); r += 6)
+    {
+        offset   = getU32(r);
+        numBytes = getU16(r + 4);
+
+        if ((offset >= txFrames[i].numBytes) || (numBytes == 0))
+            continue;
+
+        if (numBytes > txFrames[i].numBytes - offset)
+            numBytes = txFrames[i].numBytes - offset;
+
+        retx = &txRetx[(txRetxHead + txRetxCount) % FRAME_RETX_MAX_RANGES];
+        retx->frame    = i;
+        retx->offset   = offset;
+        retx->numBytes = numBytes;
+        txRetxCount++;
+    }
+}
+
+
+/* Axes of a binary command, bit per axis_t, in the decimal XYZ form of axis_info */
+static uint8_t axisInfoFromMask(uint8_t mask)
+{
+    return (uint8_t)(((mask & 0x01) ? X : 0) + ((mask & 0x02) ? Y : 0) + ((mask & 0x04) ? Z : 0));
+}
+
+
+static void applyCalRow(uint8_t axis, uint16_t offset, int16_t cx, int16_t cy, int16_t cz, uint8_t op)
+{
+    calSetRow(axis, offset, cx, cy, cz);
+
+    switch (op)
+    {
+       case CAL_OP_COMMIT: calCommit(); break;
+       case CAL_OP_ERASE:  calErase();  break;
+       default:                         break;
+    }
+}
+
+
+static void applyPlanEntry(uint8_t idx, const plan_entry_t* entry, uint8_t op)
+{
+    switch (op)
+    {
+       case PLAN_OP_STAGE:
+          planSetEntry(idx, entry);
+          break;
+       case PLAN_OP_COMMIT:
+          planSetEntry(idx, entry);
+          planCommit(idx + 1);
+          break;
+       case PLAN_OP_CLEAR:
+          planClear();
+          break;
+       default:
+          break;
+    }
+}
+
+
+/**
+ * @brief    Handles a binary command from the manager.
+ *
+ * @param   msg   Payload of the received packet, starting with DL_CMD_MAGIC.
+ * @param   len   Bytes in msg.
+ *
+ * @return  void.
+ *
+ * Layout (little endian):
+ *  | magic (1) | version (1) | seq (2) | records... | CRC-32 (4) |
+ *
+ * The CRC covers everything before it. Records are | type | length | value |,
+ * see DL_TYPE_x. Types that aren't known and fields past the ones known are
+ * skipped, so parameters can be added without changing older motes. A
+ * message with the same seq as the last is a repeat and is dropped.
+ */
+static void handleBinaryCmd(const uint8_t* msg, uint8_t len)
+{
+    static bool     seqValid = false;
+    static uint16_t lastSeq;
+    const uint8_t*  p;
+    const uint8_t*  pEnd;
+    uint16_t        seq;
+
+    if ((len < DL_CMD_HDR_B + DL_CMD_CRC_B) || (msg[1] != DL_CMD_VERSION))
+        return;
+
+    pEnd = msg + len - DL_CMD_CRC_B;
+    if (flashCrc32(0, msg, (uint32_t)(pEnd - msg)) != getU32(pEnd))
+    {
+        DEBUG_PRINT(("Command CRC failed\n"));
+        return;
+    }
+
+    seq = getU16(&msg[2]);
+    if (seqValid && (seq == lastSeq))
+        return;
+
+    seqValid = true;
+    lastSeq  = seq;
+
+    for (p = msg + DL_CMD_HDR_B; p + 2 <= pEnd && p + 2 + p[1] <= pEnd; p += 2 + p[1])
+    {
+        const uint8_t* v   = p + 2;
+        uint8_t        vLen = p[1];
+
+        switch (p[0])
+        {
+            case DL_TYPE_READY:
+                mgrReady = true;
+                break;
+
+            case DL_TYPE_SAMPLING:
+                if (vLen < 14)
+                    break;
+                samp_frequency = getU32(&v[0]);
+                adcNumSamples  = getU32(&v[4]);
+                sleep_dur_s    = getU32(&v[8]);
+                axis_info      = axisInfoFromMask(v[12]);
+                final_stage    = v[13];
+                mgrReady       = !final_stage;
+                break;
+
+            case DL_TYPE_AXES:
+                if (vLen >= 1)
+                    axis_info = axisInfoFromMask(v[0]);
+                break;
+
+            case DL_TYPE_ALARM:
+                if (vLen >= 1)
+                    alarm = v[0];
+                break;
+
+            case DL_TYPE_CAL_ROW:
+                if (vLen >= 10)
+                    applyCalRow(v[0], getU16(&v[1]), (int16_t)getU16(&v[3]), (int16_t)getU16(&v[5]),
+                                (int16_t)getU16(&v[7]), v[9]);
+                break;
+
+            case DL_TYPE_PLAN_ENTRY:
+            {
+                plan_entry_t entry;
+
+                if (vLen < 14)
+                    break;
+                entry.sampFreq    = getU32(&v[2]);
+                entry.numSamples  = getU32(&v[6]);
+                entry.axisInfo    = axisInfoFromMask(v[10]);
+                entry.proc        = v[11];
+                entry.fftFirstBin = getU16(&v[12]);
+                applyPlanEntry(v[0], &entry, v[1]);
+                break;
+            }
+
+            case DL_TYPE_ARCHIVE_GET:
+                if (vLen >= 4)
+                    archRequestReplay(getU32(&v[0]));
+                break;
+
+            case DL_TYPE_FRAME_NACK:
+                if (vLen >= 1)
+                    txFrameNack(v, vLen);
+                break;
+
+            case DL_TYPE_CREDIT:
+                if (vLen >= 1)
+                    streamGrant(v, vLen);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    DEBUG_PRINT(("Command %d, axis info = %d\n", seq, axis_info));
+}
+
+
+/* Text command, seven 8 character fields converted with atol. Still taken
+ * from managers that don't send binary commands */
+static void handleTextCmd(const dn_ipmt_receive_nt* notif)
+{
+   char sampFrequencyArray[8];
+   char alarmArray[8];
+   char axisArray[8];
+   char numSampArray[8];
+   char sleepDurArray[8];
+   char cmdDescriptorArray[8];
+   char finalStageArray[8];
+
+   /*Filling parameter arrays with received values*/
+   for(int i=0; i<8; i++)
+     {
+       sampFrequencyArray[i] = notif->payload[i];
+       alarmArray[i]         = notif->payload[i+8];
+       axisArray[i]          = notif->payload[i+16];
+       numSampArray[i]       = notif->payload[i+24];
+       sleepDurArray[i]      = notif->payload[i+32];
+       cmdDescriptorArray[i] = notif->payload[i+40]; 
+       finalStageArray[i]    = notif->payload[i+48]; 
+     }
+
+   cmdDescriptor  = (uint16_t)atol(cmdDescriptorArray);
+
+   if (cmdDescriptor == CMD_MGR_READY)
+   {
+      // Manager Ready Signal
+      mgrReady = true;
+   }
+   else if (cmdDescriptor == CMD_SAMPLING_PARAMS)
+   {
+
+      /*Convert char arrays to long int (32) format*/
+      samp_frequency  = (uint32_t)atol(sampFrequencyArray);
+      axis_info       = (uint8_t)atol(axisArray);
+      adcNumSamples   = (uint32_t)atol(numSampArray);
+      sleep_dur_s     = (uint32_t)atol(sleepDurArray);
+      alarm           = (uint8_t)atol(alarmArray);
+      final_stage     = (uint8_t)atol(finalStageArray);
+
+
+      // Manager Ready Signal
+      if (final_stage)
+         mgrReady = false;
+      else
+         mgrReady = true;
+
+      DEBUG_PRINT(("adcNumSamples=%d\n", adcNumSamples));
+      DEBUG_PRINT(("sleep_dur_s=%d\n", sleep_dur_s));
+      DEBUG_PRINT(("axis info = %d\n", axis_info));
+   }
+   else if (cmdDescriptor == CMD_AXIS_INFO)
+   {
+       // Axis info only
+      axis_info = (uint8_t)atol(axisArray);
+      DEBUG_PRINT(("axis info = %d\n", axis_info));
+   }
+   else if (cmdDescriptor == CMD_ALARM)
+   {
+      alarm = (uint8_t)atol(alarmArray);
+   }
+   else if (cmdDescriptor == CMD_CALIBRATION)
+   {
+      // One calibration row per message. Fields are reused as:
+      // axis index, offset code, X/Y/Z Q14 coefficients, (descriptor), operation
+      applyCalRow((uint8_t)atol(sampFrequencyArray),
+                  (uint16_t)atol(alarmArray),
+                  (int16_t)atol(axisArray),
+                  (int16_t)atol(numSampArray),
+                  (int16_t)atol(sleepDurArray),
+                  (uint8_t)atol(finalStageArray));
+   }
+   else if (cmdDescriptor == CMD_PLAN_ENTRY)
+   {
+      // One capture plan entry per message. Fields are reused as:
+      // rate, entry index, axes, number of samples, processing, (descriptor), operation,
+      // then the first FFT bin of flash captures if the manager sent it
+      plan_entry_t entry;
+      uint8_t      idx = (uint8_t)atol(alarmArray);
+      char         fftBinArray[9] = { 0 };
+
+      if (notif->payloadLen >= 64)
+         memcpy(fftBinArray, &notif->payload[56], 8);
+
+      entry.sampFreq    = (uint32_t)atol(sampFrequencyArray);
+      entry.axisInfo    = (uint8_t)atol(axisArray);
+      entry.numSamples  = (uint32_t)atol(numSampArray);
+      entry.proc        = (uint8_t)atol(sleepDurArray);
+      entry.fftFirstBin = (uint16_t)atol(fftBinArray);
+
+      applyPlanEntry(idx, &entry, (uint8_t)atol(finalStageArray));
+   }
+   else if (cmdDescriptor == CMD_ARCHIVE_GET)
+   {
+      // Send an archived capture again. The seq is in the first field.
+      // Nothing is sent if it has been overwritten
+      archRequestReplay((uint32_t)atol(sampFrequencyArray));
+   }
+}
+
+
+/* Red LED on while the alarm is set, green otherwise */
+static void showAlarm(void)
+{
+    /* Toggle Red LED if alarm has been set, disable Green LED */
+    if (alarm)
+    {
+        adi_gpio_SetHigh(ADI_GPIO_PORT1, ADI_GPIO_PIN_12);
+        adi_gpio_OutputEnable(ADI_GPIO_PORT1, ADI_GPIO_PIN_12, false);
+        adi_gpio_OutputEnable(ADI_GPIO_PORT1, ADI_GPIO_PIN_13, true);
+        adi_gpio_SetLow(ADI_GPIO_PORT1, ADI_GPIO_PIN_13);
+
+    }
+    else // Enable green LED
+    {
+        adi_gpio_SetHigh(ADI_GPIO_PORT1, ADI_GPIO_PIN_13);
+        adi_gpio_OutputEnable(ADI_GPIO_PORT1, ADI_GPIO_PIN_12, true);
+    }
 }
 
+
 /*=========================== Ipmt ===========================================*/
 /**
  * @brief    Notifications are handled here.
@@ -277,15 +820,7 @@ void dn_ipmt_notif_cb(uint8_t cmdId, uint8_t subCmdId)
 {
   dn_ipmt_events_nt* dn_ipmt_events_notif;
   dn_ipmt_receive_nt* dn_ipmt_receive_notif;
-
-  /*Declaring variables for CMDID_receive*/
-  char           sampFrequencyArray[8];
-  char           alarmArray[8];
-  char           axisArray[8];
-  char           numSampArray[8];
-  char           sleepDurArray[8];
-  char           cmdDescriptorArray[8];
-  char           finalStageArray[8];
+  dn_ipmt_txDone_nt* dn_ipmt_txDone_notif;
 
   switch (cmdId)
    {
@@ -301,7 +836,7 @@ void dn_ipmt_notif_cb(uint8_t cmdId, uint8_t subCmdId)
                     awaiting_response=false;
                     dn_ipmt_cancelTx();                                         /* Incase of reset event */
                     txRun=0;  // NOTE: This was changed to 0 from 1... Don't know why you would want it to be 1
-                    txPacketDone=1;
+                    txWindowClear();
                     break;
                default:
                     /* nothing done here */
@@ -343,72 +878,13 @@ void dn_ipmt_notif_cb(uint8_t cmdId, uint8_t subCmdId)
           /* Packet Received notifications are handled here */
           /*Setting pointer to payload*/
           dn_ipmt_receive_notif = (dn_ipmt_receive_nt*)app_vars.notifBuf;
-          /*Filling parameter arrays with received values*/
-          for(int i=0; i<8; i++)
-            {
-              sampFrequencyArray[i] = dn_ipmt_receive_notif->payload[i];
-              alarmArray[i]         = dn_ipmt_receive_notif->payload[i+8];
-              axisArray[i]          = dn_ipmt_receive_notif->payload[i+16];
-              numSampArray[i]       = dn_ipmt_receive_notif->payload[i+24];
-              sleepDurArray[i]      = dn_ipmt_receive_notif->payload[i+32];
-              cmdDescriptorArray[i] = dn_ipmt_receive_notif->payload[i+40]; 
-              finalStageArray[i]    = dn_ipmt_receive_notif->payload[i+48]; 
-            }
 
-          cmdDescriptor  = (uint16_t)atol(cmdDescriptorArray);
-
-          if (cmdDescriptor == 11)
-          {
-             // Manager Ready Signal
-             mgrReady = true;
-          }
-          else if (cmdDescriptor == 22)
-          {
-
-             /*Convert char arrays to long int (32) format*/
-             samp_frequency  = (uint32_t)atol(sampFrequencyArray);
-             axis_info       = (uint8_t)atol(axisArray);
-             adcNumSamples   = (uint32_t)atol(numSampArray);
-             sleep_dur_s     = (uint32_t)atol(sleepDurArray);
-             alarm           = (uint8_t)atol(alarmArray);
-             final_stage     = (uint8_t)atol(finalStageArray);
-
-
-             // Manager Ready Signal
-             if (final_stage)
-                mgrReady = false;
-             else
-                mgrReady = true;
+          if ((dn_ipmt_receive_notif->payloadLen > 0) && (dn_ipmt_receive_notif->payload[0] == DL_CMD_MAGIC))
+              handleBinaryCmd(dn_ipmt_receive_notif->payload, dn_ipmt_receive_notif->payloadLen);
+          else
+              handleTextCmd(dn_ipmt_receive_notif);
 
-             DEBUG_PRINT(("adcNumSamples=%d\n", adcNumSamples));
-             DEBUG_PRINT(("sleep_dur_s=%d\n", sleep_dur_s));
-             DEBUG_PRINT(("axis info = %d\n", axis_info));
-          }
-          else if (cmdDescriptor == 33)
-          {
-              // Axis info only
-             axis_info = (uint8_t)atol(axisArray);
-             DEBUG_PRINT(("axis info = %d\n", axis_info));
-          }
-          else if (cmdDescriptor == 44)
-          {
-             alarm = (uint8_t)atol(alarmArray);
-          }
-
-          /* Toggle Red LED if alarm has been set, disable Green LED */
-          if (alarm)
-          {
-              adi_gpio_SetHigh(ADI_GPIO_PORT1, ADI_GPIO_PIN_12);
-              adi_gpio_OutputEnable(ADI_GPIO_PORT1, ADI_GPIO_PIN_12, false);
-              adi_gpio_OutputEnable(ADI_GPIO_PORT1, ADI_GPIO_PIN_13, true);
-              adi_gpio_SetLow(ADI_GPIO_PORT1, ADI_GPIO_PIN_13);
-
-          }
-          else // Enable green LED
-          {
-              adi_gpio_SetHigh(ADI_GPIO_PORT1, ADI_GPIO_PIN_13);
-              adi_gpio_OutputEnable(ADI_GPIO_PORT1, ADI_GPIO_PIN_12, true);
-          }
+          showAlarm();
           break;
 
      case CMDID_MACRX:                                                          /* Mac Receive notifications */
@@ -417,7 +893,11 @@ void dn_ipmt_notif_cb(uint8_t cmdId, uint8_t subCmdId)
      case CMDID_TXDONE:                                                         /* Tramission done notifications */
           /* Transmit Done notifications are handled here */
           //DEBUG_PRINT(("TX DONE\n"));
-          txPacketDone = 1;
+          dn_ipmt_txDone_notif = (dn_ipmt_txDone_nt*)app_vars.notifBuf;
+          if (dn_ipmt_txDone_notif->status != TXDONE_STATUS_OK)
+              txDoneFailed_DBG++;
+          txWindowRemove(dn_ipmt_txDone_notif->packetId);
+          txMoteFull = false;
           break;
      case CMDID_ADVRECEIVED:                                                    /* Advertisement notifications */
           /* Received advertisement notifications are handled here */
@@ -511,17 +991,24 @@ uint8_t getAxisInfo()
  * @brief    Execute reply call back from API.
  *
  * @param [in] cmdId      command ID.
+ * @param [in] tag        callback given to setCallback() for the command.
  *
  * @return  void.
  *
- * Executes reply call back function upon receving reply from API.
+ * Executes reply call back function upon receving reply from API. A
+ * command that timed out goes to api_response_timeout() instead.
  *
  * @note    NA.
  */
 
-void dn_ipmt_reply_cb(uint8_t cmdId)
+void dn_ipmt_reply_cb(uint8_t cmdId, void* tag)
 {
-   app_vars.replyCb();                                                          /* API callback  function */
+   cancelEvent();
+
+   if (app_vars.replyBuf[0] == DN_IPMT_RC_TIMEOUT)
+      api_response_timeout();
+   else if (tag != NULL)
+      ((reply_callback)tag)();                                                  /* API callback  function */
 }
 
 
@@ -541,11 +1028,15 @@ void dn_ipmt_reply_cb(uint8_t cmdId)
  * @sa      scheduleEvent().
  * @sa      api_getMoteStatus().
  *
- * @note   This function is only used when the application is written using RTC delays,
- *         the current application does not use this function .
+ * @note   Runs when a command has had no reply for RESPONSE_TIMEOUT_MS.
+ *         The commands queued behind it are dropped as well, before
+ *         any of them has gone to the mote.
  */
 
 void api_response_timeout(void) {
+   rspTimeouts_DBG++;
+   DEBUG_PRINT(("T.O. #%d\n", rspTimeouts_DBG));
+
    /* issue cancel command */
    dn_ipmt_cancelTx();
 
@@ -799,10 +1290,15 @@ void api_bindSocket_reply(void)
  *
  * @return  void.
  *
- * Status of the module is obtained once this function executes.
+ * Sets the network ID, reads it back and sets the join duty cycle. The
+ * three commands are issued together, none needs the reply of another,
+ * and the mote works through them in turn. The reply to the last one
+ * decides whether to join or start again.
  *
  * @sa      setCallback().
  * @sa      dn_ipmt_setParameter_networkId().
+ * @sa      api_getNetworkID().
+ * @sa      api_setJoinDutyCycle().
  *
  * @note    NA.
  */
@@ -814,11 +1310,15 @@ void api_setNetworkID(void)
 
    awaiting_response=true;
    delay_count=0;
+   paramSetupFailed=false;
 
    /* issue function */
    dn_ipmt_setParameter_networkId(MANAGER_NETID,
       (dn_ipmt_setParameter_networkId_rpt*)(app_vars.replyBuf)
    );
+
+   api_getNetworkID();
+   api_setJoinDutyCycle();
 }
 
 /**
@@ -847,23 +1347,11 @@ void api_setNetworkID_reply(void)
    reply = (dn_ipmt_getParameter_networkId_rpt*)app_vars.replyBuf;
 
 
-   /* choose next step */
-   switch (reply->RC)
-   {
-      case RC_OK:
-           awaiting_response=false;
-           delay_count=0;
-           Flag_Check=Get_NetID;
-           MoteStatus = Getting_Param;
-           break;
-
-      default:
-           awaiting_response=false;
-           delay_count=0;
-           Flag_Check=Set_NetID;
-           scheduleEvent(&api_setNetworkID);
-           break;
-   }
+   /* the rest of the batch is already with the mote */
+   if (reply->RC == RC_OK)
+       MoteStatus = Getting_Param;
+   else
+       paramSetupFailed = true;
 }
 /*=========================== getNetworkID ===================================*/
 /**
@@ -923,23 +1411,11 @@ void api_getNetworkID_reply(void)
    /*Save the network ID parameter*/
    NET_ID = reply->networkId;
 
-   /* choose next step */
-   switch (reply->RC)
-   {
-      case RC_OK:
-           awaiting_response=false;
-           delay_count=0;
-           Flag_Check=Set_JoinDC;
-           MoteStatus = Setting_Param;
-           break;
-
-      default:
-           awaiting_response=false;
-           delay_count=0;
-           Flag_Check=Get_NetID;
-           scheduleEvent(&api_getNetworkID);
-           break;
-   }
+   /* setJoinDutyCycle follows */
+   if (reply->RC == RC_OK)
+       MoteStatus = Setting_Param;
+   else
+       paramSetupFailed = true;
 }
 
 /*=========================== setJoinDutyCycle ===================================*/
@@ -995,21 +1471,19 @@ void api_setJoinDutyCycle_reply(void)
    reply = (dn_ipmt_setParameter_joinDutyCycle_rpt*)app_vars.replyBuf;
 
 
-   /* choose next step */
-   switch (reply->RC)
+   /* choose next step, the last of the parameter setup batch */
+   if ((reply->RC == RC_OK) && !paramSetupFailed)
    {
-      case RC_OK:
-           awaiting_response=false;
-           delay_count=0;
-           Flag_Check=Join;
-           break;
-
-      default:
-           awaiting_response=false;
-           delay_count=0;
-           Flag_Check=Set_JoinDC;
-           scheduleEvent(&api_setJoinDutyCycle);
-           break;
+       awaiting_response=false;
+       delay_count=0;
+       Flag_Check=Join;
+   }
+   else
+   {
+       awaiting_response=false;
+       delay_count=0;
+       Flag_Check=Set_NetID;
+       scheduleEvent(&api_setNetworkID);
    }
 }
 
@@ -1170,25 +1644,362 @@ void api_requestService_reply(void)
 #define Z_AXIS 0xFFC0
 
 static uint8_t* pByteBuf;
+static uint8_t* pPageEnd;        // End of the flash page being sent
 static uint32_t numBytesLeft;
 
+/* Frame info packets, sent before the data of a frame when pending. The
+ * jitter record doesn't fit with the others and has a packet of its own */
+#ifdef SAMP_JITTER_PROFILING
+#define FRAME_INFO_PARTS          2u
+#else
+#define FRAME_INFO_PARTS          1u
+#endif
 
-/*=========================== startTx ========================================*/
-/**
- * @brief    This function begins the transmission of the ADC data buffers.
- *
- * @param   void.
- *
- * @return  void.
- *
- * startTx manages which axis (X,Y or Z) will transmitted first based on axis_info
- * variable, and begins transmission by flagging txRun.
- *
- * @note    Function also sets numBytesLeft, a variable which keeps track of
- * bytes left for sending in a buffer.
- */
+static uint8_t  frameInfo[FRAME_INFO_PARTS][FRAME_INFO_MAX_LEN];
+static uint8_t  frameInfoLen[FRAME_INFO_PARTS];
+static uint8_t  frameInfoPart    = 0;       /* Next of the packets to send */
+static bool     frameInfoPending = false;
+static bool     frameInfoFirst   = false;   /* Info of the frame ending, goes ahead of its end */
+static uint16_t frameInfoCorrupt = 0;       /* Corrupt pages of the axis the info said */
+
+/* A frame of the longest capture, compressed as badly as it can be and with
+ * its spectrum page, must be in reach of the offset of the data packets */
+#if (TX_FRAME_MAX_PAGES * FLASH_PAGE_SIZE_B + 2u) > FRAME_V2_MAX_BYTES
+#error The frames of the longest capture are too long for their offsets
+#endif
 
-void startTx(bool include_hdr, axis_t axis_tx)
+/* Frame v2 framing of the data. The CRC and offset only count bytes the
+ * mote has accepted */
+static uint8_t  txDataHdr[FRAME_V2_DATA_HDR_B];   /* The data itself is sent from pByteBuf */
+static uint8_t  txEndPacket[FRAME_V2_END_LEN];
+static uint8_t  txFrameId     = 0;
+static uint8_t  txSendId      = 0;       /* Frame ID in the data packets, an earlier one's when sent again */
+static axis_t   txFrameAxis;
+static uint32_t txFrameOffset = 0;
+static uint32_t txFrameCrc    = 0;
+static bool     txFrameLast   = false;   /* The frame ends with the data of this startTx */
+static bool     txEndPending  = false;
+static bool     txDataDone    = false;   /* All the data of this startTx has been accepted */
+
+
+/* Little endian writers for frame info fields, to match the sample data */
+static uint8_t* putU16(uint8_t* p, uint16_t val)
+{
+    *p++ = (uint8_t)(val);
+    *p++ = (uint8_t)(val >> 8);
+    return p;
+}
+
+static uint8_t* putU32(uint8_t* p, uint32_t val)
+{
+    p = putU16(p, (uint16_t)(val));
+    p = putU16(p, (uint16_t)(val >> 16));
+    return p;
+}
+
+
+/* Start a frame info record. The length byte is filled in by endRecord */
+static uint8_t* startRecord(uint8_t* p, uint8_t type)
+{
+    *p++ = type;
+    *p++ = 0;
+    return p;
+}
+
+static uint8_t* endRecord(uint8_t* pStart, uint8_t* p)
+{
+    *(pStart - 1) = (uint8_t)(p - pStart);
+    return p;
+}
+
+
+/* Start a frame info packet, the records follow the magic */
+static uint8_t* startInfo(uint8_t* p)
+{
+    *p++ = FRAME_INFO_MAGIC_0;
+    *p++ = FRAME_INFO_MAGIC_1;
+    *p++ = FRAME_INFO_MAGIC_2;
+    return p;
+}
+
+
+/*=========================== buildFrameInfo =================================*/
+/**
+ * @brief    Builds the frame info packets that precede a frame.
+ *
+ * @param   axis  Axis of the frame that follows.
+ *
+ * @return  void.
+ *
+ * Layout (little endian):
+ *  | FE ED CB | records... |
+ *
+ * Capture record, always sent:
+ *  | 03 | 12 | plan entry (1) | plan entries, 0 if no plan (1) | rate Hz (4) |
+ *  | samples (4) | axes (1) | processing (1) |
+ *
+ * Frame record, always sent. The capture ID is the archive seq, or
+ * FRAME_NO_CAPTURE_ID. Encoding is FRAME_ENC_MASK bits:
+ *  | 07 | 15 | frame ID (1) | capture ID (4) | axis (1) | encoding (1) |
+ *  | rate Hz (4) | samples (4) |
+ *
+ * Archive record, when the capture is in the archive:
+ *  | 05 | 9 | seq (4) | RTC time s (4) | flags (1) |
+ *
+ * Flash writer record, when the capture was stored in flash:
+ *  | 04 | 13 | pages (4) | overruns (2) | max queue depth (1) |
+ *  | busy us per page (2) | max sustainable rate Hz (4) |
+ *
+ * Flash read record, once pages have been read back from the archive.
+ * Corrupt pages are those of the axis of the frame that have failed their
+ * CRC or ECC check after every retry so far. Pages are checked as they are
+ * read, so if more fail the info is sent again ahead of the end of the
+ * frame. The rest count all reads since power up:
+ *  | 06 | 12 | corrupt pages in frame (2) | pages read (4) |
+ *  | ECC corrected (2) | retries (2) | corrupt (2) |
+ *
+ * Auxiliary telemetry record, always sent:
+ *  | 02 | 7 | vbat mV (2) | die temp 0.01C (2) | sensor temp 0.01C (2) |
+ *  | valid flags (1) |
+ *
+ * Jitter record, only when SAMP_JITTER_PROFILING is defined. It goes in a
+ * second info packet of its own, | FE ED CB | 01 | ... |, right after the
+ * first:
+ *  | 01 | 36 | period_us (4) | samples (4) | missed (4) | late (4) |
+ *  | max latency us (4) | histogram (2 * SAMP_JITTER_HIST_BINS) |
+ */
+static void buildFrameInfo(axis_t axis)
+{
+    const adc_aux_t*          aux     = getAdcAux();
+    const plan_entry_t*       capture = planCurrentCapture();
+    const flash_wr_stats_t*   wrStats = getFlashWrStats();
+    const arch_rec_t*         arch    = archCurrentRecord();
+    const arch_check_stats_t* chk     = getArchCheckStats();
+    uint8_t  axisMask = (uint8_t)(1u << axis);
+    uint8_t  encoding;
+    uint8_t* p = frameInfo[0];
+    uint8_t* pRec;
+
+    frameInfoCorrupt = 0;
+
+    if (arch != NULL)
+        encoding = arch->flags & FRAME_ENC_MASK;
+    else
+        encoding = calIsValid() ? FRAME_ARCH_FLAG_CALIBRATED : 0;
+
+    p = startInfo(p);
+
+    p = pRec = startRecord(p, FRAME_INFO_TYPE_CAPTURE);
+    *p++ = planCaptureIdx();
+    *p++ = planNumEntries();
+    p = putU32(p, capture->sampFreq);
+    p = putU32(p, capture->numSamples);
+    *p++ = capture->axisInfo;
+    *p++ = capture->proc;
+    p = endRecord(pRec, p);
+
+    p = pRec = startRecord(p, FRAME_INFO_TYPE_FRAME);
+    *p++ = txFrameId;
+    p = putU32(p, (arch != NULL) ? arch->seq : FRAME_NO_CAPTURE_ID);
+    *p++ = (uint8_t)axis;
+    *p++ = encoding;
+    p = putU32(p, capture->sampFreq);
+    p = putU32(p, capture->numSamples);
+    p = endRecord(pRec, p);
+
+    if (arch != NULL)
+    {
+        p = pRec = startRecord(p, FRAME_INFO_TYPE_ARCHIVE);
+        p = putU32(p, arch->seq);
+        p = putU32(p, arch->timestamp);
+        *p++ = arch->flags | (archIsReplay() ? FRAME_ARCH_FLAG_REPLAY : 0);
+        p = endRecord(pRec, p);
+    }
+
+    if (!archIsReplay() && (wrStats->pagesWritten > 0))
+    {
+        p = pRec = startRecord(p, FRAME_INFO_TYPE_FLASH_WR);
+        p = putU32(p, wrStats->pagesWritten);
+        p = putU16(p, wrStats->overruns);
+        *p++ = wrStats->maxQueueDepth;
+        p = putU16(p, (uint16_t)flashWrPageTime_us());
+        p = putU32(p, flashWrMaxRate_Hz());
+        p = endRecord(pRec, p);
+    }
+
+    if ((arch != NULL) && (chk->pagesRead > 0))
+    {
+        frameInfoCorrupt = archCorruptPages(axisMask);
+        p = pRec = startRecord(p, FRAME_INFO_TYPE_FLASH_RD);
+        p = putU16(p, frameInfoCorrupt);
+        p = putU32(p, chk->pagesRead);
+        p = putU16(p, chk->corrected);
+        p = putU16(p, chk->retries);
+        p = putU16(p, chk->corrupt);
+        p = endRecord(pRec, p);
+    }
+
+    p = pRec = startRecord(p, FRAME_INFO_TYPE_AUX);
+    p = putU16(p, aux->vbat_mV);
+    p = putU16(p, (uint16_t)aux->dieTemp_cC);
+    p = putU16(p, (uint16_t)aux->sensTemp_cC);
+    *p++ = aux->valid;
+    p = endRecord(pRec, p);
+
+    frameInfoLen[0] = (uint8_t)(p - frameInfo[0]);
+
+#ifdef SAMP_JITTER_PROFILING
+#if (3u + 2u + 5u * 4u + 2u * SAMP_JITTER_HIST_BINS) > FRAME_INFO_MAX_LEN
+#error The jitter record is too long for a frame info packet
+#endif
+    const samp_jitter_t* jitter = getSampJitter();
+
+    p = startInfo(frameInfo[1]);
+    p = pRec = startRecord(p, FRAME_INFO_TYPE_JITTER);
+    p = putU32(p, jitter->period_us);
+    p = putU32(p, jitter->numSamples);
+    p = putU32(p, jitter->numMissed);
+    p = putU32(p, jitter->numLate);
+    p = putU32(p, jitter->maxLatency_us);
+    for (uint8_t i = 0; i < SAMP_JITTER_HIST_BINS; i++)
+        p = putU16(p, jitter->hist[i]);
+    p = endRecord(pRec, p);
+
+    frameInfoLen[1] = (uint8_t)(p - frameInfo[1]);
+#endif
+
+    frameInfoPart    = 0;
+    frameInfoPending = true;
+}
+
+
+/* Axis of the sample array being sent when the capture is in RAM */
+static axis_t ramTxAxis(void)
+{
+    if (pByteBuf == (uint8_t*)adcDataY)
+        return y_active;
+    if (pByteBuf == (uint8_t*)adcDataZ)
+        return z_active;
+    return x_active;
+}
+
+
+/* A new frame begins, its info goes out ahead of its data */
+static void txFrameStart(axis_t axis)
+{
+    txFrameId++;
+    txSendId      = txFrameId;
+    txFrameAxis   = axis;
+    txFrameOffset = 0;
+    txFrameCrc    = 0;
+    buildFrameInfo(axis);
+
+    if (txNumFrames < FRAME_RETAIN_MAX)
+        txFrames[txNumFrames].nPages = 0;
+}
+
+
+/* A flash page of the frame is sent from the offset reached */
+static void txFramePage(void)
+{
+    tx_frame_t* frame = &txFrames[txNumFrames];
+
+    if ((txNumFrames < FRAME_RETAIN_MAX) && (frame->nPages < TX_FRAME_MAX_PAGES))
+        frame->pageStart[frame->nPages++] = txFrameOffset;
+}
+
+
+/* All the data of the frame has been accepted, close it with its length
+ * and CRC */
+static void txFrameEnd(void)
+{
+    uint8_t* p = txEndPacket;
+
+    *p++ = FRAME_V2_END;
+    *p++ = txFrameId;
+    p = putU32(p, txFrameOffset);
+    putU32(p, txFrameCrc);
+    txEndPending = true;
+
+    // Pages of the frame that failed their check once its info had gone
+    if ((archCurrentRecord() != NULL) && (archCorruptPages((uint8_t)(1u << txFrameAxis)) != frameInfoCorrupt))
+    {
+        buildFrameInfo(txFrameAxis);
+        frameInfoFirst = true;
+    }
+
+    // Kept in case the manager misses any of it
+    if (txNumFrames < FRAME_RETAIN_MAX)
+    {
+        txFrames[txNumFrames].id       = txFrameId;
+        txFrames[txNumFrames].axis     = txFrameAxis;
+        txFrames[txNumFrames].numBytes = txFrameOffset;
+        txFrames[txNumFrames].complete = false;
+        txNumFrames++;
+    }
+}
+
+
+/* Streaming state. The credit is held as the last frame ID it covers, so a
+ * grant that is repeated or overtaken by a later one changes nothing */
+static bool    streamOn    = false;
+static uint8_t streamLimit = 0;
+
+/* The manager has granted credit for v[0] frames past frame v[1], or past the
+ * last frame started when there is no v[1]. No frames at all ends streaming */
+static void streamGrant(const uint8_t* v, uint8_t vLen)
+{
+    uint8_t frames = (v[0] > STREAM_MAX_CREDIT) ? STREAM_MAX_CREDIT : v[0];
+    uint8_t limit  = (uint8_t)(((vLen >= 2) ? v[1] : txFrameId) + frames);
+
+    if (frames == 0)
+    {
+        streamOn = false;
+        return;
+    }
+
+    // Frame IDs wrap, a grant behind the one held is an old one arriving late
+    if (!streamOn || (vLen < 2) || ((int8_t)(limit - streamLimit) > 0))
+        streamLimit = limit;
+
+    streamOn = true;
+}
+
+
+/* First word of a frame. The axis goes in the top byte, all ones to mark
+ * the start, and the version in the bottom four bits */
+uint16_t frameHeaderWord(axis_t axis)
+{
+    switch (axis)
+    {
+       case y_active: return Y_AXIS | int_version;
+       case z_active: return Z_AXIS | int_version;
+       default:       return X_AXIS | int_version;
+    }
+}
+
+
+/*=========================== startTx ========================================*/
+/**
+ * @brief    This function begins the transmission of the ADC data buffers.
+ *
+ * @param   include_hdr  Send the axis header and frame info ahead of the data.
+ * @param   axis_tx      Axis of the flash page being sent.
+ * @param   page         Buffer the flash page was read into, its first
+ *                       location is for the header. Only used with the flash.
+ * @param   end_frame    The flash page is the last of its axis, the frame
+ *                       ends with it. Each axis ends its own frame in RAM.
+ *
+ * @return  void.
+ *
+ * startTx manages which axis (X,Y or Z) will transmitted first based on axis_info
+ * variable, and begins transmission by flagging txRun.
+ *
+ * @note    Function also sets numBytesLeft, a variable which keeps track of
+ * bytes left for sending in a buffer.
+ */
+
+void startTx(bool include_hdr, axis_t axis_tx, uint16_t *page, bool end_frame)
 { 
     
     DEBUG_PRINT(("Starting TX\n"));
@@ -1198,22 +2009,13 @@ void startTx(bool include_hdr, axis_t axis_tx)
     // at the start of the 1st page of data
     if (!ext_flash_needed)
     {
-        // Give the first four bits in the 2nd byte in the header the axis info
-        // (The first byte in the header is all ones)
-        adcDataX[0] = X_AXIS;
-        adcDataY[0] = Y_AXIS;
-        adcDataZ[0] = Z_AXIS;
-
-        uint16_t version_bits = int_version;
-
-        // Give the last 4 bits in the 2nd byte of the header the version info
-        adcDataX[0] |= version_bits;
-        adcDataY[0] |= version_bits;
-        adcDataZ[0] |= version_bits;
+        adcDataX[0] = frameHeaderWord(x_active);
+        adcDataY[0] = frameHeaderWord(y_active);
+        adcDataZ[0] = frameHeaderWord(z_active);
     
         // Select where pointer should start from based on which axes are enabled
 
-        switch(axis_info)
+        switch(planCurrentCapture()->axisInfo)
         {
             case XYZ:
             case XY:
@@ -1235,40 +2037,38 @@ void startTx(bool include_hdr, axis_t axis_tx)
     }
     else
     {
-        // If ext flash is needed then the adcDataX array shall 
-        // be used for all tranmissions of data
-        pByteBuf = (uint8_t*) adcDataX;
+        // If ext flash is needed each page is sent from the buffer it was
+        // read into. The main loop reads the next page into another buffer
+        // while this one is being sent
+        pByteBuf = (uint8_t*) page;
 
         // Check if header needs to be included. When using flash, the data will be
         // TXd 1 page at a time... The header should only be included 
         // at the start of the 1st page of data
         if (include_hdr)
         {
-          // Give the first four bits in the 2nd byte in the header the axis info
-          // (The first byte in the header is all ones)
-          switch (axis_tx)
-          {
-             case x_active : adcDataX[0] = X_AXIS;
-                             break;
-             case y_active : adcDataX[0] = Y_AXIS; 
-                             break;
-             case z_active : adcDataX[0] = Z_AXIS; 
-                             break;
-          }
-
-          uint16_t version_bits = int_version;
-
-          // Give the last 4 bits in the 2nd byte of the header the version info
-          adcDataX[0] |= version_bits;
+          page[0] = frameHeaderWord(axis_tx);
        }
        else
        {
-           // Start sending out from the second location of adcDataX (starting at 3rd byte)
+           // Start sending out from the second location of the page (starting at 3rd byte)
            pByteBuf += 2; 
            ADC_DATA_SIZE -= 4;
        }
+
+       pPageEnd = (uint8_t*) page + ADC_DATA_SIZE;
     }
 
+    // A header starts a new frame
+    if (include_hdr)
+        txFrameStart(ext_flash_needed ? axis_tx : ramTxAxis());
+    if (ext_flash_needed)
+        txFramePage();
+
+    txFrameLast = end_frame;
+    txDataDone  = false;
+    txRetxRun   = false;
+
     //DEBUG_PRINT(("%x%x\n", *pByteBuf, *(pByteBuf+1)));
     // ADC_DATA_SIZE will be updated after each time the data is fetched from flash
     numBytesLeft = ADC_DATA_SIZE;
@@ -1278,87 +2078,174 @@ void startTx(bool include_hdr, axis_t axis_tx)
     finalAck = 0;
 }
 
-int txRunning(void)
+/*=========================== startRetx ======================================*/
+/**
+ * @brief    Sends a range of a frame kept from the capture again.
+ *
+ * @param   data       Where the bytes of the range are held.
+ * @param   numBytes   Bytes to send.
+ * @param   offset     Offset of the first of them in the frame.
+ *
+ * @return  void.
+ *
+ * The packets carry the ID of the frame of the range at the head of the
+ * queue, see txRetxNext(). They go out as data packets of that frame, so the
+ * manager puts them in place like any other.
+ */
+void startRetx(const uint8_t *data, uint32_t numBytes, uint32_t offset)
 {
-    return txRun;
+    txSendId      = txFrames[txRetx[txRetxHead].frame].id;
+    txFrameOffset = offset;
+    pByteBuf      = (uint8_t*) data;
+    numBytesLeft  = numBytes;
+    txRetxRun     = true;
+    txDataDone    = false;
+    txRun         = 1;
+    finalAck      = 0;
 }
 
-int gotFinalAck(void)
+
+/* The range the manager asked for that is to be sent next. False if none */
+bool txRetxNext(axis_t *axis, uint32_t *offset, uint32_t *numBytes)
 {
-    return finalAck;
+    const tx_retx_t* retx = &txRetx[txRetxHead];
+
+    if (txRetxCount == 0)
+        return false;
+
+    *axis     = txFrames[retx->frame].axis;
+    *offset   = retx->offset;
+    *numBytes = retx->numBytes;
+    return true;
 }
 
 
-/*=========================== sendTo =========================================*/
-/**
- * @brief    This function handles the transmission of data packets to a ipv6 address.
- *
- * @param   void.
- *
- * @return  void.
- *
- * api_sendTo function handles the transmission of data packets to a ipv6 address.
- * here the address is of the manager.
- *
- * @sa      setCallback().
- * @sa      api_sendTo().
- * @sa      memcpy().
- *
- * @note    Data is sent to the manager.Destination and source ports are mentioned in the api_ports section
- *          of the #defines and the packet ID submitted does not require transmission done acknowledgement.
- */
-uint32_t packets_sent = 0;
-uint32_t packets_ackd = 0;
-void api_sendTo(void)
+/* The flash page of the frame of the next range that offset is in, by its
+ * index in the frame, with the frame offset it was sent from and the bytes
+ * sent from it. False if the offset is past the pages kept */
+bool txRetxPage(uint32_t offset, uint16_t *page, uint32_t *pageStart, uint32_t *pageBytes)
 {
-    uint8_t numBytes;
+    const tx_frame_t* frame = &txFrames[txRetx[txRetxHead].frame];
+    uint16_t lo = 0;
+    uint16_t hi = frame->nPages;
+    uint16_t mid;
 
-    /* Setting txRun and txPacketDone from another function will cause this
-     * function to send data via the SmartMesh
-     * txPacketDone is set to 1 when CMDID_TXDONE */
-    if (!txRun || !txPacketDone)
-        return;
+    if ((txRetxCount == 0) || (frame->nPages == 0) || (offset >= frame->numBytes))
+        return false;
+
+    // The last page starting at or before the offset
+    while (hi - lo > 1u)
+    {
+        mid = (lo + hi) / 2u;
+        if (frame->pageStart[mid] <= offset)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    *page      = lo;
+    *pageStart = frame->pageStart[lo];
+    *pageBytes = ((lo + 1u < frame->nPages) ? frame->pageStart[lo + 1u] : frame->numBytes) - *pageStart;
+    return true;
+}
+
+
+/* Bytes from the start of the next range that have been sent again. It is
+ * done with once all have, or at once if numBytes is 0 */
+void txRetxDone(uint32_t numBytes)
+{
+    tx_retx_t* retx = &txRetx[txRetxHead];
 
+    if (txRetxCount == 0)
+        return;
 
-    if (numBytesLeft > MAX_PAYLOAD_SIZE)
-        numBytes = MAX_PAYLOAD_SIZE;
+    if ((numBytes == 0) || (numBytes >= retx->numBytes))
+    {
+        txRetxHead = (txRetxHead + 1u) % FRAME_RETX_MAX_RANGES;
+        txRetxCount--;
+    }
     else
-        numBytes = (uint8_t) numBytesLeft;
+    {
+        retx->offset   += numBytes;
+        retx->numBytes -= numBytes;
+    }
+}
 
-    setCallback(api_sendTo_reply);
-    awaiting_response=true;
-    txPacketDone = 0;
 
-    dn_ipmt_sendTo(
-            app_vars.socketId,                                  /* socketId */
-            (uint8_t*) ipv6Addr_manager,                        /* destIP */
-            DST_PORT,                                           /* destPort */
-            SERVICE_TYPE_BW,                                    /* serviceType */
-            MED_PRIORITY,                                       /* priority */
-            0xBEEF,                                             /* packetId */
-            pByteBuf,                                           /* payload */
-            numBytes,                                           /* payloadLen */
-            (dn_ipmt_sendTo_rpt*)(app_vars.replyBuf)            /* reply */
-    );
+/* True once the manager has said it has every frame kept */
+bool txFramesAcked(void)
+{
+    for (uint8_t i = 0; i < txNumFrames; i++)
+        if (!txFrames[i].complete)
+            return false;
+
+    return true;
+}
+
+
+/* The frames kept are done with, ranges still asked for are dropped */
+void txFramesRelease(void)
+{
+    txNumFrames = 0;
+    txRetxHead  = 0;
+    txRetxCount = 0;
+}
+
 
-    // Toggle green LED
-    adi_gpio_Toggle(ADI_GPIO_PORT1, ADI_GPIO_PIN_12);
+int txRunning(void)
+{
+    return txRun;
+}
+
+int gotFinalAck(void)
+{
+    return finalAck;
+}
+
+/* True once the mote has sent every data packet it was given */
+bool txAllDone(void)
+{
+    return txInFlight == 0;
+}
+
+
+uint32_t packets_sent = 0;
+uint32_t packets_ackd = 0;
+
+/* The mote has accepted a packet of numBytes of data, move on to the next */
+static void txAdvance(uint8_t numBytes)
+{
+    txFrameCrc     = flashCrc32(txFrameCrc, pByteBuf, numBytes);
+    txFrameOffset += numBytes;
 
     pByteBuf += numBytes;
     numBytesLeft -= numBytes;
 
+    // A range sent again has no frame to move on to
+    if (txRetxRun)
+    {
+        if (numBytesLeft == 0)
+        {
+            txRetxRun  = false;
+            txDataDone = true;
+        }
+        return;
+    }
+
     /* Decide if all data has been transmitted and move pointer if necessary*/
     if (!ext_flash_needed)
     {
         if (numBytesLeft <= 0)
         {
-            // If all of a particular axis' data has been sent
+            // If all of a particular axis' data has been sent. Each
+            // axis is a frame of its own
             numBytesLeft = ADC_DATA_SIZE;
+            txFrameEnd();
 
             if(pByteBuf == (uint8_t*)adcDataX+ADC_DATA_SIZE)
             {
                 // X data transmission finished
-                switch(axis_info)
+                switch(planCurrentCapture()->axisInfo)
                 {
                     // Y data is next
                     case XYZ:
@@ -1375,7 +2262,7 @@ void api_sendTo(void)
 
                     // All data sent
                     case X:
-                        txRun = 0;
+                        txDataDone = true;
                         packets_sent = 0;
                         break;
                 }
@@ -1383,7 +2270,7 @@ void api_sendTo(void)
             else if(pByteBuf == (uint8_t*)adcDataY+ADC_DATA_SIZE)
             {
                 // Y data transmission finished
-                switch(axis_info)
+                switch(planCurrentCapture()->axisInfo)
                 {
                     // Z data is next
                     case XYZ:
@@ -1395,7 +2282,7 @@ void api_sendTo(void)
                     // All data sent
                     case XY:
                     case Y:
-                        txRun = 0;
+                        txDataDone = true;
                         packets_sent = 0;
                         break;
                 }
@@ -1403,9 +2290,12 @@ void api_sendTo(void)
             else if(pByteBuf == (uint8_t*)adcDataZ+ADC_DATA_SIZE)
             {
                 // All data sent
-                txRun = 0;
+                txDataDone = true;
                 packets_sent = 0;
             }
+
+            if (!txDataDone)
+                txFrameStart(ramTxAxis());
         } 
         else
         {
@@ -1414,10 +2304,13 @@ void api_sendTo(void)
     }
     else
     {
-        // Flash is needed... adcDataX is the only array used for sending data in this case
-        if(pByteBuf >= (uint8_t*)adcDataX+ADC_DATA_SIZE)
+        // Flash is needed... a single page is sent at a time
+        if(pByteBuf >= pPageEnd)
         {
-            txRun = 0;
+            if (txFrameLast)
+                txFrameEnd();
+
+            txDataDone = true;
             packets_sent = 0;
         }
         else
@@ -1426,6 +2319,138 @@ void api_sendTo(void)
         }
 
     }
+}
+
+
+/*=========================== sendTo =========================================*/
+/**
+ * @brief    This function handles the transmission of data packets to a ipv6 address.
+ *
+ * @param   void.
+ *
+ * @return  void.
+ *
+ * api_sendTo function handles the transmission of data packets to a ipv6 address.
+ * here the address is of the manager.
+ *
+ * Up to TX_WINDOW_PACKETS packets are kept queued in the mote. The next one
+ * is sent as soon as the reply to the last has come back, without waiting
+ * for its TXDONE, so the mote always has a packet ready for its next slot.
+ * Each packet has its own packet ID, which the TXDONE notification returns
+ * to take it out of the window.
+ *
+ * Data goes out as frame v2 packets, each with the offset of its bytes in
+ * the frame, and the frame ends with a packet of its length and CRC. The
+ * manager places the packets by offset and only asks for the gaps.
+ *
+ * The packet to send is chosen again every time, highest class first:
+ * queued events and the ready message, then status messages and frame
+ * info, then the frame data. The class also sets the mesh priority, so the
+ * mote sends them ahead of the data it already holds.
+ *
+ * The data packet header and the sample bytes are passed to the serial
+ * layer as separate parts, which encodes them straight into the frame the
+ * UART DMA sends.
+ *
+ * @sa      setCallback().
+ * @sa      api_sendTo().
+ * @sa      txQueueMsg().
+ * @sa      dn_ipmt_sendToSegs().
+ *
+ * @note    Data is sent to the manager.Destination and source ports are mentioned in the api_ports section
+ *          of the #defines.
+ */
+void api_sendTo(void)
+{
+    dn_serial_seg_t segs[2];
+    uint8_t  numSegs = 1;
+    uint8_t  numBytes = 0;
+    uint8_t  cls;
+    tx_pkt_t kind;
+    tx_msg_t *msg;
+
+    /* Setting txRun from another function will cause this function to send
+     * data via the SmartMesh, queued messages go whether it is set or not.
+     * A mote that has run out of buffers holds everything back until a
+     * TXDONE or the backoff, a full window all but the high class */
+    if (txMoteFull)
+        return;
+
+    if ((txMsgCount[TX_CLASS_HIGH] > 0) && (txInFlight < TX_WINDOW_PACKETS + 1u))
+        cls = TX_CLASS_HIGH;
+    else if (txInFlight >= TX_WINDOW_PACKETS)
+        return;
+    else if ((txMsgCount[TX_CLASS_MED] > 0) || (txRun && frameInfoPending && (!txEndPending || frameInfoFirst)))
+        cls = TX_CLASS_MED;
+    else if (txRun)
+        cls = TX_CLASS_LOW;
+    else
+        return;
+
+    if ((cls != TX_CLASS_LOW) && (txMsgCount[cls] > 0))
+    {
+        msg        = &txMsgs[cls][txMsgHead[cls]];
+        kind       = TX_PKT_MSG;
+        segs[0].data = msg->data;
+        segs[0].len  = msg->len;
+    }
+    /* The end of a frame goes before the info of the next, but after its own */
+    else if (txEndPending && !frameInfoFirst)
+    {
+        kind       = TX_PKT_END;
+        segs[0].data = txEndPacket;
+        segs[0].len  = FRAME_V2_END_LEN;
+    }
+    else if (frameInfoPending)
+    {
+        kind       = TX_PKT_INFO;
+        segs[0].data = frameInfo[frameInfoPart];
+        segs[0].len  = frameInfoLen[frameInfoPart];
+    }
+    else
+    {
+        if (numBytesLeft > MAX_PAYLOAD_SIZE - FRAME_V2_DATA_HDR_B)
+            numBytes = MAX_PAYLOAD_SIZE - FRAME_V2_DATA_HDR_B;
+        else
+            numBytes = (uint8_t) numBytesLeft;
+
+        txDataHdr[0] = FRAME_V2_DATA;
+        txDataHdr[1] = txSendId;
+        txDataHdr[2] = (uint8_t)(txFrameOffset);
+        txDataHdr[3] = (uint8_t)(txFrameOffset >> 8);
+        txDataHdr[4] = (uint8_t)(txFrameOffset >> 16);
+
+        kind         = TX_PKT_DATA;
+        segs[0].data = txDataHdr;
+        segs[0].len  = FRAME_V2_DATA_HDR_B;
+        segs[1].data = pByteBuf;
+        segs[1].len  = numBytes;
+        numSegs      = 2;
+
+        // Toggle green LED
+        adi_gpio_Toggle(ADI_GPIO_PORT1, ADI_GPIO_PIN_12);
+    }
+
+    txPendingId    = txNextId;
+    txPendingLen   = numBytes;
+    txPendingKind  = kind;
+    txPendingClass = cls;
+    txNextId       = (txNextId + 1u) & TX_PACKET_ID_MASK;
+
+    setCallback(api_sendTo_reply);
+    awaiting_response=true;
+
+    dn_ipmt_sendToSegs(
+            app_vars.socketId,                                  /* socketId */
+            (uint8_t*) ipv6Addr_manager,                        /* destIP */
+            DST_PORT,                                           /* destPort */
+            SERVICE_TYPE_BW,                                    /* serviceType */
+            txClassPriority[cls],                               /* priority */
+            txPendingId,                                        /* packetId */
+            segs,                                               /* payload */
+            numSegs,                                            /* numSegs */
+            (dn_ipmt_sendTo_rpt*)(app_vars.replyBuf)            /* reply */
+    );
     //DEBUG_PRINT(("Data Sent. Num Bytes Left: %d\n", numBytesLeft));
 }
 
@@ -1436,7 +2461,8 @@ void api_sendTo(void)
  *
  * @return  void.
  *
- * sendTo reply processed here.
+ * sendTo reply processed here. Once the mote has accepted the packet it
+ * joins the window and the data moves on, otherwise it is sent again.
  *
  * @sa      cancelEvent().
  * @sa      scheduleEvent().
@@ -1451,13 +2477,6 @@ void api_sendTo_reply(void)
    /* cancel timeout */
    cancelEvent();
 
-   if (!txRun)
-   {
-     /* Get the final acknowledge before allowing main FSM to move out of TX */
-     finalAck = 1;
-     packets_ackd = 0;
-   }
-
    /* parse reply */
    reply = (dn_ipmt_sendTo_rpt*)app_vars.replyBuf;
 
@@ -1468,14 +2487,66 @@ void api_sendTo_reply(void)
            awaiting_response=false;
            delay_count=0;
            packets_ackd++;
+           txMoteFull = false;
+           txWindowAdd(txPendingId);
+           txPacketDone();
+           break;
+      case RC_NO_RESOURCES:
+           awaiting_response=false;
+           delay_count=0;
+           txMoteFullWait();
            break;
       default:
            awaiting_response=false;
            delay_count=0;
+
+           /* Sent again, up to a point. A frame packet that is given up on
+            * leaves a gap the manager asks for once the frame has ended */
+           if (++txRetries >= TX_SEND_RETRIES)
+           {
+               DEBUG_PRINT(("sendTo refused (%d), packet dropped\n", reply->RC));
+               txDropped_DBG++;
+               txPacketDone();
+           }
            break;
    }
 }
 
+/* The packet waiting on its reply is done with, accepted by the mote or
+ * given up on. The data moves on past it */
+static void txPacketDone(void)
+{
+    txRetries = 0;
+
+    if (txPendingKind == TX_PKT_MSG)
+    {
+        txMsgHead[txPendingClass] = (txMsgHead[txPendingClass] + 1u) % TX_MSG_QUEUE_LEN;
+        txMsgCount[txPendingClass]--;
+    }
+    else if (txPendingKind == TX_PKT_END)
+        txEndPending = false;
+    else if (txPendingKind == TX_PKT_INFO)
+    {
+        /* The info of a frame may take more than one packet */
+        if (++frameInfoPart >= FRAME_INFO_PARTS)
+        {
+            frameInfoPending = false;
+            frameInfoFirst   = false;
+        }
+    }
+    else
+        txAdvance(txPendingLen);
+
+    /* The data is only done with once the end of its frame has gone too */
+    if (txRun && txDataDone && !txEndPending && !frameInfoPending)
+    {
+        /* Get the final acknowledge before allowing main FSM to move out of TX */
+        txRun = 0;
+        finalAck = 1;
+        packets_ackd = 0;
+    }
+}
+
 void api_disconnect(void)
 {
     /* API callback */
@@ -1620,92 +2691,78 @@ void clearMgrReady()
     mgrReady = false;
 }
 
-void sendMgrReady()
+/* True while the manager's credit covers another frame. A capture started on
+ * the last of it still sends a frame for each of its axes */
+bool streamCredit(void)
 {
-    //DEBUG_PRINT(("Send Rdy\n"));
+    return streamOn && ((int8_t)(streamLimit - txFrameId) > 0);
+}
 
-    uint8_t numBytes;
-    numBytes = 4;
-    setCallback(api_readySignal_reply);
-    awaiting_response=true;
-    txPacketDone = 0;
+/* Queue a message to go out at the priority of its class. Returns false if
+ * the class has no room left. It is copied, msg can be reused at once */
+bool txQueueMsg(uint8_t cls, const uint8_t* msg, uint8_t len)
+{
+    tx_msg_t *m;
 
-    uint8_t ackMsg [4];
-    ackMsg[0] = 0xAA;
-    ackMsg[1] = 0xBB;
-    ackMsg[2] = 0xCC;
-    ackMsg[3] = 0xDD;
+    if ((cls >= TX_NUM_CLASSES) || (len > TX_MSG_MAX_LEN) || (txMsgCount[cls] >= TX_MSG_QUEUE_LEN))
+        return false;
 
-    uint8_t *ackPtr;
-    ackPtr = &ackMsg[0];
+    m      = &txMsgs[cls][(txMsgHead[cls] + txMsgCount[cls]) % TX_MSG_QUEUE_LEN];
+    m->len = len;
+    memcpy(m->data, msg, len);
+    txMsgCount[cls]++;
 
-    dn_ipmt_sendTo(
-            app_vars.socketId,                                  /* socketId */
-            (uint8_t*) ipv6Addr_manager,                        /* destIP */
-            DST_PORT,                                           /* destPort */
-            SERVICE_TYPE_BW,                                    /* serviceType */
-            MED_PRIORITY,                                       /* priority */
-            0xBEEF,                                             /* packetId */
-            ackPtr,                                             /* payload */
-            numBytes,                                           /* payloadLen */
-            (dn_ipmt_sendTo_rpt*)(app_vars.replyBuf)            /* reply */
-    );
+    return true;
 }
 
-void api_readySignal_reply(void)
+/* Tell the manager something has gone wrong, ahead of any data */
+bool txQueueEvent(uint8_t event, uint32_t value)
 {
-   dn_ipmt_sendTo_rpt* reply;
+    uint8_t msg[EVENT_LEN];
 
-   /* cancel timeout */
-   cancelEvent();
+    msg[0] = EVENT_MAGIC;
+    msg[1] = event;
+    putU32(&msg[2], value);
 
-   /* parse reply */
-   reply = (dn_ipmt_sendTo_rpt*)app_vars.replyBuf;
+    return txQueueMsg(TX_CLASS_HIGH, msg, EVENT_LEN);
+}
 
-   /* choose next step */
-   switch (reply->RC)
-   {
-      case RC_OK:
-           awaiting_response=false;
-           delay_count=0;
-           break;
-      default:
-           awaiting_response=false;
-           scheduleEvent(&sendMgrReady);  /* Send api_getServiceInfo request again */
-           delay_count=0;
-           break;
-   }
+bool txMsgsQueued(void)
+{
+    return (txMsgCount[TX_CLASS_HIGH] + txMsgCount[TX_CLASS_MED] + txMsgCount[TX_CLASS_LOW]) > 0;
+}
+
+/* Called every timer tick while waiting on the manager. Only one ready
+ * message is queued at a time, one the mote refused stays queued until
+ * it is taken */
+void sendMgrReady()
+{
+    //DEBUG_PRINT(("Send Rdy\n"));
+
+    uint8_t ackMsg [5];
+
+    if (txMsgCount[TX_CLASS_HIGH] > 0)
+        return;
+
+    ackMsg[0] = 0xAA;
+    ackMsg[1] = 0xBB;
+    ackMsg[2] = 0xCC;
+    ackMsg[3] = 0xDD;
+    ackMsg[4] = calIsValid() ? READY_FLAG_CALIBRATED : 0x00;
+
+    txQueueMsg(TX_CLASS_HIGH, ackMsg, sizeof(ackMsg));
 }
 
 
 void sendMsg(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
 {
-    uint8_t numBytes;
-    numBytes = 4;
-    setCallback(api_readySignal_reply);
-    awaiting_response=true;
-    txPacketDone = 0;
-
     uint8_t ackMsg [4];
     ackMsg[0] = a;
     ackMsg[1] = b;
     ackMsg[2] = c;
     ackMsg[3] = d;
 
-    uint8_t *ackPtr;
-    ackPtr = &ackMsg[0];
-
-    dn_ipmt_sendTo(
-            app_vars.socketId,                                  /* socketId */
-            (uint8_t*) ipv6Addr_manager,                        /* destIP */
-            DST_PORT,                                           /* destPort */
-            SERVICE_TYPE_BW,                                    /* serviceType */
-            MED_PRIORITY,                                       /* priority */
-            0xBEEF,                                             /* packetId */
-            ackPtr,                                             /* payload */
-            numBytes,                                           /* payloadLen */
-            (dn_ipmt_sendTo_rpt*)(app_vars.replyBuf)            /* reply */
-    );
+    txQueueMsg(TX_CLASS_MED, ackMsg, sizeof(ackMsg));
 }
 
 void sendStartingTx()
@@ -0,0 +1,157 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+
+/*!
+* @file      calibration.c
+* @brief     Per-mote accelerometer calibration
+*
+* @details
+*            The calibration holds an offset for each axis and a 3x3 matrix
+*            that combines gain and cross-axis correction. It is kept in page 0
+*            of FLASH_CAL_BLOCK and applied in fixed point to every sample so
+*            that the data leaves the mote in milli-g. Until a valid
+*            calibration has been stored the raw ADC codes are sent as before.
+*
+*/
+/*=======================  I N C L U D E S   =================================*/
+
+#include <string.h>
+#include <stddef.h>
+
+#include "calibration.h"
+#include "ext_flash.h"
+
+#if 0
+  #define DEBUG_PRINT(a) printf a
+#else
+  #define DEBUG_PRINT(a) (void)0
+#endif
+
+/*=============  D A T A  =============*/
+
+static cal_t calActive;   // Applied to the samples when calValid
+static cal_t calStaged;   // Rows received from the manager, not yet committed
+static bool  calValid = false;
+
+// Program load buffer. Command bytes followed by the calibration record
+ADI_ALIGNED_PRAGMA(4)
+static uint8_t calPageBuf[FLASH_PROG_LOAD_HDR_B + sizeof(cal_t)] ADI_ALIGNED_ATTRIBUTE(4);
+
+/*=======================  L O C A L    F U N C T I O N S  ===================*/
+
+static uint32_t calCrc(const cal_t *cal)
+{
+    return flashCrc32(0, (const uint8_t*)cal, offsetof(cal_t, crc));
+}
+
+/*==========================  C O D E  =======================================*/
+
+// Load the calibration from flash. Must be called after the flash SPI has
+// been initialised and the blocks unlocked
+void calInit(void)
+{
+    cal_t cal;
+
+    flashReadPage(FLASH_CAL_BLOCK, 0, (uint8_t*)&cal, sizeof(cal));
+
+    // An erased page reads back as all 0xFF so it fails the magic check
+    calValid = (cal.magic == CAL_MAGIC) && (cal.crc == calCrc(&cal));
+
+    if (calValid)
+        calActive = cal;
+
+    calStaged = calActive;
+
+    DEBUG_PRINT(("Calibration %s\n", calValid ? "loaded" : "not found"));
+}
+
+
+bool calIsValid(void)
+{
+    return calValid;
+}
+
+
+// Convert one set of raw X, Y and Z codes into signed milli-g, in place.
+// out = coeff * (raw - offset), accumulated in 64 bits so that large
+// cross-axis terms can't overflow, then rounded and saturated to 16 bits
+void calApply(uint16_t *x, uint16_t *y, uint16_t *z)
+{
+    int32_t  in[CAL_NUM_AXES];
+    int64_t  acc;
+    uint16_t *out[CAL_NUM_AXES];
+
+    in[0] = (int32_t)*x - calActive.offset[0];
+    in[1] = (int32_t)*y - calActive.offset[1];
+    in[2] = (int32_t)*z - calActive.offset[2];
+
+    out[0] = x;
+    out[1] = y;
+    out[2] = z;
+
+    for (uint8_t row = 0; row < CAL_NUM_AXES; row++)
+    {
+        acc  = (int64_t)calActive.coeff[row][0] * in[0];
+        acc += (int64_t)calActive.coeff[row][1] * in[1];
+        acc += (int64_t)calActive.coeff[row][2] * in[2];
+        acc  = (acc + (1 << (CAL_COEFF_FRAC_BITS - 1))) >> CAL_COEFF_FRAC_BITS;
+
+        if (acc > INT16_MAX)
+            acc = INT16_MAX;
+        else if (acc < INT16_MIN)
+            acc = INT16_MIN;
+
+        *out[row] = (uint16_t)(int16_t)acc;
+    }
+}
+
+
+// Stage one output axis' offset and matrix row. Nothing changes in the
+// data until calCommit() is called
+void calSetRow(uint8_t axis, uint16_t offset, int16_t cx, int16_t cy, int16_t cz)
+{
+    if (axis >= CAL_NUM_AXES)
+        return;
+
+    calStaged.offset[axis]   = offset;
+    calStaged.coeff[axis][0] = cx;
+    calStaged.coeff[axis][1] = cy;
+    calStaged.coeff[axis][2] = cz;
+}
+
+
+// Save the staged calibration to flash and start applying it
+void calCommit(void)
+{
+    calStaged.magic    = CAL_MAGIC;
+    calStaged.reserved = 0;
+    calStaged.crc      = calCrc(&calStaged);
+
+    // The record isn't word aligned after the command bytes
+    memcpy(&calPageBuf[FLASH_PROG_LOAD_HDR_B], &calStaged, sizeof(cal_t));
+
+    flashEraseBlock(FLASH_CAL_BLOCK, true);
+    flashWritePage(FLASH_CAL_BLOCK, 0, calPageBuf, sizeof(cal_t));
+
+    calActive = calStaged;
+    calValid  = true;
+
+    DEBUG_PRINT(("Calibration saved\n"));
+}
+
+
+// Remove the calibration from flash. Raw ADC codes are sent from now on
+void calErase(void)
+{
+    flashEraseBlock(FLASH_CAL_BLOCK, true);
+
+    memset(&calStaged, 0, sizeof(calStaged));
+    calValid = false;
+
+    DEBUG_PRINT(("Calibration erased\n"));
+}
@@ -0,0 +1,748 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+
+/*!
+* @file      capture_archive.c
+* @brief     Log-structured capture archive in the external flash
+*
+* @details
+*            The data blocks form one area that is only ever appended to,
+*            wrapping round to overwrite the oldest data. The axes of a
+*            capture share it, their pages interleaved in the order the
+*            flash writer stores them, so a single axis capture can use all
+*            of it. A page is given a number that keeps counting across
+*            wraps, so a capture is described by its first page number, the
+*            pages per axis and which axes it has.
+*
+*            When a capture is finished its header record is written to the
+*            next page of the log blocks. Record seq lives in log page
+*            seq % ARCH_LOG_PAGES, so a capture can be found without a
+*            search.
+*
+*            Up to ARCH_ERASE_AHEAD_BLOCKS blocks are kept erased ahead of
+*            the write position. archEraseService() erases them one at a
+*            time in the background whenever the main loop has nothing for
+*            the flash to do, so crossing into a new block while sampling
+*            normally costs nothing. The writer only falls back to erasing
+*            the block itself when a capture has used up the whole pool.
+*
+*            On power up the last valid record is found and writing resumes
+*            at the next block boundary, so a page is never programmed twice.
+*            Writing carries on round the whole area, so every block of it
+*            is erased the same number of times.
+*
+*            The record count, the write position and which capture hasn't
+*            been sent yet are kept in a superblock, arch_super_t, written to
+*            the next page of the FLASH_SUPER_BLOCKS blocks after every
+*            record and once a capture has been sent. The blocks are used in
+*            turn and each is only erased when it is started, so the last
+*            copies are still in the other if a write is cut short. At power
+*            up the newest valid copy saves searching the whole log, and a
+*            capture that was stored but not sent before a reset is queued
+*            to be sent again rather than being lost. Without a valid copy
+*            the log is searched as before.
+*
+*            Captures are written with the CRC of every page in its spare
+*            area, ARCH_FLAG_PAGE_CRC. As a capture is sent, each page read
+*            is checked against its CRC and the ECC status of the flash. A
+*            page that fails is read again up to FLASH_READ_RETRIES times,
+*            then counted as corrupt against its axis, archMarkCorrupt(), so
+*            the frame info can say so.
+*
+*            A block that fails to erase or program is swapped for a spare
+*            through the bad block table. Pages already in a block that
+*            fails to program are copied to the spare first, so the layout
+*            and the records that point into it stay valid.
+*
+*/
+/*=======================  I N C L U D E S   =================================*/
+
+#include <string.h>
+#include <stddef.h>
+
+#include "capture_archive.h"
+#include "flash_bbt.h"
+#include "calibration.h"
+#include "shutdown.h"
+#include "sample_codec.h"
+
+#if 0
+  #define DEBUG_PRINT(a) printf a
+#else
+  #define DEBUG_PRINT(a) (void)0
+#endif
+
+/*=============  D A T A  =============*/
+
+static uint32_t   archHead = 0;                  // Next page number to write
+static uint32_t   archCapStart;                  // First page of the capture being written
+static bool       archCapCompressed;
+static bool       archCapSpectrum;
+static uint32_t   archErasedEnd = 0;             // Block number after the last one erased
+static uint16_t   archEraseSlot = NUM_FLASH_BLOCKS;  // Slot of the background erase not yet checked
+static uint32_t   archSeq = 0;                   // seq of the next record
+
+static arch_rec_t archRec;                       // Record being read back
+static bool       archRecValid = false;
+static bool       archRecReplay = false;         // archRec was opened rather than just written
+static uint32_t   archRdNext[ARCH_NUM_AXES];
+static uint16_t   archRdLeft[ARCH_NUM_AXES];
+
+static bool       archReplayPending = false;
+static uint32_t   archReplaySeq;
+
+static arch_super_t archSuper;                   // Next copy to write
+
+static uint16_t   archRdCorrupt[ARCH_NUM_AXES];  // Pages of the current record that failed their check
+static arch_check_stats_t archChk;
+
+// Program load buffers. Command bytes followed by the superblock
+ADI_ALIGNED_PRAGMA(4)
+static uint8_t archSuperBuf[FLASH_PROG_LOAD_HDR_B + sizeof(arch_super_t)] ADI_ALIGNED_ATTRIBUTE(4);
+
+// Program load buffer. Command bytes followed by the record
+ADI_ALIGNED_PRAGMA(4)
+static uint8_t archPageBuf[FLASH_PROG_LOAD_HDR_B + sizeof(arch_rec_t)] ADI_ALIGNED_ATTRIBUTE(4);
+
+/*=======================  L O C A L    F U N C T I O N S  ===================*/
+
+static uint32_t recCrc(const arch_rec_t *rec)
+{
+    return flashCrc32(0, (const uint8_t*)rec, offsetof(arch_rec_t, crc));
+}
+
+
+static uint32_t superCrc(const arch_super_t *sb)
+{
+    return flashCrc32(0, (const uint8_t*)sb, offsetof(arch_super_t, crc));
+}
+
+
+// Slot of the data area a block goes in. Block numbers count up across
+// wraps in the same way as page numbers
+static uint16_t dataSlot(uint32_t blockNum)
+{
+    return (uint16_t)(blockNum % NUM_FLASH_DATA_BLOCKS);
+}
+
+
+static uint16_t dataRow(uint32_t page)
+{
+    return FLASH_ROW(bbtMap(dataSlot(page / NUM_FLASH_PAGES_PER_BLOCK)), page % NUM_FLASH_PAGES_PER_BLOCK);
+}
+
+
+static uint16_t logRow(uint32_t seq)
+{
+    uint32_t page = seq % ARCH_LOG_PAGES;
+
+    return FLASH_ROW(FLASH_LOG_START_BLOCK + page / NUM_FLASH_PAGES_PER_BLOCK,
+                     page % NUM_FLASH_PAGES_PER_BLOCK);
+}
+
+
+static uint8_t countAxes(uint8_t axisMask)
+{
+    return (uint8_t)(((axisMask >> x_active) & 1u) + ((axisMask >> y_active) & 1u) + ((axisMask >> z_active) & 1u));
+}
+
+
+// Non-blocking check of the flash status register. SPI2 must be free
+static bool flashBusy(void)
+{
+#ifndef COG
+    return ((getFlashStatus() >> BITP_FLSH_STAT_OIP) & 1u) != 0;
+#else
+    return false;
+#endif
+}
+
+
+// Erase a slot and wait, replacing its block if the erase fails
+static void eraseSlot(uint16_t slot)
+{
+    flashEraseBlock(bbtMap(slot), false);
+
+    if (flashOpFailed())
+        bbtRetire(slot);
+}
+
+
+// Once a background erase has finished, replace the block if it failed.
+// The flash must not be busy
+static void checkErase(void)
+{
+    if (archEraseSlot == NUM_FLASH_BLOCKS)
+        return;
+
+    if (flashOpFailed())
+        bbtRetire(archEraseSlot);
+
+    archEraseSlot = NUM_FLASH_BLOCKS;
+}
+
+
+static uint32_t roundUpToBlock(uint32_t page)
+{
+    return ((page + NUM_FLASH_PAGES_PER_BLOCK - 1u) / NUM_FLASH_PAGES_PER_BLOCK) * NUM_FLASH_PAGES_PER_BLOCK;
+}
+
+
+// The first page that hasn't been overwritten. Blocks erased ahead of the
+// head have lost their old data too
+static uint32_t oldestPage(void)
+{
+    if (archErasedEnd < NUM_FLASH_DATA_BLOCKS)
+        return 0;
+
+    return (archErasedEnd - NUM_FLASH_DATA_BLOCKS) * NUM_FLASH_PAGES_PER_BLOCK;
+}
+
+
+static bool readRecord(uint32_t seq, arch_rec_t *rec)
+{
+    uint16_t row = logRow(seq);
+
+    archEraseWait();
+    flashReadPage(FLASH_ROW_BLOCK(row), FLASH_ROW_PAGE(row), (uint8_t*)rec, sizeof(arch_rec_t));
+
+    // An erased page reads back as all 0xFF so it fails the magic check
+    return (rec->magic == ARCH_REC_MAGIC) && (rec->version == ARCH_REC_VERSION) &&
+           (rec->seq == seq) && (rec->crc == recCrc(rec));
+}
+
+
+// Find the newest valid superblock. Returns false if there isn't one
+static bool superLoad(void)
+{
+    arch_super_t sb;
+    bool         found = false;
+
+    for (uint32_t pos = 0; pos < ARCH_SUPER_PAGES; pos++)
+    {
+        uint16_t block = (uint16_t)(FLASH_SUPER_START_BLOCK + pos / NUM_FLASH_PAGES_PER_BLOCK);
+
+        flashReadPage(block, (uint8_t)(pos % NUM_FLASH_PAGES_PER_BLOCK), (uint8_t*)&sb, sizeof(sb));
+
+        if ((sb.magic != ARCH_SUPER_MAGIC) || (sb.version != ARCH_REC_VERSION) ||
+            ((sb.gen % ARCH_SUPER_PAGES) != pos) || (sb.crc != superCrc(&sb)))
+        {
+            // Pages are written in order from page 0, the rest of the block is unused
+            pos |= NUM_FLASH_PAGES_PER_BLOCK - 1u;
+            continue;
+        }
+
+        if (!found || (sb.gen > archSuper.gen))
+        {
+            found     = true;
+            archSuper = sb;
+        }
+    }
+
+    return found;
+}
+
+
+// Write the pointers to the next superblock page, erasing the block first
+// when it is the start of one
+static void superSave(void)
+{
+    uint32_t pos   = archSuper.gen % ARCH_SUPER_PAGES;
+    uint16_t block = (uint16_t)(FLASH_SUPER_START_BLOCK + pos / NUM_FLASH_PAGES_PER_BLOCK);
+    uint8_t  page  = (uint8_t)(pos % NUM_FLASH_PAGES_PER_BLOCK);
+
+    archSuper.magic   = ARCH_SUPER_MAGIC;
+    archSuper.version = ARCH_REC_VERSION;
+    archSuper.nextSeq = archSeq;
+    archSuper.head    = archHead;
+    archSuper.crc     = superCrc(&archSuper);
+
+    // The superblock isn't word aligned after the command bytes
+    memcpy(&archSuperBuf[FLASH_PROG_LOAD_HDR_B], &archSuper, sizeof(archSuper));
+    archEraseWait();
+
+    if (page == 0)
+        flashEraseBlock(block, false);
+
+    flashWritePage(block, page, archSuperBuf, sizeof(archSuper));
+    archSuper.gen++;
+}
+
+
+// Point the read side at the pages of archRec
+static void openRecord(void)
+{
+    uint8_t n = 0;
+
+    for (uint8_t a = 0; a < ARCH_NUM_AXES; a++)
+    {
+        if (archRec.axisMask & (1u << a))
+        {
+            archRdNext[a] = archRec.startPage + n;
+            archRdLeft[a] = archRec.nPages;
+            n++;
+        }
+        else
+        {
+            archRdLeft[a] = 0;
+        }
+
+        archRdCorrupt[a] = 0;
+    }
+}
+
+/*==========================  C O D E  =======================================*/
+
+// Find where the archive left off. Must be called after the flash SPI has
+// been initialised, the blocks unlocked and the bad block table loaded
+void archInit(void)
+{
+    arch_rec_t rec;
+    uint32_t   endSeq = 0;               // seq after the last record
+
+    archHead = 0;
+
+    if (superLoad())
+    {
+        // The superblock is written straight after every record, so only
+        // one written just before a reset can be missing from it
+        archHead = archSuper.head;
+
+        for (endSeq = archSuper.nextSeq; readRecord(endSeq, &rec); endSeq++)
+        {
+            archHead            = rec.startPage + (uint32_t)rec.nPages * rec.numAxes;
+            archSuper.unsentSeq = rec.seq;
+        }
+
+        // The last write may have been cut short, leaving a page that can't
+        // be programmed again. Carry on from the start of the next block
+        archSuper.gen = (archSuper.gen / NUM_FLASH_PAGES_PER_BLOCK + 1u) * NUM_FLASH_PAGES_PER_BLOCK;
+    }
+    else
+    {
+        memset(&archSuper, 0, sizeof(archSuper));
+        archSuper.unsentSeq = ARCH_SEQ_NONE;
+
+        // Every log page is checked. The records are in seq order apart from
+        // the wrap, which could be anywhere
+        for (uint32_t page = 0; page < ARCH_LOG_PAGES; page++)
+        {
+            uint16_t row = logRow(page);
+
+            flashReadPage(FLASH_ROW_BLOCK(row), FLASH_ROW_PAGE(row), (uint8_t*)&rec, sizeof(rec));
+
+            if ((rec.magic != ARCH_REC_MAGIC) || (rec.version != ARCH_REC_VERSION) ||
+                ((rec.seq % ARCH_LOG_PAGES) != page) || (rec.crc != recCrc(&rec)))
+                continue;
+
+            if (rec.seq >= endSeq)
+            {
+                endSeq   = rec.seq + 1u;
+                archHead = rec.startPage + (uint32_t)rec.nPages * rec.numAxes;
+            }
+        }
+    }
+
+    // Anything written after the last record belongs to a capture that was
+    // never finished. Skip to the next block, which is erased before use.
+    // Which blocks further on were erased isn't known, the pool is built up
+    // again by archEraseService()
+    archSeq       = roundUpToBlock(endSeq);
+    archHead      = roundUpToBlock(archHead);
+    archErasedEnd = archHead / NUM_FLASH_PAGES_PER_BLOCK + 1u;
+    eraseSlot(dataSlot(archHead / NUM_FLASH_PAGES_PER_BLOCK));
+    flashEraseBlock(FLASH_ROW_BLOCK(logRow(archSeq)), false);
+
+    archRecValid  = false;
+    archRecReplay = false;
+    superSave();
+
+    // Send the capture the reset interrupted before taking a new one
+    if (archSuper.unsentSeq != ARCH_SEQ_NONE)
+        archRequestReplay(archSuper.unsentSeq);
+
+    DEBUG_PRINT(("Archive: next seq %d\n", archSeq));
+}
+
+
+// Note where the capture starts, before the first page is written
+void archStartCapture(bool compressed)
+{
+    archEraseWait();
+    archCapStart      = archHead;
+    archCapCompressed = compressed;
+    archCapSpectrum   = false;
+}
+
+
+// Row of a page of the capture being stored, counted from its first page
+uint16_t archCapRow(uint32_t page)
+{
+    return dataRow(archCapStart + page);
+}
+
+
+// The pages just written after the samples are the spectra of the axes
+void archMarkSpectrum(void)
+{
+    archCapSpectrum = true;
+}
+
+
+// Row the next page is written to
+uint16_t archWrRow(void)
+{
+    return dataRow(archHead);
+}
+
+
+// Move on once a page has been programmed. Returns true only when the next
+// block wasn't in the erased pool, in which case its erase has been started
+// in the background and the flash is busy until it has finished
+bool archWrAdvance(void)
+{
+    uint32_t block;
+
+    archHead++;
+
+    block = archHead / NUM_FLASH_PAGES_PER_BLOCK;
+    if (block < archErasedEnd)
+        return false;
+
+    DEBUG_PRINT(("Erase pool empty\n"));
+
+    archErasedEnd = block + 1u;
+    flashEraseBlock(bbtMap(dataSlot(block)), true);
+    return true;
+}
+
+
+// The erase started by archWrAdvance() failed. Replace the block with an
+// erased spare, waiting for it
+void archWrEraseFailed(void)
+{
+    bbtRetire(dataSlot(archHead / NUM_FLASH_PAGES_PER_BLOCK));
+}
+
+
+// The page at the write position failed to program. The block is replaced
+// by a spare and the pages before it in the block are copied across, after
+// which the page can be loaded and programmed again. Waits for all of this.
+// Returns false if there is no spare, the page must then be skipped
+bool archWrFailed(void)
+{
+    uint16_t slot    = dataSlot(archHead / NUM_FLASH_PAGES_PER_BLOCK);
+    uint16_t oldBlk  = bbtMap(slot);
+    uint8_t  numCopy = (uint8_t)(archHead % NUM_FLASH_PAGES_PER_BLOCK);
+
+    // Pages have to be programmed in order within a block, so a failed copy
+    // means starting again on another spare
+    for (;;)
+    {
+        uint8_t page;
+
+        if (!bbtRetire(slot))
+            return false;
+
+        for (page = 0; page < numCopy; page++)
+        {
+            if (!flashCopyPage(oldBlk, page, bbtMap(slot), page))
+                break;
+        }
+
+        if (page == numCopy)
+            return true;
+
+        DEBUG_PRINT(("Copy to block %d failed\n", bbtMap(slot)));
+    }
+}
+
+
+// Longest capture per axis that fits without overwriting its own start.
+// Long captures are compressed, so this assumes none of them compresses at all.
+// One page of each axis is kept for its spectrum
+uint32_t archMaxSamples(uint8_t axisMask)
+{
+    uint32_t pages = (NUM_FLASH_DATA_BLOCKS - ARCH_ERASE_AHEAD_BLOCKS - 1u) * NUM_FLASH_PAGES_PER_BLOCK;
+    uint8_t  n     = countAxes(axisMask);
+
+    if (n > 0)
+        pages /= n;
+
+    pages--;
+
+    if (pages > UINT16_MAX)
+        pages = UINT16_MAX;
+
+    return pages * CODEC_MIN_PAGE_SAMPLES;
+}
+
+
+// Start erasing the next block of the pool if it isn't full and the flash
+// is free. Never waits, call whenever the flash is idle
+void archEraseService(void)
+{
+    if (isSpi2Busy() || flashBusy())
+        return;
+
+    checkErase();
+
+    // Blocks erased beyond the one being written to
+    if (archErasedEnd - (archHead / NUM_FLASH_PAGES_PER_BLOCK) - 1u >= ARCH_ERASE_AHEAD_BLOCKS)
+        return;
+
+    DEBUG_PRINT(("Pre-erasing block %d\n", archErasedEnd));
+
+    archEraseSlot = dataSlot(archErasedEnd);
+    flashEraseBlock(bbtMap(archEraseSlot), true);
+    archErasedEnd++;
+}
+
+
+// Wait for a background erase to finish before using the flash
+void archEraseWait(void)
+{
+    waitForSpi2();
+    pollFlashStatus(BITP_FLSH_STAT_OIP, false);
+    checkErase();
+}
+
+
+// Write the header record of the capture that has just been stored and make
+// it the one that is read back. All pages must have been programmed
+void archCommitCapture(const plan_entry_t *capture)
+{
+    uint16_t row = logRow(archSeq);
+
+    memset(&archRec, 0, sizeof(archRec));
+    archRec.magic      = ARCH_REC_MAGIC;
+    archRec.version    = ARCH_REC_VERSION;
+    archRec.axisInfo   = capture->axisInfo;
+    archRec.seq        = archSeq;
+    archRec.timestamp  = rtc_GetTime();
+    archRec.sampFreq   = capture->sampFreq;
+    archRec.numSamples = capture->numSamples;
+    archRec.proc       = capture->proc;
+    archRec.flags      = (calIsValid() ? ARCH_FLAG_CALIBRATED : 0) |
+                         (archCapCompressed ? ARCH_FLAG_COMPRESSED : 0) |
+                         (archCapSpectrum ? ARCH_FLAG_SPECTRUM : 0) |
+                         ARCH_FLAG_PAGE_CRC;
+    archRec.startPage  = archCapStart;
+    archRec.axisMask   = planAxisMask(capture->axisInfo);
+    archRec.numAxes    = countAxes(archRec.axisMask);
+
+    if (archRec.numAxes > 0)
+        archRec.nPages = (uint16_t)((archHead - archCapStart) / archRec.numAxes);
+
+    archRec.crc   = recCrc(&archRec);
+    archRecValid  = true;
+    archRecReplay = false;
+    openRecord();
+
+    // The record isn't word aligned after the command bytes
+    memcpy(&archPageBuf[FLASH_PROG_LOAD_HDR_B], &archRec, sizeof(archRec));
+    archEraseWait();
+    flashWritePage(FLASH_ROW_BLOCK(row), FLASH_ROW_PAGE(row), archPageBuf, sizeof(archRec));
+
+    // Erase the next log block once this one is full
+    archSeq++;
+    if ((archSeq % NUM_FLASH_PAGES_PER_BLOCK) == 0)
+        flashEraseBlock(FLASH_ROW_BLOCK(logRow(archSeq)), false);
+
+    archSuper.unsentSeq = archRec.seq;
+    superSave();
+
+    DEBUG_PRINT(("Archived capture %d\n", archRec.seq));
+}
+
+
+// Load the record of an earlier capture and point the read side at its
+// pages. Fails if it has been overwritten or was never stored
+bool archOpen(uint32_t seq)
+{
+    arch_rec_t rec;
+
+    if ((seq < archOldestSeq()) || (seq >= archSeq) || !readRecord(seq, &rec))
+        return false;
+
+    if ((rec.nPages > 0) && (rec.startPage < oldestPage()))
+        return false;
+
+    archRec       = rec;
+    archRecValid  = true;
+    archRecReplay = true;
+    openRecord();
+    return true;
+}
+
+
+bool archRdDone(axis_t axis)
+{
+    return archRdLeft[axis] == 0;
+}
+
+
+bool archRdAllDone(void)
+{
+    return archRdDone(x_active) && archRdDone(y_active) && archRdDone(z_active);
+}
+
+
+// Row of the next page of an axis to read
+uint16_t archRdRow(axis_t axis)
+{
+    return dataRow(archRdNext[axis]);
+}
+
+
+void archRdAdvance(axis_t axis)
+{
+    if (archRdLeft[axis] == 0)
+        return;
+
+    archRdNext[axis] += archRec.numAxes;
+    archRdLeft[axis]--;
+}
+
+
+// Row of page k of an axis of the current record, for reading its pages
+// out of turn. The axis must be one of those stored
+uint16_t archAxisRow(axis_t axis, uint16_t k)
+{
+    uint8_t n = 0;
+
+    for (uint8_t a = 0; a < (uint8_t)axis; a++)
+        if (archRec.axisMask & (1u << a))
+            n++;
+
+    return dataRow(archRec.startPage + n + (uint32_t)k * archRec.numAxes);
+}
+
+
+// Record of the capture last written or opened, NULL if there isn't one
+const arch_rec_t* archCurrentRecord(void)
+{
+    return archRecValid ? &archRec : NULL;
+}
+
+
+// True when the current record is an old capture being sent again
+bool archIsReplay(void)
+{
+    return archRecValid && archRecReplay;
+}
+
+
+// Every frame of the current record has been acknowledged. A reset from
+// now on doesn't need it sent again
+void archMarkSent(void)
+{
+    if (!archRecValid || (archRec.seq != archSuper.unsentSeq))
+        return;
+
+    archSuper.unsentSeq = ARCH_SEQ_NONE;
+    superSave();
+}
+
+
+// A page of an axis of the current record still failed its check after
+// every retry
+void archMarkCorrupt(axis_t axis)
+{
+    if ((uint8_t)axis < ARCH_NUM_AXES)
+        archRdCorrupt[axis]++;
+
+    DEBUG_PRINT(("Capture %d axis %d page corrupt\n", archRec.seq, axis));
+}
+
+
+// Check one page of the current record, reading it again if it fails.
+// The page is left in the flash cache. Returns FLASH_PAGE_x
+uint8_t archCheckPage(uint16_t row)
+{
+    bool    hasCrc = archRecValid && (archRec.flags & ARCH_FLAG_PAGE_CRC);
+    uint8_t result;
+    uint8_t tries  = 0;
+
+    while (((result = flashCheckPage(FLASH_ROW_BLOCK(row), FLASH_ROW_PAGE(row), hasCrc)) >= FLASH_PAGE_ECC_FAILED) &&
+           (tries < FLASH_READ_RETRIES))
+        tries++;
+
+    archCountCheck(result, tries);
+    return result;
+}
+
+
+// Account for a page read that has been checked, after any retries
+void archCountCheck(uint8_t result, uint8_t retries)
+{
+    archChk.pagesRead++;
+    archChk.retries += retries;
+
+    if (result == FLASH_PAGE_CORRECTED)
+        archChk.corrected++;
+    else if (result != FLASH_PAGE_OK)
+        archChk.corrupt++;
+}
+
+
+// Corrupt pages of the axes in axisMask found so far in the current record
+uint16_t archCorruptPages(uint8_t axisMask)
+{
+    uint16_t total = 0;
+
+    for (uint8_t a = 0; a < ARCH_NUM_AXES; a++)
+    {
+        if (axisMask & (1u << a))
+            total += archRdCorrupt[a];
+    }
+
+    return total;
+}
+
+
+const arch_check_stats_t* getArchCheckStats(void)
+{
+    return &archChk;
+}
+
+
+// Oldest record still in the log. Its data may have been overwritten already
+uint32_t archOldestSeq(void)
+{
+    uint32_t headBlock = archSeq / NUM_FLASH_PAGES_PER_BLOCK;
+
+    if (headBlock + 1u < FLASH_LOG_BLOCKS)
+        return 0;
+
+    return (headBlock + 1u - FLASH_LOG_BLOCKS) * NUM_FLASH_PAGES_PER_BLOCK;
+}
+
+
+uint32_t archNextSeq(void)
+{
+    return archSeq;
+}
+
+
+void archRequestReplay(uint32_t seq)
+{
+    archReplaySeq     = seq;
+    archReplayPending = true;
+}
+
+
+bool archTakeReplay(uint32_t *seq)
+{
+    if (!archReplayPending)
+        return false;
+
+    archReplayPending = false;
+    *seq = archReplaySeq;
+    return true;
+}
@@ -0,0 +1,176 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+
+/*!
+* @file      capture_plan.c
+* @brief     Multi-rate capture plan
+*
+* @details
+*            A plan is a short list of captures, each with its own sampling
+*            rate, length, axes and processing. All entries run in the same
+*            wake, one after the other, and the manager is only asked for new
+*            parameters once the last one has been sent. Without a plan a
+*            single capture is run with the manager's sampling parameters.
+*
+*/
+/*=======================  I N C L U D E S   =================================*/
+
+#include "capture_plan.h"
+#include "SmartMesh_RF_cog.h"
+#include "capture_archive.h"
+
+#if 0
+  #define DEBUG_PRINT(a) printf a
+#else
+  #define DEBUG_PRINT(a) (void)0
+#endif
+
+/*=============  D A T A  =============*/
+
+static plan_entry_t planEntries[PLAN_MAX_ENTRIES];
+static uint8_t      planStagedMask = 0;   // Bit per entry received since the last commit
+static uint8_t      planLen        = 0;   // 0 when there is no plan
+static uint8_t      planNext       = 0;   // Entry to run at the next capture
+
+static plan_entry_t captureCur = { 0, 0, XYZ, PLAN_PROC_FFT, 0 };
+static uint8_t      captureIdx = 0;
+
+/*==========================  C O D E  =======================================*/
+
+// Store one entry. It isn't run until the plan has been committed
+void planSetEntry(uint8_t idx, const plan_entry_t *entry)
+{
+    if ((idx >= PLAN_MAX_ENTRIES) || (entry->sampFreq == 0) || (entry->numSamples == 0))
+        return;
+
+    // The plan is being replaced, stop running the old one
+    planLen  = 0;
+    planNext = 0;
+
+    planEntries[idx] = *entry;
+    planStagedMask  |= (1u << idx);
+}
+
+
+// Start running the first numEntries entries. They must all have been received
+void planCommit(uint8_t numEntries)
+{
+    uint8_t needed = (uint8_t)((1u << numEntries) - 1u);
+
+    if ((numEntries == 0) || (numEntries > PLAN_MAX_ENTRIES) || ((planStagedMask & needed) != needed))
+    {
+        DEBUG_PRINT(("Incomplete capture plan, not run\n"));
+        return;
+    }
+
+    planLen        = numEntries;
+    planNext       = 0;
+    planStagedMask = 0;
+
+    DEBUG_PRINT(("Capture plan of %d entries\n", planLen));
+}
+
+
+void planClear(void)
+{
+    planLen        = 0;
+    planNext       = 0;
+    planStagedMask = 0;
+}
+
+
+uint8_t planNumEntries(void)
+{
+    return planLen;
+}
+
+
+// Latch the settings of the capture about to start. These are the next
+// plan entry, or the manager's sampling parameters when there is no plan
+const plan_entry_t* planStartCapture(void)
+{
+    if (planLen > 0)
+    {
+        captureIdx = planNext;
+        captureCur = planEntries[planNext];
+
+        planNext++;
+        if (planNext >= planLen)
+            planNext = 0;
+    }
+    else
+    {
+        captureIdx             = 0;
+        captureCur.sampFreq    = getSampFreq();
+        captureCur.numSamples  = getAdcNumSamples();
+        captureCur.axisInfo    = getAxisInfo();
+        captureCur.proc        = PLAN_PROC_FFT;
+        captureCur.fftFirstBin = 0;
+    }
+
+    // The axes being sampled share the flash, fewer axes allow longer captures
+    if (captureCur.numSamples > archMaxSamples(planAxisMask(captureCur.axisInfo)))
+        captureCur.numSamples = archMaxSamples(planAxisMask(captureCur.axisInfo));
+
+    if (captureCur.numSamples > PLAN_MAX_SAMPLES)
+        captureCur.numSamples = PLAN_MAX_SAMPLES;
+
+    return &captureCur;
+}
+
+
+// Make an archived capture the current one so that it is processed and sent
+// with its original settings. The plan carries on where it was afterwards
+const plan_entry_t* planReplayCapture(const plan_entry_t *entry)
+{
+    captureIdx = 0;
+    captureCur = *entry;
+
+    return &captureCur;
+}
+
+
+// Bit per axis_t enabled by an axis select value such as XYZ. Each
+// decimal digit of the value is one axis
+uint8_t planAxisMask(uint8_t axisInfo)
+{
+    uint8_t mask = 0;
+
+    switch (axisInfo)
+    {
+        case XYZ: mask = (1u << x_active) | (1u << y_active) | (1u << z_active); break;
+        case XY:  mask = (1u << x_active) | (1u << y_active);                    break;
+        case XZ:  mask = (1u << x_active) | (1u << z_active);                    break;
+        case YZ:  mask = (1u << y_active) | (1u << z_active);                    break;
+        case X:   mask = (1u << x_active);                                       break;
+        case Y:   mask = (1u << y_active);                                       break;
+        case Z:   mask = (1u << z_active);                                       break;
+        default:                                                                 break;
+    }
+
+    return mask;
+}
+
+
+// True while entries of the plan are still to be run in this wake
+bool planCaptureRemaining(void)
+{
+    return (planLen > 0) && (planNext != 0);
+}
+
+
+uint8_t planCaptureIdx(void)
+{
+    return captureIdx;
+}
+
+
+const plan_entry_t* planCurrentCapture(void)
+{
+    return &captureCur;
+}
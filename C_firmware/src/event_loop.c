@@ -0,0 +1,233 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+
+/*!
+* @file      event_loop.c
+* @brief     Events, timers and idle sleep of the main loop
+*
+* @details
+*            Events are handlers posted to a queue and run one after the
+*            other from the main loop, each to completion. Posting a handler
+*            that is already waiting does nothing, so a request made on every
+*            pass of the loop runs once.
+*
+*            Timers are one shot and live in a wheel of EV_WHEEL_SLOTS slots,
+*            driven by the GP0 tick every EV_TICK_MS. The interrupt only
+*            counts the tick. evRun() then goes through the slot of each tick
+*            it hasn't seen and calls the handlers of the timers due on it,
+*            so no handler ever runs from the interrupt.
+*
+*            evIdle() puts the core into flexi mode when nothing is waiting
+*            and the caller agrees. Any interrupt wakes it: a UART byte, the
+*            flash queue, or the next tick.
+*
+*/
+/*=======================  I N C L U D E S   =================================*/
+
+#include <string.h>
+#include <adi_processor.h>
+
+#include "event_loop.h"
+
+#if 0
+  #define DEBUG_PRINT(a) printf a
+#else
+  #define DEBUG_PRINT(a) (void)0
+#endif
+
+/*=============  D A T A  =============*/
+
+static ev_handler_t       evQueue[EV_QUEUE_LEN];
+static volatile uint8_t   evHead  = 0;
+static volatile uint8_t   evCount = 0;
+
+static ev_timer_t        *evWheel[EV_WHEEL_SLOTS];
+static volatile uint32_t  evTicks    = 0;   // Counted by the GP0 interrupt
+static uint32_t           evTicksRun = 0;   // Ticks whose timers have been fired
+
+uint32_t                  evQueueFull_DBG = 0;   // Events lost to a full queue
+
+/*=======================  L O C A L    F U N C T I O N S  ===================*/
+
+static ev_timer_t** wheelSlot(uint32_t tick)
+{
+    return &evWheel[tick & (EV_WHEEL_SLOTS - 1u)];
+}
+
+
+// Fire the timers due on tick. A handler may start its own timer again
+static void fireSlot(uint32_t tick)
+{
+    ev_timer_t **link = wheelSlot(tick);
+    ev_timer_t *timer;
+
+    while ((timer = *link) != NULL)
+    {
+        if (timer->expiry != tick)
+        {
+            // Not due until a later turn of the wheel
+            link = &timer->next;
+            continue;
+        }
+
+        *link         = timer->next;
+        timer->active = false;
+
+        if (timer->handler != NULL)
+            timer->handler();
+    }
+}
+
+/*==========================  C O D E  =======================================*/
+
+void evInit(void)
+{
+    evHead     = 0;
+    evCount    = 0;
+    evTicks    = 0;
+    evTicksRun = 0;
+    memset(evWheel, 0, sizeof(evWheel));
+}
+
+
+// Queue a handler to run from the main loop. Returns false if the queue is
+// full. Can be called from interrupts
+bool evPost(ev_handler_t handler)
+{
+    bool ok = true;
+
+    __disable_irq();
+    for (uint8_t i = 0; i < evCount; i++)
+    {
+        if (evQueue[(evHead + i) % EV_QUEUE_LEN] == handler)
+        {
+            __enable_irq();
+            return true;
+        }
+    }
+
+    if (evCount < EV_QUEUE_LEN)
+    {
+        evQueue[(evHead + evCount) % EV_QUEUE_LEN] = handler;
+        evCount++;
+    }
+    else
+    {
+        evQueueFull_DBG++;
+        ok = false;
+    }
+    __enable_irq();
+
+    return ok;
+}
+
+
+// True while there are events that haven't run
+bool evPending(void)
+{
+    return evCount > 0;
+}
+
+
+// Fire the timers that are due, then run the events until there are none
+// left, including those posted by the handlers
+void evRun(void)
+{
+    ev_handler_t handler;
+
+    while (evTicksRun != evTicks)
+        fireSlot(++evTicksRun);
+
+    while (evCount > 0)
+    {
+        __disable_irq();
+        handler = evQueue[evHead];
+        evHead  = (evHead + 1u) % EV_QUEUE_LEN;
+        evCount--;
+        __enable_irq();
+
+        handler();
+    }
+}
+
+
+// Called from the GP0 interrupt every EV_TICK_MS
+void evTick(void)
+{
+    evTicks++;
+}
+
+
+// Start timer to call handler in delay_ms, from the main loop. A timer that
+// is already running is started again
+void evTimerStart(ev_timer_t *timer, uint32_t delay_ms, ev_handler_t handler)
+{
+    ev_timer_t **slot;
+    uint32_t   ticks = (delay_ms + EV_TICK_MS - 1u) / EV_TICK_MS;
+
+    evTimerStop(timer);
+
+    if (ticks == 0)
+        ticks = 1u;
+
+    timer->expiry  = evTicks + ticks;
+    timer->handler = handler;
+    timer->active  = true;
+
+    slot        = wheelSlot(timer->expiry);
+    timer->next = *slot;
+    *slot       = timer;
+}
+
+
+void evTimerStop(ev_timer_t *timer)
+{
+    ev_timer_t **link;
+
+    if (!timer->active)
+        return;
+
+    for (link = wheelSlot(timer->expiry); *link != NULL; link = &(*link)->next)
+    {
+        if (*link == timer)
+        {
+            *link = timer->next;
+            break;
+        }
+    }
+
+    timer->active = false;
+}
+
+
+// True from evTimerStart() until the timer fires or is stopped
+bool evTimerActive(const ev_timer_t *timer)
+{
+    return timer->active;
+}
+
+
+// Sleep until the next interrupt if no events or ticks are waiting and
+// idleOk() says the caller has nothing to do either. idleOk() is called with
+// the interrupts off, so nothing it looks at can change before the core
+// sleeps. An interrupt that comes in meanwhile stays pending and WFI returns
+// at once
+void evIdle(bool (*idleOk)(void))
+{
+    __disable_irq();
+
+    if ((evCount == 0) && (evTicksRun == evTicks) && idleOk())
+    {
+        // Flexi mode, only the core clock stops
+        SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+        __DSB();
+        __WFI();
+    }
+
+    __enable_irq();
+}
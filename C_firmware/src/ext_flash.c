@@ -1,5 +1,6 @@
 
 #include "ext_flash.h"
+#include "flash_queue.h"
 
 #if 0
   #define DEBUG_PRINT(a) printf a
@@ -9,24 +10,7 @@
 //#define COG true
 
 bool ext_flash_needed   = false;
-bool spi2Busy           = false;
-
-// There are 1024 blocks in the flash
-// Give each axis 1/3 = 341 blocks each
-uint16_t block_addr_wr_x  = 0;
-uint8_t  page_addr_wr_x   = 0;
-uint16_t block_addr_rd_x  = 0;
-uint8_t  page_addr_rd_x   = 0;
-
-uint16_t block_addr_wr_y  = 341;
-uint8_t  page_addr_wr_y   = 0;
-uint16_t block_addr_rd_y  = 341;
-uint8_t  page_addr_rd_y   = 0;
-
-uint16_t block_addr_wr_z  = 682;
-uint8_t  page_addr_wr_z   = 0;
-uint16_t block_addr_rd_z  = 682;
-uint8_t  page_addr_rd_z   = 0;
+volatile bool spi2Busy  = false;
 
 // Allocate memory for SPI driver
 ADI_ALIGNED_PRAGMA(2)
@@ -51,19 +35,23 @@ void initExtFlashSPI()
 
    adi_spi_RegisterCallback(spiDevice, spi2Callback, NULL);
 
+   flashQueueInit();
 }
 
 
+// The command queue chains its next step on every completed transfer
 void spi2Callback(void *pCBParam, uint32_t nEvent, void *EventArg)
 {
    spi2Busy = false;
+   flashQueueSpiDone();
 }
 
+// Start a transfer without waiting, SPI2 must be free. The command queue
+// uses this from interrupt context
 // *tx_data: Array of data to be sent
 // n_bytes: number of bytes from array that should be sent
 // bDMA: USe DMA for data transfers?
-// blocking: Let function complete in the background or not
-void spiWriteFlash(uint8_t *tx_data, SpiRW_s spi_rw)
+void spiWriteFlashStart(uint8_t *tx_data, SpiRW_s spi_rw)
 {
    ADI_SPI_RESULT spiResult;
 
@@ -101,34 +89,41 @@ void spiWriteFlash(uint8_t *tx_data, SpiRW_s spi_rw)
    transceive.pTransmitter     = tx_data;
    transceive.nTxIncrement     = 1;  // 16bits at a time
 
-   // Ensure that SPI isn't busy w+1ith anything else first
-   waitForSpi2();
-
    //if (spi_rw.blocking) spiResult = adi_spi_MasterReadWrite(spiDevice, &transceive);
    //else                 spiResult = adi_spi_MasterSubmitBuffer(spiDevice, &transceive);
 
    spi2Busy = true;
    
    spiResult = adi_spi_MasterSubmitBuffer(spiDevice, &transceive);
+
+   DEBUG_RESULT("Flash Write Failed", spiResult, ADI_SPI_SUCCESS);   
+}
+
+
+// Blocking callers wait for the command queue as well as for SPI2
+void spiWriteFlash(uint8_t *tx_data, SpiRW_s spi_rw)
+{
+   // Ensure that SPI isn't busy with anything else first
+   waitForSpi2();
+
+   spiWriteFlashStart(tx_data, spi_rw);
     
    if (spi_rw.blocking)
    {
         waitForSpi2();
    }
-
-   DEBUG_RESULT("Flash Write Failed", spiResult, ADI_SPI_SUCCESS);   
 }
 
 
 
 
+// Start a transfer without waiting, SPI2 must be free
 // *rx_buffer: Pointer to receive data structure
 // n_bytes_rx: Number of bytes to receive
 // bDMA: USe DMA for data transfers?
-// blocking: Let function complete in the background or not
 // *tx_cmd: Pointer to data structure containing tx command to send
 // n_bytes_tx: How many bytes in tx command
-void spiReadFlash(uint8_t *rx_buffer, uint8_t *tx_cmd, SpiRW_s spi_rw)
+void spiReadFlashStart(uint8_t *rx_buffer, uint8_t *tx_cmd, SpiRW_s spi_rw)
 {
    ADI_SPI_RESULT spiResult;
 
@@ -175,28 +170,37 @@ void spiReadFlash(uint8_t *rx_buffer, uint8_t *tx_cmd, SpiRW_s spi_rw)
        transceive.nTxIncrement     = 0;
    }
 
-   // Ensure that SPI isn't busy with anything else first
-   waitForSpi2();
-
    //if (spi_rw.blocking) spiResult = adi_spi_MasterReadWrite(spiDevice, &transceive);
    //else                 spiResult = adi_spi_MasterSubmitBuffer(spiDevice, &transceive);
 
    spi2Busy = true;
 
    spiResult = adi_spi_MasterSubmitBuffer(spiDevice, &transceive);
+
+   DEBUG_RESULT("Flash Read Failed", spiResult, ADI_SPI_SUCCESS);   
+
+}
+
+
+void spiReadFlash(uint8_t *rx_buffer, uint8_t *tx_cmd, SpiRW_s spi_rw)
+{
+   // Ensure that SPI isn't busy with anything else first
+   waitForSpi2();
+
+   spiReadFlashStart(rx_buffer, tx_cmd, spi_rw);
     
    if (spi_rw.blocking)
    {
         waitForSpi2();
    }
-   DEBUG_RESULT("Flash Read Failed", spiResult, ADI_SPI_SUCCESS);   
-
 }
 
 
+// SPI2 can't be used by a blocking call while a transfer is running or
+// while the command queue has commands that haven't finished
 bool isSpi2Busy()
 {
-   return spi2Busy;
+   return spi2Busy || flashQueueBusy();
    //bool bMasterComplete= false;
    //adi_spi_isBufferAvailable(spiDevice, &bMasterComplete);
    //return bMasterComplete;
@@ -590,193 +594,169 @@ void prepareFlash(void)
     // Unlock the blocks for writing 
     flashUnlockBlocks();
 
-    // Erase the first pages that will be written to
-    flashEraseBlock(0x0, true);
-    flashEraseBlock(X_AXIS_BLOCK_BOUNDARY, true);
-    flashEraseBlock(Y_AXIS_BLOCK_BOUNDARY, true);
-    // When a new block is entered by updatePagePointers
-    // function it will be erased... just erase each axis'
-    // first block here prior to starting
-
+    // The capture archive erases the blocks it is about to write to, 
+    // see archInit()
 }
 
 
-// Iterate page and block pointers for specified axis.
-// Set pointers back to zero after reaching respective boundaries
-void updatePagePointers(bool write, axis_t axis)
+// Write a single page in one go, blocking until it has been programmed.
+// Used for small metadata records rather than sample data.
+// tx_data: The first FLASH_PROG_LOAD_HDR_B bytes are reserved for the 
+//          program load command, the data to store follows them
+// n_bytes_data: Number of data bytes, not including the reserved bytes
+void flashWritePage(uint16_t block_addr, uint8_t page_addr, uint8_t *tx_data, uint32_t n_bytes_data)
 {
+    flashProgramLoad(0x0, tx_data, n_bytes_data);
+    waitForSpi2();
 
-    uint8_t  *page_addr_wr;
-    uint8_t  *page_addr_rd;
-    uint16_t *block_addr_wr;
-    uint16_t *block_addr_rd;
-    uint16_t axis_block_boundary;
+    flashProgramExecute(block_addr, page_addr);
+    waitForSpi2();
 
-    switch (axis) 
-    {
-        case x_active:
-            page_addr_wr        = &page_addr_wr_x;
-            page_addr_rd        = &page_addr_rd_x;
-            block_addr_wr       = &block_addr_wr_x;
-            block_addr_rd       = &block_addr_rd_x;
-            axis_block_boundary = X_AXIS_BLOCK_BOUNDARY;
-            break;
-
-        case y_active:
-            page_addr_wr        = &page_addr_wr_y;
-            page_addr_rd        = &page_addr_rd_y;
-            block_addr_wr       = &block_addr_wr_y;
-            block_addr_rd       = &block_addr_rd_y;
-            axis_block_boundary = Y_AXIS_BLOCK_BOUNDARY;
-            break;
-
-        case z_active:
-            page_addr_wr        = &page_addr_wr_z;
-            page_addr_rd        = &page_addr_rd_z;
-            block_addr_wr       = &block_addr_wr_z;
-            block_addr_rd       = &block_addr_rd_z;
-            axis_block_boundary = Z_AXIS_BLOCK_BOUNDARY;
-            break;
-    }
+    pollFlashStatus(BITP_FLSH_STAT_OIP, false);
+}
 
 
-   if (write) {
-      if (*page_addr_wr == NUM_FLASH_PAGES_PER_BLOCK-1) 
-      {
-         // Entering a new block
-         *page_addr_wr = 0;
-
-         if (*block_addr_wr == axis_block_boundary-1)
-         {
-             *block_addr_wr = 0;
-         }
-         else
-         {
-             *block_addr_wr = *block_addr_wr+1;
-         }
-
-         // Erase block prior to storing data in it
-         flashEraseBlock(*block_addr_wr, false);
-      } 
-      else 
-      {
-         *page_addr_wr = *page_addr_wr+1;
-      }
-      
-   } 
-   else
-   {
-      // Page Read
-      if (*page_addr_rd == NUM_FLASH_PAGES_PER_BLOCK-1)
-      {
-          // Entering a new block
-          *page_addr_rd = 0;
-          if (*block_addr_rd == axis_block_boundary-1)
-          {
-              *block_addr_rd = 0;
-          }
-          else
-          {
-             *block_addr_rd = *block_addr_rd + 1;
-          }
-      }
-      else 
-      {
-          *page_addr_rd = *page_addr_rd + 1;
-      }
-   }
+// Read the start of a page into rx_buffer, blocking until complete
+void flashReadPage(uint16_t block_addr, uint8_t page_addr, uint8_t *rx_buffer, uint32_t n_bytes_rx)
+{
+    flashPageRead(block_addr, page_addr);
+    flashReadFromCache(0x0, rx_buffer, n_bytes_rx);
 }
 
-// Returns true if the read and write pointers are the same
-bool checkPagePointers(axis_t axis)
+
+// Standard CRC-32 (reflected, polynomial 0xEDB88320). Pass 0 as crc for the 
+// first chunk and the previous result to continue over more data. 
+// Matches zlib.crc32() on the manager side
+uint32_t flashCrc32(uint32_t crc, const uint8_t *data, uint32_t n_bytes)
 {
-    if (axis == x_active)
-       return (page_addr_rd_x == page_addr_wr_x) && (block_addr_rd_x == block_addr_wr_x);
-    else if (axis == y_active)
-       return (page_addr_rd_y == page_addr_wr_y) && (block_addr_rd_y == block_addr_wr_y);
-    else if (axis == z_active)
-       return (page_addr_rd_z == page_addr_wr_z) && (block_addr_rd_z == block_addr_wr_z);
-    else 
-       return NULL;
+    static const uint32_t crc_tbl[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+
+    crc = ~crc;
+    while (n_bytes--)
+    {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ crc_tbl[crc & 0x0F];
+        crc = (crc >> 4) ^ crc_tbl[crc & 0x0F];
+    }
+    return ~crc;
 }
 
-bool checkAllPagePointers()
+
+// Check a sample page that has been read from the flash. crc is the CRC-32
+// read from its spare area and status the flash status after the page
+// read. data is NULL for pages written without a CRC, only the ECC status
+// is checked then. Returns FLASH_PAGE_x
+uint8_t flashCheckPageData(const uint8_t *data, uint32_t crc, uint8_t status)
 {
-    bool x_sent, y_sent, z_sent;
-    x_sent = checkPagePointers(x_active);
-    y_sent = checkPagePointers(y_active);
-    z_sent = checkPagePointers(z_active);
-    
-    return x_sent && y_sent && z_sent;
+    uint8_t ecc = (uint8_t)(status & BITM_FLSH_STAT_ECC);
 
+    if (ecc == FLSH_STAT_ECC_FAILED)
+        return FLASH_PAGE_ECC_FAILED;
+
+    if ((data != NULL) && (flashCrc32(0, data, FLASH_PAGE_SIZE_B) != crc))
+        return FLASH_PAGE_CRC_FAILED;
+
+    return (ecc != 0) ? FLASH_PAGE_CORRECTED : FLASH_PAGE_OK;
 }
 
-void resetPagePointers(axis_t axis)
+
+// Read a sample page into the flash cache and check it, a piece at a time
+// so no page buffer is needed. The page is left in the cache. Returns
+// FLASH_PAGE_x
+uint8_t flashCheckPage(uint16_t block_addr, uint8_t page_addr, bool hasCrc)
 {
+    uint8_t  chunk[64];
+    uint32_t crc = 0;
+    uint32_t stored;
+    uint8_t  ecc;
+
+    flashPageRead(block_addr, page_addr);
+#ifndef COG
+    ecc = (uint8_t)(getFlashStatus() & BITM_FLSH_STAT_ECC);
+#else
+    ecc = 0;
+#endif
+
+    if (ecc == FLSH_STAT_ECC_FAILED)
+        return FLASH_PAGE_ECC_FAILED;
 
-   block_addr_wr_x  = X_AXIS_BLOCK_BOUNDARY;
-   page_addr_wr_x   = 0;
-   block_addr_rd_x  = X_AXIS_BLOCK_BOUNDARY;
-   page_addr_rd_x   = 0;
-                           
-   block_addr_wr_y  = Y_AXIS_BLOCK_BOUNDARY;
-   page_addr_wr_y   = 0;
-   block_addr_rd_y  = Y_AXIS_BLOCK_BOUNDARY;
-   page_addr_rd_y   = 0;
-                           
-   block_addr_wr_z  = Z_AXIS_BLOCK_BOUNDARY;
-   page_addr_wr_z   = 0;
-   block_addr_rd_z  = Z_AXIS_BLOCK_BOUNDARY;
-   page_addr_rd_z   = 0;
+    if (!hasCrc)
+        return (ecc != 0) ? FLASH_PAGE_CORRECTED : FLASH_PAGE_OK;
 
+    for (uint16_t col = 0; col < FLASH_PAGE_SIZE_B; col += sizeof(chunk))
+    {
+        flashReadFromCache(col, chunk, sizeof(chunk));
+        crc = flashCrc32(crc, chunk, sizeof(chunk));
+    }
+
+    flashReadFromCache(FLASH_PAGE_CRC_COL, (uint8_t*)&stored, sizeof(stored));
+    if (crc != stored)
+        return FLASH_PAGE_CRC_FAILED;
+
+    return (ecc != 0) ? FLASH_PAGE_CORRECTED : FLASH_PAGE_OK;
 }
 
 
-uint16_t getBlockAddrRd(axis_t axis)
+// Wait for the last program or erase to finish and return true if the 
+// flash reported that it failed. The fail bits are cleared by the next
+// program or erase
+bool flashOpFailed(void)
 {
-    if (axis == x_active)
-       return block_addr_rd_x;
-    else if (axis == y_active)
-       return block_addr_rd_y;
-    else if (axis == z_active)
-       return block_addr_rd_z;
-    else
-      return NULL;
+#ifndef COG
+    pollFlashStatus(BITP_FLSH_STAT_OIP, false);
+    return (getFlashStatus() & (BITM_FLSH_STAT_E_FAIL | BITM_FLSH_STAT_P_FAIL)) != 0;
+#else
+    return false;
+#endif
 }
 
-uint8_t  getPageAddrRd(axis_t axis)
+
+// Copy one page to another inside the flash, without moving the data 
+// over SPI. The destination block must have been erased. Returns false
+// if the program failed
+bool flashCopyPage(uint16_t src_block, uint8_t src_page, uint16_t dst_block, uint8_t dst_page)
 {
-    if (axis == x_active)
-       return page_addr_rd_x;
-    else if (axis == y_active)
-       return page_addr_rd_y;
-    else if (axis == z_active)
-       return page_addr_rd_z;
-    else 
-       return NULL;
+    flashPageRead(src_block, src_page);
+
+    flashProgramExecute(dst_block, dst_page);
+    waitForSpi2();
+
+    return !flashOpFailed();
 }
 
-uint16_t getBlockAddrWr(axis_t axis)
+
+// Check the bad block marker, which is set by the manufacturer or by
+// flashMarkBlockBad()
+bool flashBlockMarkedBad(uint16_t block_addr)
 {
-    if (axis == x_active)
-       return block_addr_wr_x;
-    else if (axis == y_active)
-       return block_addr_wr_y;
-    else if (axis == z_active)
-       return block_addr_wr_z;
-    else 
-       return NULL;
+    uint8_t marker;
+
+    flashPageRead(block_addr, 0);
+    flashReadFromCache(FLASH_BAD_BLOCK_COL, &marker, 1);
+
+    return marker != 0xFF;
 }
 
-uint8_t  getPageAddrWr(axis_t axis)
+
+// Set the bad block marker so that the block is never used again, even
+// if the bad block table is lost. Best effort, the block may not take it
+void flashMarkBlockBad(uint16_t block_addr)
 {
-    if (axis == x_active)
-       return page_addr_wr_x;
-    else if (axis == y_active)
-       return page_addr_wr_y;
-    else if (axis == z_active)
-       return page_addr_wr_z;
-    else 
-       return NULL;
-}
+    ADI_ALIGNED_PRAGMA(4)
+    static uint8_t marker_buf[FLASH_PROG_LOAD_HDR_B + 1] ADI_ALIGNED_ATTRIBUTE(4);
+
+    marker_buf[FLASH_PROG_LOAD_HDR_B] = 0x00;
 
+    flashProgramLoad(FLASH_BAD_BLOCK_COL, marker_buf, 1);
+    waitForSpi2();
+
+    flashProgramExecute(block_addr, 0);
+    waitForSpi2();
+
+    pollFlashStatus(BITP_FLSH_STAT_OIP, false);
+}
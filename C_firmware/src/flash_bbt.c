@@ -0,0 +1,220 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+
+/*!
+* @file      flash_bbt.c
+* @brief     Bad block management for the data blocks of the external flash
+*
+* @details
+*            The data area keeps a fixed layout, each block of it is a slot.
+*            When the block in a slot goes bad it is replaced by one of the
+*            FLASH_SPARE_BLOCKS spare blocks and every access to the slot goes
+*            to the spare from then on.
+*
+*            The table of replacements is written to the next page of
+*            FLASH_BBT_BLOCK whenever it changes, the newest valid page is
+*            used at power up. On the very first power up the factory bad
+*            block markers of the data and spare blocks are scanned to build
+*            the table. Blocks that fail later are marked bad as well.
+*
+*/
+/*=======================  I N C L U D E S   =================================*/
+
+#include <string.h>
+#include <stddef.h>
+
+#include "flash_bbt.h"
+
+#if 0
+  #define DEBUG_PRINT(a) printf a
+#else
+  #define DEBUG_PRINT(a) (void)0
+#endif
+
+/*=============  D A T A  =============*/
+
+static bbt_t bbt;
+static bool  bbtFound = false;   // A table has been read from or written to the flash
+
+// Program load buffer. Command bytes followed by the table
+ADI_ALIGNED_PRAGMA(4)
+static uint8_t bbtPageBuf[FLASH_PROG_LOAD_HDR_B + sizeof(bbt_t)] ADI_ALIGNED_ATTRIBUTE(4);
+
+/*=======================  L O C A L    F U N C T I O N S  ===================*/
+
+static uint32_t bbtCrc(const bbt_t *table)
+{
+    return flashCrc32(0, (const uint8_t*)table, offsetof(bbt_t, crc));
+}
+
+
+// Write the table to the next page of its block. The block is only erased
+// when it is full, which takes more updates than there are spares
+static void bbtSave(void)
+{
+    uint8_t page;
+
+    if (bbtFound)
+        bbt.gen++;
+
+    page = (uint8_t)(bbt.gen % NUM_FLASH_PAGES_PER_BLOCK);
+    if (page == 0)
+        flashEraseBlock(FLASH_BBT_BLOCK, false);
+
+    bbt.magic = BBT_MAGIC;
+    bbt.crc   = bbtCrc(&bbt);
+    bbtFound  = true;
+
+    // The table isn't word aligned after the command bytes
+    memcpy(&bbtPageBuf[FLASH_PROG_LOAD_HDR_B], &bbt, sizeof(bbt));
+    flashWritePage(FLASH_BBT_BLOCK, page, bbtPageBuf, sizeof(bbt));
+}
+
+
+// Take a spare block and erase it, skipping any that fail.
+// Returns NUM_FLASH_BLOCKS when none are left
+static uint16_t allocSpare(void)
+{
+    uint16_t block;
+
+    for (uint8_t i = 0; i < FLASH_SPARE_BLOCKS; i++)
+    {
+        if (bbt.sparesUsed & (1u << i))
+            continue;
+
+        bbt.sparesUsed |= (1u << i);
+        block = FLASH_SPARE_START_BLOCK + i;
+
+        flashEraseBlock(block, false);
+        if (!flashOpFailed())
+            return block;
+
+        flashMarkBlockBad(block);
+    }
+
+    return NUM_FLASH_BLOCKS;
+}
+
+
+// Point a slot at a new block, adding an entry if it hasn't been replaced before
+static bool setRemap(uint16_t slot, uint16_t block)
+{
+    for (uint8_t i = 0; i < bbt.numRemaps; i++)
+    {
+        if (bbt.remap[i].slot == slot)
+        {
+            bbt.remap[i].block = block;
+            return true;
+        }
+    }
+
+    if (bbt.numRemaps >= FLASH_SPARE_BLOCKS)
+        return false;
+
+    bbt.remap[bbt.numRemaps].slot  = slot;
+    bbt.remap[bbt.numRemaps].block = block;
+    bbt.numRemaps++;
+    return true;
+}
+
+
+// First power up. Build the table from the factory bad block markers
+static void bbtFormat(void)
+{
+    uint16_t spare;
+
+    memset(&bbt, 0, sizeof(bbt));
+
+    for (uint8_t i = 0; i < FLASH_SPARE_BLOCKS; i++)
+    {
+        if (flashBlockMarkedBad(FLASH_SPARE_START_BLOCK + i))
+            bbt.sparesUsed |= (1u << i);
+    }
+
+    for (uint16_t slot = 0; slot < NUM_FLASH_DATA_BLOCKS; slot++)
+    {
+        if (!flashBlockMarkedBad(slot))
+            continue;
+
+        DEBUG_PRINT(("Factory bad block %d\n", slot));
+
+        spare = allocSpare();
+        if (spare == NUM_FLASH_BLOCKS)
+            break;
+
+        setRemap(slot, spare);
+    }
+
+    bbtSave();
+}
+
+/*==========================  C O D E  =======================================*/
+
+// Load the newest bad block table. Must be called after the flash SPI has
+// been initialised and the blocks unlocked, and before the data area is used
+void bbtInit(void)
+{
+    bbt_t table;
+
+    bbtFound = false;
+
+    // Pages are written in order from page 0 so the first one that isn't
+    // valid is the end of the table's history
+    for (uint8_t page = 0; page < NUM_FLASH_PAGES_PER_BLOCK; page++)
+    {
+        flashReadPage(FLASH_BBT_BLOCK, page, (uint8_t*)&table, sizeof(table));
+
+        if ((table.magic != BBT_MAGIC) || (table.crc != bbtCrc(&table)) ||
+            (table.numRemaps > FLASH_SPARE_BLOCKS) || ((table.gen % NUM_FLASH_PAGES_PER_BLOCK) != page))
+            break;
+
+        bbt      = table;
+        bbtFound = true;
+    }
+
+    if (!bbtFound)
+        bbtFormat();
+
+    DEBUG_PRINT(("%d bad blocks replaced\n", bbt.numRemaps));
+}
+
+
+// Block that currently holds a slot of the data area
+uint16_t bbtMap(uint16_t slot)
+{
+    for (uint8_t i = 0; i < bbt.numRemaps; i++)
+    {
+        if (bbt.remap[i].slot == slot)
+            return bbt.remap[i].block;
+    }
+
+    return slot;
+}
+
+
+// The block in a slot failed to program or erase. Mark it bad and replace
+// it with an erased spare. Returns false if there are no spares left, in
+// which case the slot keeps using the failing block
+bool bbtRetire(uint16_t slot)
+{
+    uint16_t old = bbtMap(slot);
+    uint16_t spare;
+
+    spare = allocSpare();
+    if ((spare == NUM_FLASH_BLOCKS) || !setRemap(slot, spare))
+    {
+        DEBUG_PRINT(("No spare block for %d\n", slot));
+        return false;
+    }
+
+    flashMarkBlockBad(old);
+    bbtSave();
+
+    DEBUG_PRINT(("Block %d replaced by %d\n", old, spare));
+    return true;
+}
@@ -0,0 +1,508 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+
+/*!
+* @file      flash_fft.c
+* @brief     Out-of-core FFT of captures stored in the external flash
+*
+* @details
+*            The N real samples of an axis are packed into M = N/2 complex
+*            points, z[m] = x[2m] + i x[2m+1], and Z = FFT(z) is split into
+*            the spectrum of x at the end.
+*
+*            Z is worked out with the four-step method. With M = R * C and
+*            m = c + C r, k = R k1 + k2:
+*
+*              Z[R k1 + k2] = sum over c of  W_C^(c k1) W_M^(c k2)
+*                                            sum over r of  z[c + C r] W_R^(r k2)
+*
+*            Only FLASH_FFT_WORK_LEN points fit in RAM, so the data goes
+*            through two scratch areas in the FLASH_FFT_BLOCKS reserved
+*            blocks. Every pass writes whole pages in order:
+*
+*              A: the samples are read in order, a band of rows at a time,
+*                 and written out band by band with each column's part of
+*                 the band together
+*              B: for a group of columns, their parts are read from every
+*                 band, the length R FFTs done, the twiddles applied and
+*                 the group written out row by row
+*              C: for a pair of rows k2 and R - k2, their parts are read
+*                 from every group and the length C FFTs done. The pair
+*                 holds both Z[k] and Z[M - k] for every k of the rows,
+*                 which is what the split needs
+*
+*            The reads of B and C only take the part of a page they need
+*            from the flash cache. Captures with M <= FLASH_FFT_WORK_LEN
+*            are done in RAM.
+*
+*            The scratch blocks are erased for every axis. If one fails the
+*            FFT is given up and no spectrum is stored.
+*
+*/
+/*=======================  I N C L U D E S   =================================*/
+
+#include <string.h>
+#include <math.h>
+#include <arm_math.h>
+#include <arm_const_structs.h>
+
+#include "flash_fft.h"
+#include "sample_codec.h"
+#include "capture_archive.h"
+#include "calibration.h"
+
+#if 0
+  #define DEBUG_PRINT(a) printf a
+#else
+  #define DEBUG_PRINT(a) (void)0
+#endif
+
+/*=============  D E F I N E S  =============*/
+#define FF_AREA_COLS        0u    // Written by pass A
+#define FF_AREA_ROWS        1u    // Written by pass B
+#define FF_AREA_BLOCKS      (FLASH_FFT_BLOCKS / 2u)
+#define FF_WORK_PAGES       (FLASH_FFT_WORK_LEN / FLASH_FFT_PAGE_LEN)
+#define FF_NO_ROW           0xFFFFu
+
+/*=============  D A T A  =============*/
+
+// The FFT buffers of short captures are free while a long one is processed
+extern float fftInBuf[];
+extern float fftOutBuf[];
+extern float fftMagOutBuf[];
+
+#define ffWork      fftOutBuf                                // FLASH_FFT_WORK_LEN complex points
+#define ffWrPage    ((uint8_t*)fftInBuf)                     // Program load buffer
+#define ffRdPage    ((uint8_t*)fftMagOutBuf)                 // Compressed sample page
+
+static uint32_t    ffLen;          // M
+static uint16_t    ffRows;         // R
+static uint16_t    ffCols;         // C
+static uint16_t    ffCacheRow;     // Page in the flash cache, FF_NO_ROW if unknown
+static uint16_t    ffFirstBin;
+static uint16_t    ffNumBins;
+static uint8_t     *ffSpec;
+
+// Sample pages of the axis being transformed
+static uint8_t     ffAxisIdx;
+static uint8_t     ffNumAxes;
+static uint32_t    ffInPage;
+static codec_dec_t ffDec;
+static bool        ffCalEn;
+
+/*=======================  L O C A L    F U N C T I O N S  ===================*/
+
+static const arm_cfft_instance_f32* cfftInstance(uint32_t len)
+{
+    switch (len)
+    {
+        case 16:   return &arm_cfft_sR_f32_len16;
+        case 32:   return &arm_cfft_sR_f32_len32;
+        case 64:   return &arm_cfft_sR_f32_len64;
+        case 128:  return &arm_cfft_sR_f32_len128;
+        case 256:  return &arm_cfft_sR_f32_len256;
+        case 512:  return &arm_cfft_sR_f32_len512;
+        case 1024: return &arm_cfft_sR_f32_len1024;
+        default:   return NULL;
+    }
+}
+
+
+static uint8_t log2u(uint32_t value)
+{
+    uint8_t n = 0;
+
+    while (value > 1u)
+    {
+        value >>= 1;
+        n++;
+    }
+
+    return n;
+}
+
+
+// Next sample of the axis, reading and decoding its pages in order
+static bool nextSample(float *sample)
+{
+    uint16_t x;
+    uint16_t row;
+
+    while (!codecGet(&ffDec, &x))
+    {
+        row = archCapRow(ffInPage * ffNumAxes + ffAxisIdx);
+        ffInPage++;
+
+        flashReadPage(FLASH_ROW_BLOCK(row), FLASH_ROW_PAGE(row), ffRdPage, FLASH_PAGE_SIZE_B);
+        ffCacheRow = FF_NO_ROW;
+
+        if (!codecDecStart(&ffDec, ffRdPage))
+        {
+            DEBUG_PRINT(("FFT: page %d isn't compressed\n", ffInPage - 1u));
+            return false;
+        }
+    }
+
+    *sample = sampleToFloat(x, ffCalEn);
+    return true;
+}
+
+
+static uint16_t scratchRow(uint8_t area, uint32_t page)
+{
+    uint16_t block = (uint16_t)(FLASH_FFT_START_BLOCK + area * FF_AREA_BLOCKS + page / NUM_FLASH_PAGES_PER_BLOCK);
+
+    return FLASH_ROW(block, page % NUM_FLASH_PAGES_PER_BLOCK);
+}
+
+
+static bool scratchErase(uint8_t area)
+{
+    uint32_t pages = ffLen / FLASH_FFT_PAGE_LEN;
+
+    for (uint32_t b = 0; b * NUM_FLASH_PAGES_PER_BLOCK < pages; b++)
+    {
+        flashEraseBlock((uint16_t)(FLASH_FFT_START_BLOCK + area * FF_AREA_BLOCKS + b), true);
+        if (flashOpFailed())
+        {
+            DEBUG_PRINT(("FFT: scratch erase failed\n"));
+            return false;
+        }
+    }
+
+    ffCacheRow = FF_NO_ROW;
+    return true;
+}
+
+
+// Program the page that has been put together in ffWrPage
+static bool scratchWrite(uint8_t area, uint32_t page)
+{
+    uint16_t row = scratchRow(area, page);
+
+    flashWritePage(FLASH_ROW_BLOCK(row), FLASH_ROW_PAGE(row), ffWrPage, FLASH_PAGE_SIZE_B);
+    ffCacheRow = FF_NO_ROW;
+
+    return !flashOpFailed();
+}
+
+
+// Read n complex points from index idx of a scratch area. The page is only
+// loaded into the flash cache if it isn't there already
+static void scratchRead(uint8_t area, uint32_t idx, float *dst, uint32_t n)
+{
+    while (n > 0)
+    {
+        uint32_t page  = idx / FLASH_FFT_PAGE_LEN;
+        uint32_t off   = idx % FLASH_FFT_PAGE_LEN;
+        uint32_t count = FLASH_FFT_PAGE_LEN - off;
+        uint16_t row   = scratchRow(area, page);
+
+        if (count > n)
+            count = n;
+
+        if (row != ffCacheRow)
+        {
+            flashPageRead(FLASH_ROW_BLOCK(row), FLASH_ROW_PAGE(row));
+            ffCacheRow = row;
+        }
+
+        flashReadFromCache((uint16_t)(off * 2u * sizeof(float)), (uint8_t*)dst, count * 2u * sizeof(float));
+
+        dst += 2u * count;
+        idx += count;
+        n   -= count;
+    }
+}
+
+
+// Multiply by W_M^(c k2) for every k2 of column c
+static void twiddleColumn(float *col, uint32_t c)
+{
+    for (uint32_t k2 = 0; k2 < ffRows; k2++)
+    {
+        float theta = (2.0f * PI / (float)ffLen) * (float)((c * k2) % ffLen);
+        float wr    = arm_cos_f32(theta);
+        float wi    = -arm_sin_f32(theta);
+        float re    = col[2u * k2];
+        float im    = col[2u * k2 + 1u];
+
+        col[2u * k2]      = re * wr - im * wi;
+        col[2u * k2 + 1u] = re * wi + im * wr;
+    }
+}
+
+
+// Bins of row k2 that are in the band. partner is the row holding Z[M - k]
+// for every Z[k] of row, which is row itself for k2 = 0 and k2 = R/2
+static void specRow(const float *row, const float *partner, uint16_t k2)
+{
+    float scale = 1.0f / (float)(2u * ffLen);
+
+    for (uint32_t k1 = 0; k1 < ffCols; k1++)
+    {
+        uint32_t k = (uint32_t)ffRows * k1 + k2;
+        uint32_t k1p;
+        uint16_t v;
+        float    a, b, c, d, er, ei, or_, oi, theta, wr, ws, xr, xi, mag;
+
+        if ((k < ffFirstBin) || (k >= (uint32_t)ffFirstBin + ffNumBins))
+            continue;
+
+        k1p = (k2 == 0) ? ((ffCols - k1) & (ffCols - 1u)) : (ffCols - 1u - k1);
+
+        // Z[k] = a + ib, Z[M - k] = c + id. The spectrum of x is
+        // X[k] = E + W_N^k O with E = (Z[k] + Z*[M - k]) / 2 and
+        // O = -i (Z[k] - Z*[M - k]) / 2
+        a = row[2u * k1];
+        b = row[2u * k1 + 1u];
+        c = partner[2u * k1p];
+        d = partner[2u * k1p + 1u];
+
+        er  = 0.5f * (a + c);
+        ei  = 0.5f * (b - d);
+        or_ = 0.5f * (b + d);
+        oi  = 0.5f * (c - a);
+
+        theta = (PI / (float)ffLen) * (float)k;
+        wr    = arm_cos_f32(theta);
+        ws    = arm_sin_f32(theta);
+
+        xr  = er + wr * or_ + ws * oi;
+        xi  = ei + wr * oi - ws * or_;
+        mag = sqrtf(xr * xr + xi * xi) * scale;
+
+        v   = (mag < (float)UINT16_MAX) ? (uint16_t)mag : UINT16_MAX;
+
+        ffSpec[SPEC_HDR_B + 2u * (k - ffFirstBin)]      = (uint8_t)(v & 0xFFu);
+        ffSpec[SPEC_HDR_B + 2u * (k - ffFirstBin) + 1u] = (uint8_t)(v >> 8);
+    }
+}
+
+
+// Captures that fit in RAM need no scratch
+static bool fftInRam(void)
+{
+    for (uint32_t i = 0; i < 2u * ffLen; i++)
+    {
+        if (!nextSample(&ffWork[i]))
+            return false;
+    }
+
+    arm_cfft_f32(cfftInstance(ffLen), ffWork, 0, 1);
+
+    ffRows = 1;
+    ffCols = (uint16_t)ffLen;
+    specRow(ffWork, ffWork, 0);
+    return true;
+}
+
+
+// Samples in order, a band of rows at a time, each column's part kept together
+static bool passBands(void)
+{
+    uint32_t band = FLASH_FFT_WORK_LEN / ffCols;
+
+    if (!scratchErase(FF_AREA_COLS))
+        return false;
+
+    for (uint32_t b = 0; b < ffRows / band; b++)
+    {
+        for (uint32_t r = 0; r < band; r++)
+        {
+            for (uint32_t c = 0; c < ffCols; c++)
+            {
+                float *z = &ffWork[2u * (c * band + r)];
+
+                if (!nextSample(&z[0]) || !nextSample(&z[1]))
+                    return false;
+            }
+        }
+
+        for (uint32_t p = 0; p < FF_WORK_PAGES; p++)
+        {
+            memcpy(&ffWrPage[FLASH_PROG_LOAD_HDR_B], &ffWork[2u * p * FLASH_FFT_PAGE_LEN], FLASH_PAGE_SIZE_B);
+            if (!scratchWrite(FF_AREA_COLS, b * FF_WORK_PAGES + p))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
+// Column FFTs and twiddles, a group of columns at a time, written out by row
+static bool passColumns(void)
+{
+    uint32_t band  = FLASH_FFT_WORK_LEN / ffCols;
+    uint32_t group = FLASH_FFT_WORK_LEN / ffRows;
+
+    if (!scratchErase(FF_AREA_ROWS))
+        return false;
+
+    for (uint32_t g = 0; g < ffCols / group; g++)
+    {
+        for (uint32_t b = 0; b < ffRows / band; b++)
+        {
+            for (uint32_t cl = 0; cl < group; cl++)
+                scratchRead(FF_AREA_COLS, b * FLASH_FFT_WORK_LEN + (g * group + cl) * band,
+                            &ffWork[2u * (cl * ffRows + b * band)], band);
+        }
+
+        for (uint32_t cl = 0; cl < group; cl++)
+        {
+            arm_cfft_f32(cfftInstance(ffRows), &ffWork[2u * cl * ffRows], 0, 1);
+            twiddleColumn(&ffWork[2u * cl * ffRows], g * group + cl);
+        }
+
+        for (uint32_t p = 0; p < FF_WORK_PAGES; p++)
+        {
+            for (uint32_t j = 0; j < FLASH_FFT_PAGE_LEN; j++)
+            {
+                uint32_t idx = p * FLASH_FFT_PAGE_LEN + j;
+
+                memcpy(&ffWrPage[FLASH_PROG_LOAD_HDR_B + j * 2u * sizeof(float)],
+                       &ffWork[2u * ((idx % group) * ffRows + idx / group)], 2u * sizeof(float));
+            }
+
+            if (!scratchWrite(FF_AREA_ROWS, g * FF_WORK_PAGES + p))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
+static void loadRow(uint32_t k2, float *dst)
+{
+    uint32_t group = FLASH_FFT_WORK_LEN / ffRows;
+
+    for (uint32_t g = 0; g < ffCols / group; g++)
+        scratchRead(FF_AREA_ROWS, g * FLASH_FFT_WORK_LEN + k2 * group, &dst[2u * g * group], group);
+}
+
+
+// Row FFTs, in pairs k2 and R - k2, and the bins of the band
+static void passRows(void)
+{
+    float *rowA = &ffWork[0];
+    float *rowB = &ffWork[2u * ffCols];
+
+    for (uint16_t k2 = 0; k2 <= ffRows / 2u; k2++)
+    {
+        uint16_t k2p = (uint16_t)((ffRows - k2) % ffRows);
+
+        loadRow(k2, rowA);
+        arm_cfft_f32(cfftInstance(ffCols), rowA, 0, 1);
+
+        if (k2p == k2)
+        {
+            specRow(rowA, rowA, k2);
+        }
+        else
+        {
+            loadRow(k2p, rowB);
+            arm_cfft_f32(cfftInstance(ffCols), rowB, 0, 1);
+
+            specRow(rowA, rowB, k2);
+            specRow(rowB, rowA, k2p);
+        }
+    }
+}
+
+/*==========================  C O D E  =======================================*/
+
+// Samples of a capture that are transformed, 0 if it is too short
+uint32_t flashFftLen(uint32_t numSamples)
+{
+    uint32_t len = FLASH_FFT_MAX_LEN;
+
+    if (numSamples < FLASH_FFT_MIN_LEN)
+        return 0;
+
+    while (len > numSamples)
+        len >>= 1;
+
+    return len;
+}
+
+
+// Transform the n-th of numAxes axes of the capture being stored, which
+// must be compressed and have all its pages programmed. Up to SPEC_MAX_BINS
+// bins from firstBin go in specPage, a FLASH_PAGE_SIZE_B byte page.
+// Blocks until done, returns false if the FFT couldn't be completed
+bool flashFftRun(uint8_t axisIdx, uint8_t numAxes, uint32_t numSamples, uint16_t firstBin, uint8_t *specPage)
+{
+    spec_page_hdr_t hdr;
+    uint32_t        len = flashFftLen(numSamples);
+    uint8_t         m;
+    bool            ok;
+
+    if (len == 0)
+        return false;
+
+    ffLen      = len / 2u;
+    ffAxisIdx  = axisIdx;
+    ffNumAxes  = numAxes;
+    ffInPage   = 0;
+    ffCacheRow = FF_NO_ROW;
+    ffCalEn    = calIsValid();
+    ffSpec     = specPage;
+    memset(&ffDec, 0, sizeof(ffDec));
+
+    // The band is cut short at the top of the spectrum
+    ffFirstBin = firstBin;
+    ffNumBins  = 0;
+    if (firstBin < ffLen)
+        ffNumBins = (uint16_t)(((ffLen - firstBin) < SPEC_MAX_BINS) ? (ffLen - firstBin) : SPEC_MAX_BINS);
+
+    memset(specPage, 0, FLASH_PAGE_SIZE_B);
+
+    if (ffLen <= FLASH_FFT_WORK_LEN)
+    {
+        ok = fftInRam();
+    }
+    else
+    {
+        // As square as possible, R <= C
+        m      = log2u(ffLen);
+        ffRows = (uint16_t)(1u << (m / 2u));
+        ffCols = (uint16_t)(1u << (m - m / 2u));
+
+        ok = passBands() && passColumns();
+        if (ok)
+            passRows();
+    }
+
+    if (!ok)
+        return false;
+
+    hdr.magic    = SPEC_PAGE_MAGIC;
+    hdr.log2Len  = log2u(len);
+    hdr.firstBin = ffFirstBin;
+    hdr.numBins  = ffNumBins;
+    hdr.reserved = 0;
+    memcpy(specPage, &hdr, sizeof(hdr));
+
+    DEBUG_PRINT(("FFT of %d samples, bins %d to %d\n", len, ffFirstBin, ffFirstBin + ffNumBins));
+    return true;
+}
+
+
+// Used bytes of a spectrum page, 0 if it isn't one
+uint16_t flashFftPageBytes(const uint8_t *page)
+{
+    spec_page_hdr_t hdr;
+
+    memcpy(&hdr, page, sizeof(hdr));
+    if ((hdr.magic != SPEC_PAGE_MAGIC) || (hdr.numBins > SPEC_MAX_BINS))
+        return 0;
+
+    return (uint16_t)(SPEC_HDR_B + 2u * hdr.numBins);
+}
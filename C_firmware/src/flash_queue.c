@@ -0,0 +1,368 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+
+/*!
+* @file      flash_queue.c
+* @brief     Interrupt driven command queue for the external flash
+*
+* @details
+*            Commands are run one after the other without the caller waiting
+*            on the flash. Each one goes through these steps, every step
+*            being started from the interrupt that ends the one before:
+*
+*              READY (read status until OIP clears) [-> WREN (write enable)]
+*              -> CMD [-> DONE (read status until OIP clears)]
+*
+*            A status read is an SPI2 transfer whose completion comes in
+*            through spi2Callback(). While the flash is still busy the GP2
+*            timer is started and the status is read again when it fires,
+*            rather than the SPI being kept busy.
+*
+*            Program execute, page read and erase end with the DONE step,
+*            the others finish as soon as their transfer has. The callback
+*            of a command gets the last status read so it can check the
+*            fail bits.
+*
+*            The blocking functions of ext_flash.c wait for the queue to be
+*            empty before they use the flash, see isSpi2Busy().
+*
+*/
+/*=======================  I N C L U D E S   =================================*/
+
+#include <string.h>
+#include <adi_processor.h>
+#include <drivers/tmr/adi_tmr.h>
+
+#include "flash_queue.h"
+#include "ext_flash.h"
+
+#if 0
+  #define DEBUG_PRINT(a) printf a
+#else
+  #define DEBUG_PRINT(a) (void)0
+#endif
+
+/*=============  TYPEDEFS  =============*/
+typedef enum
+{
+   FQ_STEP_IDLE,
+   FQ_STEP_BUS,       // Waiting for the transfer of a blocking call to finish
+   FQ_STEP_READY,     // Status read before the command
+   FQ_STEP_WREN,
+   FQ_STEP_CMD,
+   FQ_STEP_DONE,      // Status read after the command
+   FQ_STEP_POLL       // Timer running before the next status read
+} fq_step_t;
+
+/*=============  D A T A  =============*/
+
+static fq_job_t           fqQueue[FLASH_QUEUE_LEN];
+static volatile uint8_t   fqHead  = 0;
+static volatile uint8_t   fqCount = 0;
+static volatile fq_step_t fqStep  = FQ_STEP_IDLE;
+static fq_step_t          fqPollStep;     // Status read to go back to when the timer fires
+static ADI_TMR_CONFIG     fqTmrConfig;
+
+// The transfers run after the functions that start them have returned
+static uint8_t            fqCmdBuf[4];
+static uint8_t            fqStatus;
+
+extern uint32_t      hfosc_freq;
+extern volatile bool spi2Busy;
+
+/*=======================  L O C A L    F U N C T I O N S  ===================*/
+
+static void fqTimerCallback(void *pCBParam, uint32_t Event, void *pArg);
+
+
+static bool needsWriteEnable(fq_cmd_t cmd)
+{
+    return (cmd == FQ_CMD_PROGRAM_LOAD) || (cmd == FQ_CMD_PROGRAM_LOAD_RANDOM) ||
+           (cmd == FQ_CMD_PROGRAM_EXECUTE) || (cmd == FQ_CMD_ERASE);
+}
+
+
+// Commands that start an operation in the flash array, which sets OIP
+static bool needsDonePoll(fq_cmd_t cmd)
+{
+    return (cmd == FQ_CMD_PROGRAM_EXECUTE) || (cmd == FQ_CMD_PAGE_READ) || (cmd == FQ_CMD_ERASE);
+}
+
+
+static void readStatus(fq_step_t step)
+{
+    SpiRW_s spi_rw;
+
+    fqCmdBuf[0] = GET_FEATURES_FLASH;
+    fqCmdBuf[1] = FLASH_STATUS_ADDR;
+
+    spi_rw.n_bytes_rx = 1u;
+    spi_rw.n_bytes_tx = 2u;
+    spi_rw.bDMA       = false;
+    spi_rw.blocking   = false;
+
+    fqStep = step;
+    spiReadFlashStart(&fqStatus, fqCmdBuf, spi_rw);
+}
+
+
+static void writeEnable(fq_step_t step)
+{
+    SpiRW_s spi_rw;
+
+    fqCmdBuf[0] = WRITE_ENABLE_FLASH;
+
+    spi_rw.n_bytes_rx = 0;
+    spi_rw.n_bytes_tx = 1u;
+    spi_rw.bDMA       = false;
+    spi_rw.blocking   = false;
+
+    fqStep = step;
+    spiWriteFlashStart(fqCmdBuf, spi_rw);
+}
+
+
+// Block and page address commands: [31:24] CMD, [23:16] 0x00,
+// [15:6] block addr, [5:0] page addr
+static void rowCommand(uint8_t cmd, uint16_t block, uint8_t page)
+{
+    SpiRW_s spi_rw;
+
+    fqCmdBuf[0] = cmd;
+    fqCmdBuf[1] = (uint8_t)((block & 0x3FFu) >> 10);
+    fqCmdBuf[2] = (uint8_t)((block & 0x3FFu) >> 2);
+    fqCmdBuf[3] = (uint8_t)(((block & 0x3u) << 6) | (page & 0x3Fu));
+
+    spi_rw.n_bytes_rx = 0;
+    spi_rw.n_bytes_tx = 4u;
+    spi_rw.bDMA       = false;
+    spi_rw.blocking   = false;
+
+    spiWriteFlashStart(fqCmdBuf, spi_rw);
+}
+
+
+static void sendCommand(fq_job_t *job)
+{
+    SpiRW_s spi_rw;
+
+    fqStep = FQ_STEP_CMD;
+
+    switch (job->cmd)
+    {
+        case FQ_CMD_WRITE_ENABLE:
+            writeEnable(FQ_STEP_CMD);
+            break;
+
+        case FQ_CMD_PROGRAM_LOAD:
+        case FQ_CMD_PROGRAM_LOAD_RANDOM:
+            // [23:16] CMD, [15:12] 0x0, [11:0] column address, held in the
+            // start of the buffer so the transfer is continuous
+            job->pBuf[0] = (job->cmd == FQ_CMD_PROGRAM_LOAD) ? PROGRAM_LOAD_FLASH : PROGRAM_LOAD_RANDOM_FLASH;
+            job->pBuf[1] = (uint8_t)((job->column >> 8) & 0x0Fu);
+            job->pBuf[2] = (uint8_t)(job->column & 0xFFu);
+
+            spi_rw.n_bytes_rx = 0;
+            spi_rw.n_bytes_tx = job->nBytes + FLASH_PROG_LOAD_HDR_B;
+            spi_rw.bDMA       = false;
+            spi_rw.blocking   = false;
+
+            spiWriteFlashStart(job->pBuf, spi_rw);
+            break;
+
+        case FQ_CMD_PROGRAM_EXECUTE:
+            rowCommand(PROGRAM_EXE_FLASH, job->block, job->page);
+            break;
+
+        case FQ_CMD_PAGE_READ:
+            rowCommand(PAGE_READ_FLASH, job->block, job->page);
+            break;
+
+        case FQ_CMD_ERASE:
+            rowCommand(BLOCK_ERASE_FLASH, job->block, 0);
+            break;
+
+        case FQ_CMD_READ_CACHE:
+            // [23:16] CMD, [15:12] 0x0, [11:0] column address, then a dummy byte
+            fqCmdBuf[0] = READ_FROM_CACHE_FLASH;
+            fqCmdBuf[1] = (uint8_t)((job->column >> 8) & 0x0Fu);
+            fqCmdBuf[2] = (uint8_t)(job->column & 0xFFu);
+            fqCmdBuf[3] = 0x00;
+
+            spi_rw.n_bytes_rx = job->nBytes;
+            spi_rw.n_bytes_tx = 4u;
+            spi_rw.bDMA       = false;
+            spi_rw.blocking   = false;
+
+            spiReadFlashStart(job->pBuf, fqCmdBuf, spi_rw);
+            break;
+    }
+}
+
+
+static void startPoll(fq_step_t step)
+{
+    fqPollStep = step;
+    fqStep     = FQ_STEP_POLL;
+    adi_tmr_Enable(ADI_TMR_DEVICE_GP2, true);
+}
+
+
+static uint8_t statusRead(void)
+{
+#ifndef COG
+    return fqStatus;
+#else
+    return 0;
+#endif
+}
+
+
+// The command at the head has finished. It is removed before its callback
+// runs so the callback can see the queue as it will be
+static void finishJob(uint8_t status)
+{
+    fq_job_t job = fqQueue[fqHead];
+
+    fqHead = (fqHead + 1u) % FLASH_QUEUE_LEN;
+    fqCount--;
+    fqStep = FQ_STEP_IDLE;
+
+    if (job.callback != NULL)
+        job.callback(job.param, status);
+
+    if ((fqCount > 0) && (fqStep == FQ_STEP_IDLE))
+        readStatus(FQ_STEP_READY);
+}
+
+
+static void fqTimerCallback(void *pCBParam, uint32_t Event, void *pArg)
+{
+    if ((Event & ADI_TMR_EVENT_TIMEOUT) != ADI_TMR_EVENT_TIMEOUT)
+        return;
+
+    adi_tmr_Enable(ADI_TMR_DEVICE_GP2, false);
+
+    if (fqStep == FQ_STEP_POLL)
+        readStatus(fqPollStep);
+}
+
+/*==========================  C O D E  =======================================*/
+
+// Set up the status poll timer. Must be called after the clocks are set
+void flashQueueInit(void)
+{
+    fqHead  = 0;
+    fqCount = 0;
+    fqStep  = FQ_STEP_IDLE;
+
+    adi_tmr_Init(ADI_TMR_DEVICE_GP2, fqTimerCallback, NULL, true);
+
+    fqTmrConfig.bCountingUp  = false;
+    fqTmrConfig.bPeriodic    = true;
+    fqTmrConfig.ePrescaler   = ADI_TMR_PRESCALER_16;
+    fqTmrConfig.eClockSource = ADI_TMR_CLOCK_HFOSC;
+    fqTmrConfig.nLoad        = (uint16_t)(((uint64_t)FLASH_QUEUE_POLL_US * hfosc_freq) / 16000000u);
+    fqTmrConfig.nAsyncLoad   = fqTmrConfig.nLoad;
+    fqTmrConfig.bReloading   = false;
+    fqTmrConfig.bSyncBypass  = false;
+    adi_tmr_ConfigTimer(ADI_TMR_DEVICE_GP2, &fqTmrConfig);
+}
+
+
+// Add a command to the queue, starting it if the queue was empty. Buffers
+// must stay valid until the command's callback. Returns false if the queue
+// is full
+bool flashQueueSubmit(const fq_job_t *job)
+{
+    bool start = false;
+
+    if (fqCount >= FLASH_QUEUE_LEN)
+        return false;
+
+    // The interrupts take commands off the queue
+    __disable_irq();
+    fqQueue[(fqHead + fqCount) % FLASH_QUEUE_LEN] = *job;
+    fqCount++;
+
+    if (fqStep == FQ_STEP_IDLE)
+    {
+        // SPI2 may still be sending the last transfer of a blocking call,
+        // its completion starts the queue instead
+        if (spi2Busy)
+            fqStep = FQ_STEP_BUS;
+        else
+            start = true;
+    }
+    __enable_irq();
+
+    if (start)
+        readStatus(FQ_STEP_READY);
+
+    return true;
+}
+
+
+// True while there are commands that haven't finished
+bool flashQueueBusy(void)
+{
+    return fqCount > 0;
+}
+
+
+// Commands that can still be submitted. Only the interrupts take commands
+// off, so a caller that submits from the main loop gets at least this many in
+uint8_t flashQueueRoom(void)
+{
+    return FLASH_QUEUE_LEN - fqCount;
+}
+
+
+// An SPI2 transfer has finished. Called from spi2Callback()
+void flashQueueSpiDone(void)
+{
+    fq_job_t *job = &fqQueue[fqHead];
+
+    switch (fqStep)
+    {
+        case FQ_STEP_BUS:
+            readStatus(FQ_STEP_READY);
+            break;
+
+        case FQ_STEP_READY:
+            if (statusRead() & BITM_FLSH_STAT_OIP)
+                startPoll(FQ_STEP_READY);
+            else if (needsWriteEnable(job->cmd))
+                writeEnable(FQ_STEP_WREN);
+            else
+                sendCommand(job);
+            break;
+
+        case FQ_STEP_WREN:
+            sendCommand(job);
+            break;
+
+        case FQ_STEP_CMD:
+            if (needsDonePoll(job->cmd))
+                startPoll(FQ_STEP_DONE);
+            else
+                finishJob(0);
+            break;
+
+        case FQ_STEP_DONE:
+            if (statusRead() & BITM_FLSH_STAT_OIP)
+                startPoll(FQ_STEP_DONE);
+            else
+                finishJob(statusRead());
+            break;
+
+        default:
+            // Transfer of a blocking call
+            break;
+    }
+}
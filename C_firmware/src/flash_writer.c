@@ -0,0 +1,344 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+
+/*!
+* @file      flash_writer.c
+* @brief     Queued page writer for the external flash
+*
+* @details
+*            Full sample buffers from any stream are queued in the order they
+*            complete and written one page at a time:
+*
+*              IDLE -> PROGRAM (program load and program execute, run by the
+*              flash command queue) [-> ERASE (next block, wait for OIP)]
+*
+*            The program load and execute of a page are chained from
+*            interrupts by the flash command queue, which calls back once
+*            the page has been programmed. flashWrService() only looks at
+*            the result and starts the next page, it never waits on the
+*            flash. That lets the acquisition loop keep reading the ADC
+*            while a page is being programmed or a block erased. The flash
+*            only has one cache register, so the next program load can't
+*            start until the previous program has finished.
+*
+*            A page stays queued until it has been programmed. If the flash
+*            reports that the program failed, the block is swapped for a
+*            spare by the capture archive and the page is loaded again from
+*            its buffer. An erase that fails is handled the same way.
+*
+*            Every page has the CRC-32 of its samples written to its spare
+*            area, FLASH_PAGE_CRC_COL, so it can be checked when it is read
+*            back. The CRC of a queued page is worked out FLASH_WR_CRC_CHUNK_B
+*            bytes per call of flashWrService() rather than all at once, so
+*            the acquisition loop isn't held up. It is loaded into the cache
+*            with a program load random data after the samples, which keeps
+*            them, and both are programmed together.
+*
+*            The time the flash is busy per page is measured with the DWT
+*            cycle counter. This gives the highest sample rate the flash can
+*            keep up with for the number of streams in use.
+*
+*/
+/*=======================  I N C L U D E S   =================================*/
+
+#include <string.h>
+#include <adi_processor.h>
+
+#include "flash_writer.h"
+#include "ext_flash.h"
+#include "flash_queue.h"
+#include "capture_archive.h"
+
+#if 0
+  #define DEBUG_PRINT(a) printf a
+#else
+  #define DEBUG_PRINT(a) (void)0
+#endif
+
+/*=============  TYPEDEFS  =============*/
+typedef enum
+{
+   FLASH_WR_IDLE,
+   FLASH_WR_PROGRAM,
+   FLASH_WR_ERASE
+} flash_wr_state_t;
+
+typedef struct
+{
+   uint8_t  *pBuf;     // Program load header followed by one page of samples
+   uint8_t  stream;
+   uint16_t crcDone;   // Bytes of the page in crc so far
+   uint32_t crc;
+} flash_wr_job_t;
+
+/*=============  D A T A  =============*/
+
+static flash_wr_job_t   wrQueue[FLASH_WR_QUEUE_LEN];
+static uint8_t          wrHead  = 0;
+static uint8_t          wrCount = 0;
+static uint8_t          wrPending[FLASH_WR_MAX_STREAMS];   // Buffers of each stream not yet programmed
+static flash_wr_state_t wrState = FLASH_WR_IDLE;
+static uint32_t         wrStartCycles;
+static flash_wr_stats_t wrStats;
+
+// Set by the command queue once the program of the page has finished
+static volatile bool    wrProgramDone;
+static volatile uint8_t wrProgramStatus;
+
+// Program load buffer. Command bytes followed by the CRC of the page
+ADI_ALIGNED_PRAGMA(4)
+static uint8_t wrCrcBuf[FLASH_PROG_LOAD_HDR_B + sizeof(uint32_t)] ADI_ALIGNED_ATTRIBUTE(4);
+
+extern uint32_t hfosc_freq;
+
+/*=======================  L O C A L    F U N C T I O N S  ===================*/
+
+// Non-blocking read of the flash status register. SPI2 must be free
+static uint16_t flashStatus(void)
+{
+#ifndef COG
+    return getFlashStatus();
+#else
+    return 0;
+#endif
+}
+
+
+// Flash command queue callback, interrupt context
+static void programDone(void *param, uint8_t status)
+{
+    wrProgramStatus = status;
+    wrProgramDone   = true;
+}
+
+
+// Move the CRC of the first queued page that hasn't got one yet on by a chunk
+static void crcService(void)
+{
+    flash_wr_job_t *job;
+    uint16_t        n;
+
+    for (uint8_t i = 0; i < wrCount; i++)
+    {
+        job = &wrQueue[(wrHead + i) % FLASH_WR_QUEUE_LEN];
+        if (job->crcDone >= FLASH_PAGE_SIZE_B)
+            continue;
+
+        n = FLASH_PAGE_SIZE_B - job->crcDone;
+        if (n > FLASH_WR_CRC_CHUNK_B)
+            n = FLASH_WR_CRC_CHUNK_B;
+
+        job->crc      = flashCrc32(job->crc, &job->pBuf[FLASH_PROG_LOAD_HDR_B + job->crcDone], n);
+        job->crcDone += n;
+        return;
+    }
+}
+
+
+// Load the page at the head of the queue and its CRC and program them at the write position
+static void startProgram(flash_wr_job_t *job)
+{
+    fq_job_t cmd;
+    uint16_t row = archWrRow();
+
+    memset(&cmd, 0, sizeof(cmd));
+    wrProgramDone = false;
+
+    cmd.cmd    = FQ_CMD_PROGRAM_LOAD;
+    cmd.pBuf   = job->pBuf;
+    cmd.nBytes = FLASH_PAGE_SIZE_B;
+    flashQueueSubmit(&cmd);
+
+    memcpy(&wrCrcBuf[FLASH_PROG_LOAD_HDR_B], &job->crc, sizeof(job->crc));
+    cmd.cmd    = FQ_CMD_PROGRAM_LOAD_RANDOM;
+    cmd.column = FLASH_PAGE_CRC_COL;
+    cmd.pBuf   = wrCrcBuf;
+    cmd.nBytes = sizeof(job->crc);
+    flashQueueSubmit(&cmd);
+
+    cmd.cmd      = FQ_CMD_PROGRAM_EXECUTE;
+    cmd.block    = FLASH_ROW_BLOCK(row);
+    cmd.page     = FLASH_ROW_PAGE(row);
+    cmd.column   = 0;
+    cmd.pBuf     = NULL;
+    cmd.nBytes   = 0;
+    cmd.callback = programDone;
+    flashQueueSubmit(&cmd);
+}
+
+
+static void jobDone(void)
+{
+    wrStats.busyCycles += DWT->CYCCNT - wrStartCycles;
+    wrStats.pagesWritten++;
+
+    wrHead = (wrHead + 1u) % FLASH_WR_QUEUE_LEN;
+    wrCount--;
+    wrState = FLASH_WR_IDLE;
+}
+
+/*==========================  C O D E  =======================================*/
+
+// Clear the queue and statistics before a capture. numStreams is only used
+// to work out the maximum sample rate
+void flashWrStart(uint8_t numStreams)
+{
+    wrHead  = 0;
+    wrCount = 0;
+    wrState = FLASH_WR_IDLE;
+    memset(wrPending, 0, sizeof(wrPending));
+    memset(&wrStats, 0, sizeof(wrStats));
+    wrStats.numStreams = numStreams;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+
+// Queue one full page of each stream in streamMask, in stream order. A
+// buffer must not be changed until its page has been programmed, which is at
+// most one page later for a ping-pong buffer. The capture archive relies on
+// the streams' pages being interleaved in the same order throughout, so if
+// any stream still has both buffers queued none of the pages are queued and
+// false is returned
+bool flashWrQueueSet(uint8_t streamMask, uint8_t *pBufs[])
+{
+    flash_wr_job_t *job;
+
+    for (uint8_t s = 0; s < FLASH_WR_MAX_STREAMS; s++)
+    {
+        if ((streamMask & (1u << s)) && (wrPending[s] >= FLASH_WR_BUFS_PER_STREAM))
+        {
+            wrStats.overruns++;
+            return false;
+        }
+    }
+
+    for (uint8_t s = 0; s < FLASH_WR_MAX_STREAMS; s++)
+    {
+        if (!(streamMask & (1u << s)))
+            continue;
+
+        job         = &wrQueue[(wrHead + wrCount) % FLASH_WR_QUEUE_LEN];
+        job->pBuf    = pBufs[s];
+        job->stream  = s;
+        job->crc     = 0;
+        job->crcDone = 0;
+        wrPending[s]++;
+        wrCount++;
+    }
+
+    if (wrCount > wrStats.maxQueueDepth)
+        wrStats.maxQueueDepth = wrCount;
+
+    return true;
+}
+
+
+// Move the write of the page at the head of the queue on as far as it can go
+// without waiting. Call as often as possible, the page is loaded and
+// programmed from interrupts in between
+void flashWrService(void)
+{
+    flash_wr_job_t *job = &wrQueue[wrHead];
+    uint16_t        status;
+
+    crcService();
+
+    // Nothing can be sent to the flash while a transfer or queued command is in progress
+    if (isSpi2Busy())
+        return;
+
+    switch (wrState)
+    {
+        case FLASH_WR_IDLE:
+            if ((wrCount == 0) || (job->crcDone < FLASH_PAGE_SIZE_B))
+                break;
+
+            // The buffer is kept until the program has worked in case it has to be loaded again
+            wrStartCycles = DWT->CYCCNT;
+            startProgram(job);
+            wrState = FLASH_WR_PROGRAM;
+            break;
+
+        case FLASH_WR_PROGRAM:
+            if (!wrProgramDone)
+                break;
+
+            if (wrProgramStatus & BITM_FLSH_STAT_P_FAIL)
+            {
+                // Load the same page again into the block's replacement
+                if (archWrFailed())
+                {
+                    wrState = FLASH_WR_IDLE;
+                    break;
+                }
+
+                // No spare left, the page is lost
+            }
+
+            DEBUG_PRINT(("Stream %d page done\n", job->stream));
+
+            // The buffer can be refilled
+            wrPending[job->stream]--;
+
+            // Starts erasing the next block in the background when this page was the last of its block
+            if (archWrAdvance())
+                wrState = FLASH_WR_ERASE;
+            else
+                jobDone();
+            break;
+
+        case FLASH_WR_ERASE:
+            status = flashStatus();
+            if (status & BITM_FLSH_STAT_OIP)
+                break;
+
+            if (status & BITM_FLSH_STAT_E_FAIL)
+                archWrEraseFailed();
+
+            jobDone();
+            break;
+    }
+}
+
+
+// True once every queued page has been programmed
+bool flashWrIdle(void)
+{
+    return (wrCount == 0) && (wrState == FLASH_WR_IDLE);
+}
+
+
+const flash_wr_stats_t* getFlashWrStats(void)
+{
+    return &wrStats;
+}
+
+
+// Average time the flash is busy per page, including block erases
+uint32_t flashWrPageTime_us(void)
+{
+    if (wrStats.pagesWritten == 0)
+        return 0;
+
+    return (uint32_t)(((uint64_t)wrStats.busyCycles * 1000000u) /
+                      ((uint64_t)hfosc_freq * wrStats.pagesWritten));
+}
+
+
+// Highest sample rate at which the flash keeps up with all streams:
+// each stream fills a page every ADC_SAMPLES_PER_BUFF samples
+uint32_t flashWrMaxRate_Hz(void)
+{
+    if ((wrStats.busyCycles == 0) || (wrStats.numStreams == 0))
+        return 0;
+
+    return (uint32_t)(((uint64_t)ADC_SAMPLES_PER_BUFF * wrStats.pagesWritten * hfosc_freq) /
+                      ((uint64_t)wrStats.busyCycles * wrStats.numStreams));
+}
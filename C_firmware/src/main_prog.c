@@ -31,6 +31,15 @@ License Agreement.
 #include "SPI1_AD7685.h"
 #include "shutdown.h"
 #include "ext_flash.h"
+#include "calibration.h"
+#include "capture_plan.h"
+#include "capture_archive.h"
+#include "flash_bbt.h"
+#include "flash_queue.h"
+#include "sample_codec.h"
+#include "flash_fft.h"
+#include "flash_writer.h"
+#include "event_loop.h"
 
 // For printf statements
 #include "stdio.h"
@@ -58,6 +67,15 @@ License Agreement.
 #define PCLOCK  26000000   //Peripheral Clock
 #define ACLOCK  6500000    //ADC Clock (Default 6.5MHz)
 
+/* Period of the heartbeat LED and of the ready message while waiting on the
+ * manager, and the time waited between captures when there is no sleep
+ * and no stream credit */
+#define MAIN_TICK_MS   10000u
+#define WAIT_MS        10000u
+
+/* Flash queue commands to read a page for sending, see readTxPage() */
+#define TX_PAGE_READ_CMDS   3u
+
 //#define COG true
 
 /* User */
@@ -70,6 +88,7 @@ typedef enum
     GET_DATA,
     CALC,
     TX,
+    RETX,
     WAIT,
     SLEEP_MCU,
     WAKEUP
@@ -82,20 +101,15 @@ scheduler_t_us       sampling_scheduler;
 app_vars_t           app_vars;
 
 state_t              state      = RADIO_SETUP;
-int                  waitDone   = 0;
-int                  timerTicks = 0;
-int                  timerTicksPrev = 0;
+static state_t       passState;    // State at the start of this pass of the main loop
 double               cpu_time_used;
-int                  timeoutLimit_ms;
-int                  timerTickLimit;
-int                  numTimeouts_DBG  = 0; // Keep track of timeouts for debug purposes
 int                  numTxSuccess_DBG = 0; // Keep track of successfull TXs for debug purposes
 uint32_t             sleepDur_s       = 0; // Get the desired sleep duration from the GUI
 
 extern uint32_t lastRtcCount = 0;
 
 /* Buffer variables */
-extern int           head,tail;
+extern volatile int  head,tail;
 extern uint8_t       buffer_uart[buffer_size];
 
 /* Flag_Check initialization */
@@ -141,6 +155,37 @@ bool                                radioSetupDone = false;
 
 axis_t      active_axis_tx;
 uint32_t    numSamplesRemaining[3];
+uint16_t    readRow;             // Flash row of the page being sent
+uint32_t    replaySeq;
+uint32_t    offloadStart_s;      // RTC count when the first flash page of a capture was read
+uint32_t    offloadTime_DBG;     // Time taken to send the last capture held in flash, s
+uint32_t    txPageReadFull_DBG;  // Page reads put off because the flash queue was full
+
+static ev_timer_t mainTickTimer; // Every MAIN_TICK_MS, see mainTick()
+static ev_timer_t waitTimer;     // Between captures, in WAIT
+static ev_timer_t retxTimer;     // From the frames last being sent, in full or in part, in RETX
+
+// Flash pages are sent from two buffers in turn. The next page is read into
+// one while the radio sends the other, so the flash reads are hidden behind
+// the radio. The sample arrays are free to use once the capture is in flash.
+// A page is checked against its CRC and the ECC status once it has been read
+// and read again if it fails
+typedef struct
+{
+   uint16_t      *buf;
+   axis_t        axis;
+   uint32_t      numSamplesRemaining;   // Samples of the axis left from the start of this page
+   volatile bool fetching;              // Read queued on the flash
+   volatile bool full;
+   uint16_t      row;
+   uint32_t      crc;                   // From the spare area of the page
+   uint8_t       status;                // Flash status after the page read
+   uint8_t       retries;
+} tx_page_t;
+
+tx_page_t   txPage[2] = { { adcDataX, x_active, 0, false, false }, { adcDataY, x_active, 0, false, false } };
+uint8_t     txPageIdx = 0;           // Buffer being sent, or next to be
+bool        lastTxPage;              // The page being sent is the last of the capture
 
 
 /*=======================  P R O T O T Y P E S   =============================*/
@@ -150,6 +195,17 @@ void      StartScheduler(scheduler_t);
 void      StartSamplingScheduler(scheduler_t_us);
 void      usleep(uint32_t);
 void      setupRadio(void);
+void      setupCapture(uint32_t);
+void      loadArchivedCapture(void);
+void      fetchTxPage(tx_page_t*);
+bool      readTxPage(tx_page_t*);
+void      txPageStatus(void*, uint8_t);
+void      txPageRead(void*, uint8_t);
+bool      txPageOk(tx_page_t*);
+void      reportCaptureEvents(void);
+void      mainTick(void);
+bool      mainIdle(void);
+uint32_t  retxLocate(axis_t, uint32_t, uint32_t, uint8_t**);
 void      initialise();
 state_t   getState();
 //void ledDance();
@@ -172,34 +228,37 @@ int main(void)
    /* It will be pending in the ISR since RTC0 triggered during shutdown */
    rtcInit();
 
-   /* Scheduler initialisation and Start */
+   /* Scheduler initialisation and Start. Its tick drives the timers of the
+    * event loop, command timeouts are timers started with each command */
+   evInit();
    main_scheduler.source=GP_TMR;  //NOTE only GP_TMR source available for now
-   main_scheduler.tick_ms=10000;    // Any time > 500ms will use LF_CLK
+   main_scheduler.tick_ms=EV_TICK_MS;    // Any time > 500ms will use LF_CLK
    StartScheduler(main_scheduler);
-
-   // Define timeout
-   timeoutLimit_ms = 90e3*1;  // 60,000ms in a minute
-   if (main_scheduler.tick_ms >= timeoutLimit_ms)
-        DEBUG_PRINT(("The timeout value needs to be larger than the Main Scheduler period"));
-
-   // Calculate how many ticks of the Main Scheduler need to occur, while
-   // not getting a response, to cause a timeout
-   timerTickLimit = (int)(timeoutLimit_ms/main_scheduler.tick_ms + 0.5);
+   evTimerStart(&mainTickTimer, MAIN_TICK_MS, mainTick);
 
    //ITM_EVENT8(1, 0x1);
    
    initExtFlashSPI();
    prepareFlash();
+   calInit();
+   bbtInit();
+   archInit();
    
    /* Communication State Machine */
    while (1)  // Both FSMs run in this forever loop
    {
+       passState = state;
+
        while(head != tail)
        {
            buffer_handle();                                                     /* here the buffer is checked for incoming data and processed */
        }
 
-       if(!awaiting_response && radioSetupDone)                                 /*Schedule the next event only if not awaiting response, or stuck in the middle of data tranmission*/
+       /* Schedule the next event only if not awaiting response, or stuck in the middle
+        * of data tranmission. A reply may already have scheduled the next command.
+        * awaiting_response covers the step in hand, which may have several commands
+        * waiting on the mote at once, see api_setNetworkID() */
+       if(!awaiting_response && radioSetupDone && !evPending())
        {
            switch(Flag_Check)
            {
@@ -219,14 +278,6 @@ int main(void)
                    scheduleEvent(&api_setNetworkID);                            /* Function call for setting the network ID is done here */
                    break;
 
-               case Get_NetID:
-                   scheduleEvent(&api_getNetworkID);                            /* Function call for getting the network ID is done here */
-                   break;
-
-               case Set_JoinDC:
-                   scheduleEvent(&api_setJoinDutyCycle);                        /* Function call for setting the Join Duty Cycle is done here */
-                   break;
-
                case Join:
                    scheduleEvent(&api_join);                                    /* Function call for joining the network is done here */
                    break;
@@ -246,24 +297,15 @@ int main(void)
                default:
                    break;
            }
-
-           timerTicks = 0;
        }
 
-       if (timerTicks >= timerTickLimit)
-       {
-           numTimeouts_DBG++;
-           DEBUG_PRINT(("T.O. #%d\n", numTimeouts_DBG));
-           scheduleEvent(&api_response_timeout);
-           timerTicks = 0;
-       }
+       /* Commands, retries and timers that are due */
+       evRun();
 
-       if (timerTicked && ((state == WAIT_FOR_READY) || (state == NEW_PARAM)))
-       {
-           // Let manager know you're ready
-           timerTicked = false;
-           scheduleEvent(&sendMgrReady);
-       }
+       // Erase flash blocks ahead of the writer while waiting on the manager or
+       // the radio, so that sampling doesn't have to wait for them
+       if ((state == WAIT_FOR_READY) || (state == NEW_PARAM) || (state == TX) || (state == WAIT))
+           archEraseService();
 
        /* Data handling state machine */
        switch (state)
@@ -288,7 +330,7 @@ int main(void)
            case WAIT_FOR_READY:
                // Wait for the Python code on manager to be 
                // up and running before progressing
-               if (getMgrReady())
+               if (getMgrReady() || streamCredit())
                {
                    state = NEW_PARAM;
                }
@@ -297,47 +339,64 @@ int main(void)
 
            case NEW_PARAM:
 #ifndef OLD_MOTE
-
-               if (getMgrReady())
+               // The manager has asked for an earlier capture to be sent again. 
+               // It is sent with the settings it was taken with, nothing is sampled
+               if (archTakeReplay(&replaySeq) && archOpen(replaySeq))
                {
-                   // Manager will send a ready signal after every full frame is received. 
-                   // If manager SW is closed then sampling will stop
-                   clearMgrReady();
+                   const arch_rec_t* rec = archCurrentRecord();
+                   plan_entry_t      entry;
 
-                   adcSampFreq    = getSampFreq();
-                   adcSampTime_us = getSampTime_us(adcSampFreq);
-                   adcNumSamples  = getAdcNumSamples();
-                   sleepDur_s     = getSleepDur();
+                   entry.sampFreq    = rec->sampFreq;
+                   entry.numSamples  = rec->numSamples;
+                   entry.axisInfo    = rec->axisInfo;
+                   entry.proc        = rec->proc;
+                   entry.fftFirstBin = 0;
+                   planReplayCapture(&entry);
+
+                   setupCapture(rec->numSamples);
 
-                   if (adcNumSamples > ADC_SAMPLES_PER_BUFF) 
+                   if (ext_flash_needed)
                    {
-                       ext_flash_needed = true;   
-                       send_axis_hdr[x_active] = 1;
-                       send_axis_hdr[y_active] = 1;
-                       send_axis_hdr[z_active] = 1;
-                   } 
+                       state = GET_DATA;
+                   }
                    else
                    {
-                       ext_flash_needed = false;
-                       send_axis_hdr[x_active] = 0;
-                       send_axis_hdr[y_active] = 0;
-                       send_axis_hdr[z_active] = 0;
+                       loadArchivedCapture();
+                       state = CALC;
                    }
-                   
-                   updateAdcParams(adcNumSamples, ext_flash_needed);
+                   break;
+               }
+
+               if (getMgrReady() || planCaptureRemaining() || streamCredit())
+               {
+                   // Manager will send a ready signal after every full frame is received,
+                   // unless it has granted credit for frames to stream without one.
+                   // If manager SW is closed then sampling will stop.
+                   // The entries of a capture plan after the first run without waiting for it
+                   bool first_of_wake = !planCaptureRemaining();
+                   if (first_of_wake)
+                       clearMgrReady();
+
+                   const plan_entry_t* capture = planStartCapture();
 
-                   numSamplesRemaining[x_active] = adcNumSamples;
-                   numSamplesRemaining[y_active] = adcNumSamples;
-                   numSamplesRemaining[z_active] = adcNumSamples;
+                   adcSampFreq    = capture->sampFreq;
+                   adcSampTime_us = getSampTime_us(adcSampFreq);
+                   adcNumSamples  = capture->numSamples;
+                   sleepDur_s     = getSleepDur();
+
+                   setupCapture(adcNumSamples);
 
                    /* Initialise ADC */
                    /* This was moved into FSM because it depends on num samples being taken */
                    ADC_Init(); 
+                   if (first_of_wake)
+                       ADC_Aux_Scan();
 #else
                    adcExtraBits = getExtraBits();
                    adcSampTime_us = getSamptime(ACLOCK, getResolution());
 #endif
                    /* Turn on Sampling Timer before going to ACQ*/
+                   sampJitterReset(adcSampTime_us);
                    sampling_scheduler.source  = GP_TMR;    //NOTE only GP_TMR source available for now
                    sampling_scheduler.tick_us = adcSampTime_us;
                    StartSamplingScheduler(sampling_scheduler);
@@ -373,40 +432,53 @@ int main(void)
                   // If flash is needed check that no operation is in progress
                   // before progressing
                   waitForSpi2();
+                  reportCaptureEvents();
                   state = GET_DATA;
                }
                break;
 
 
            case GET_DATA:
-               // This state will only ever be entered if we need flash
-               if (!checkPagePointers(x_active))
-                   active_axis_tx = x_active;
-               else if (!checkPagePointers(y_active))
-                   active_axis_tx = y_active;
-               else if (!checkPagePointers(z_active))
-                   active_axis_tx = z_active;
-
-               DEBUG_PRINT(("Fetching data from axis %d - Block %d, Page %d\n", active_axis_tx, getBlockAddrRd(active_axis_tx), getPageAddrRd(active_axis_tx)));
-
-               flashPageRead(getBlockAddrRd(active_axis_tx), getPageAddrRd(active_axis_tx));
-               // Only going to be dealing with one axis at a time so 
-               // just reuse the x axis array.
-               // Read from column address 0x0 and into location 1 of data array. 
-               // Location 0 is reserved for the GUI header
-               
-               // TODO replace FLASH_PAGE_SIZE_B with num samples remaining... doesn't really matter
-               flashReadFromCache(0x0, (uint8_t*)&adcDataX[1], FLASH_PAGE_SIZE_B);
-               updatePagePointers(false, active_axis_tx);  // false = read
-               
-               updateAdcParams(numSamplesRemaining[active_axis_tx], ext_flash_needed);
-               numSamplesRemaining[active_axis_tx] -= ADC_SAMPLES_PER_BUFF;
-
-               // HACK: Need to copy index 1025 into 1026. This has to do with the fact that
-               // the GUI expects the ADC header to be 4 bytes instead of the correct 2.
-               // But when you try to change its expectations it falls over
-               // So duplicating the final byte in the first flash page for now
-               adcDataX[ADC_DATA_END_1ST_S] = adcDataX[ADC_DATA_END_1ST_S-1];
+               // This state will only ever be entered if we need flash.
+               // Normally the page was already read while the last one was sent
+               if (!txPage[txPageIdx].full && !txPage[txPageIdx].fetching)
+                   fetchTxPage(&txPage[txPageIdx]);
+
+               if (!txPage[txPageIdx].full || !txPageOk(&txPage[txPageIdx]))
+                   break;
+
+               // Every page has been checked once the last one has
+               if (archRdAllDone() && !txPage[txPageIdx ^ 1u].full && !txPage[txPageIdx ^ 1u].fetching &&
+                   (archCorruptPages(0x07) > 0))
+                   txQueueEvent(EVENT_FLASH_CORRUPT, archCorruptPages(0x07));
+
+               active_axis_tx = txPage[txPageIdx].axis;
+
+               // Only the used part of a page is sent, after the header word
+               // on the first page of the axis. startTx() takes 4 bytes off
+               // the size of pages without the header
+               {
+                   uint16_t used;
+
+                   if (archCurrentRecord()->flags & ARCH_FLAG_COMPRESSED)
+                   {
+                       // The spectrum page that may follow the samples isn't coded
+                       uint8_t *page = (uint8_t*)&txPage[txPageIdx].buf[1];
+
+                       used = codecPageBytes(page);
+                       if (used == 0)
+                           used = flashFftPageBytes(page);
+                   }
+                   else
+                   {
+                       updateAdcParams(txPage[txPageIdx].numSamplesRemaining, ext_flash_needed);
+                       used = (uint16_t)(2u * ADC_NUM_SAMPLES);
+                   }
+
+                   ADC_DATA_SIZE = ADC_PARAM_LEN + used;
+                   if (!send_axis_hdr[active_axis_tx])
+                       ADC_DATA_SIZE += ADC_PARAM_LEN;
+               }
 
                state = CALC;
                break;
@@ -419,13 +491,22 @@ int main(void)
                {
                   // Can't do FFT if using off-chip flash. FFT needs to be performed on 
                   // all of the the data at once
-                  startTx(send_axis_hdr[active_axis_tx], active_axis_tx);
+                  // The frame of an axis ends with its last page. The other
+                  // buffer can only hold a later page of it while it is fetched
+                  tx_page_t *next     = &txPage[txPageIdx ^ 1u];
+                  bool       lastAxis = archRdDone(active_axis_tx) &&
+                                        !((next->full || next->fetching) && (next->axis == active_axis_tx));
+
+                  startTx(send_axis_hdr[active_axis_tx], active_axis_tx, txPage[txPageIdx].buf, lastAxis);
                   send_axis_hdr[active_axis_tx] = 0;  // Header sent for current axis
                } 
                else
                {
-                  ADC_Calc_FFT();
-                  startTx(true, NULL);
+                  if (planCurrentCapture()->proc & PLAN_PROC_FFT)
+                      ADC_Calc_FFT();
+                  else
+                      ADC_Clear_FFT();
+                  startTx(true, NULL, NULL, true);
                }
 
                //rtc_ReportTime();
@@ -433,43 +514,114 @@ int main(void)
                break;
 
            case TX:
+               // Read the next page into the other buffer while this one is sent
+               if (ext_flash_needed && !archRdAllDone() && !txPage[txPageIdx ^ 1u].full && !txPage[txPageIdx ^ 1u].fetching)
+                   fetchTxPage(&txPage[txPageIdx ^ 1u]);
+
+               // Packets may still be queued in the mote once the last one has
+               // been accepted. Pages are sent straight on from each other,
+               // only the end of the capture waits for the mote to send them
+               lastTxPage = !ext_flash_needed ||
+                            (archRdAllDone() && !txPage[txPageIdx ^ 1u].full && !txPage[txPageIdx ^ 1u].fetching);
+
 #ifndef COG
-               if (!txRunning() && gotFinalAck()) 
+               if (!txRunning() && gotFinalAck() && (!lastTxPage || txAllDone())) 
 #else
                if (1)
 #endif
                {
                    numTxSuccess_DBG++;
 
-                   if (!checkAllPagePointers() && ext_flash_needed)
+                   if (ext_flash_needed)
                    {
-                       state = GET_DATA;
+                       txPage[txPageIdx].full = false;
+                       txPageIdx ^= 1u;
+
+                       if (archRdAllDone() && !txPage[txPageIdx].full && !txPage[txPageIdx].fetching)
+                       {
+                           offloadTime_DBG = rtc_GetTime() - offloadStart_s;
+                           DEBUG_PRINT(("Offload took %ds\n", offloadTime_DBG));
+                       }
                    }
-                   else if (sleepDur_s == 0)
+
+                   if (ext_flash_needed && (!archRdAllDone() || txPage[txPageIdx].full || txPage[txPageIdx].fetching))
                    {
-                      DEBUG_PRINT(("Finished Tx #%d\n", numTxSuccess_DBG));
-                      //rtc_ReportTime();
-                      state = WAIT;
+                       state = GET_DATA;
                    }
                    else
                    {
-                      state = SLEEP_MCU;
-                      DEBUG_PRINT(("Finished TX #%d. Going to sleep\n", numTxSuccess_DBG));
+                       evTimerStart(&retxTimer, FRAME_NACK_WAIT_S * 1000u, NULL);
+                       state = RETX;
                    }
                }
                break;
 
+           case RETX:
+               // The frames of the capture are kept until the manager has
+               // them all, the ranges it missed are sent again
+               if (txRunning() || !gotFinalAck())
+                   break;
+
+               {
+                   axis_t   axis;
+                   uint32_t offset, numBytes;
+                   uint8_t  *data;
+
+                   if (txRetxNext(&axis, &offset, &numBytes))
+                   {
+                       numBytes = retxLocate(axis, offset, numBytes, &data);
+                       if (numBytes > 0)
+                           startRetx(data, numBytes, offset);
+
+                       txRetxDone(numBytes);
+                       evTimerStart(&retxTimer, FRAME_NACK_WAIT_S * 1000u, NULL);
+                       break;
+                   }
+               }
+
+               if (!txFramesAcked() && evTimerActive(&retxTimer))
+                   break;
+
+               // The manager has the whole capture, it needn't be sent again
+               // after a reset. One given up on without it saying so stays
+               // in the unsent slot to be replayed
+               if (txFramesAcked())
+                   archMarkSent();
+
+               evTimerStop(&retxTimer);
+               txFramesRelease();
+
+               if (archIsReplay() || planCaptureRemaining() || ((sleepDur_s == 0) && streamCredit()))
+               {
+                   // Straight on to the next capture of the plan or of the
+                   // stream, or back to waiting for the manager after a replay
+                   state = NEW_PARAM;
+               }
+               else if (sleepDur_s == 0)
+               {
+                  DEBUG_PRINT(("Finished Tx #%d\n", numTxSuccess_DBG));
+                  //rtc_ReportTime();
+                  evTimerStart(&waitTimer, WAIT_MS, NULL);
+                  state = WAIT;
+               }
+               else
+               {
+                  state = SLEEP_MCU;
+                  DEBUG_PRINT(("Finished TX #%d. Going to sleep\n", numTxSuccess_DBG));
+               }
+               break;
+
            case WAIT:
-               if (waitDone)
+               if (!evTimerActive(&waitTimer))
                {
-                   waitDone = 0;
-                   timerTicked = false;
+                   evTimerStart(&mainTickTimer, MAIN_TICK_MS, mainTick);
                    state = NEW_PARAM;
                }
                break;
 
 
            case SLEEP_MCU:
+              archEraseWait();
               rtc_SetAlarm(sleepDur_s);
               adi_gpio_SetLow( ADI_GPIO_PORT1, ADI_GPIO_PIN_12);
               
@@ -482,8 +634,8 @@ int main(void)
            case WAKEUP:
               wakeFromShutdown();  
               adi_gpio_SetHigh( ADI_GPIO_PORT1, ADI_GPIO_PIN_12);
-              timerTicked = false;
-              
+              evTimerStart(&mainTickTimer, MAIN_TICK_MS, mainTick);
+
               state = NEW_PARAM;
               break;
 
@@ -491,6 +643,9 @@ int main(void)
                while (1);
                break;
        }
+
+       /* Nothing left to do until an interrupt */
+       evIdle(mainIdle);
    }
 }
 
@@ -533,6 +688,288 @@ void setupRadio()
 }
 
 
+// Work out how a capture of numSamples per axis is held and sent: from
+// RAM when it fits in one buffer, a page at a time from the flash otherwise
+void setupCapture(uint32_t numSamples)
+{
+   if (numSamples > ADC_SAMPLES_PER_BUFF)
+   {
+       ext_flash_needed = true;
+       send_axis_hdr[x_active] = 1;
+       send_axis_hdr[y_active] = 1;
+       send_axis_hdr[z_active] = 1;
+   }
+   else
+   {
+       ext_flash_needed = false;
+       send_axis_hdr[x_active] = 0;
+       send_axis_hdr[y_active] = 0;
+       send_axis_hdr[z_active] = 0;
+   }
+
+   updateAdcParams(numSamples, ext_flash_needed);
+
+   numSamplesRemaining[x_active] = numSamples;
+   numSamplesRemaining[y_active] = numSamples;
+   numSamplesRemaining[z_active] = numSamples;
+
+   txPage[0].full     = false;
+   txPage[1].full     = false;
+   txPage[0].fetching = false;
+   txPage[1].fetching = false;
+   txPageIdx      = 0;
+   offloadStart_s = 0;
+}
+
+
+// Read an archived capture that fits in RAM back into the sample arrays,
+// where it would have been had it just been acquired
+void loadArchivedCapture(void)
+{
+   uint16_t *data[3] = { adcDataX, adcDataY, adcDataZ };
+
+   for (uint8_t a = x_active; a <= z_active; a++)
+   {
+       if (archRdDone((axis_t)a))
+           continue;
+
+       readRow = archRdRow((axis_t)a);
+       if (archCheckPage(readRow) >= FLASH_PAGE_ECC_FAILED)
+           archMarkCorrupt((axis_t)a);
+       flashReadFromCache(0x0, (uint8_t*)&data[a][ADC_DATA_START_1ST_S], FLASH_PAGE_SIZE_B);
+       archRdAdvance((axis_t)a);
+   }
+}
+
+
+// Flash command queue callback for the page read, interrupt context. The
+// status has the ECC result of the read
+void txPageStatus(void *param, uint8_t status)
+{
+   ((tx_page_t*)param)->status = status;
+}
+
+
+// Flash command queue callback for the read of a page, interrupt context
+void txPageRead(void *param, uint8_t status)
+{
+   tx_page_t *page = (tx_page_t*)param;
+
+   page->fetching = false;
+   page->full     = true;
+}
+
+
+// Queue the read of the next flash page of the capture into a TX buffer.
+// Axes are sent in X, Y, Z order, all pages of one before the next. The
+// read waits on the flash from interrupts, including for any block erase
+// still running, so the main loop carries on
+void fetchTxPage(tx_page_t *page)
+{
+   if (offloadStart_s == 0)
+       offloadStart_s = rtc_GetTime();
+
+   if (!archRdDone(x_active))
+       page->axis = x_active;
+   else if (!archRdDone(y_active))
+       page->axis = y_active;
+   else
+       page->axis = z_active;
+
+   readRow = archRdRow(page->axis);
+   DEBUG_PRINT(("Fetching data from axis %d - Block %d, Page %d\n", page->axis, FLASH_ROW_BLOCK(readRow), FLASH_ROW_PAGE(readRow)));
+
+   page->row     = readRow;
+   page->retries = 0;
+   if (!readTxPage(page))
+       return;
+
+   archRdAdvance(page->axis);
+
+   page->numSamplesRemaining = numSamplesRemaining[page->axis];
+   numSamplesRemaining[page->axis] -= ADC_SAMPLES_PER_BUFF;
+}
+
+
+// Where a range of a frame kept from the capture is held, to send it again.
+// A capture in RAM is still in the sample arrays. Of one in flash, the page
+// the range starts in is looked up in the offsets its pages were sent from,
+// see txRetxPage(), and read into the first TX buffer. A page that fails its
+// check is counted against its axis as in txPageOk(), its frame has already
+// ended so the manager hears of it with an event, and the range is dropped.
+// Returns the bytes of the range from *ppData, 0 if it is past the end of
+// the frame or its page is corrupt
+uint32_t retxLocate(axis_t axis, uint32_t offset, uint32_t numBytes, uint8_t **ppData)
+{
+   uint16_t         *data[3] = { adcDataX, adcDataY, adcDataZ };
+   const arch_rec_t *arch    = archCurrentRecord();
+   uint8_t          *buf     = (uint8_t*)txPage[0].buf;
+   uint32_t         pageStart;            // Frame offset of the first byte sent from the page
+   uint32_t         len;
+   uint16_t         k;
+   uint16_t         row;
+
+   if (!ext_flash_needed)
+   {
+       if (offset >= ADC_DATA_SIZE)
+           return 0;
+
+       *ppData = (uint8_t*)data[axis] + offset;
+       return (numBytes < ADC_DATA_SIZE - offset) ? numBytes : ADC_DATA_SIZE - offset;
+   }
+
+   if ((arch == NULL) || !txRetxPage(offset, &k, &pageStart, &len) || (k >= arch->nPages))
+       return 0;
+
+   row = archAxisRow(axis, k);
+   if (archCheckPage(row) >= FLASH_PAGE_ECC_FAILED)
+   {
+       DEBUG_PRINT(("Page %d of axis %d corrupt, range not sent again\n", k, axis));
+       archMarkCorrupt(axis);
+       txQueueEvent(EVENT_FLASH_CORRUPT, archCorruptPages(0x07));
+       return 0;
+   }
+
+   flashReadFromCache(0x0, &buf[ADC_PARAM_LEN], FLASH_PAGE_SIZE_B);
+
+   // Only the first page of the axis is sent with the header word
+   txPage[0].buf[0] = frameHeaderWord(axis);
+
+   *ppData = buf + ((k == 0) ? 0 : ADC_PARAM_LEN) + (offset - pageStart);
+   len     = pageStart + len - offset;
+   return (numBytes < len) ? numBytes : len;
+}
+
+
+// Queue the reads of the page at page->row, its data and then its CRC.
+// Returns false, with nothing queued, if the flash queue hasn't room for
+// all of them. The caller tries again on a later pass
+bool readTxPage(tx_page_t *page)
+{
+   fq_job_t cmd;
+
+   if (flashQueueRoom() < TX_PAGE_READ_CMDS)
+   {
+       txPageReadFull_DBG++;
+       return false;
+   }
+
+   memset(&cmd, 0, sizeof(cmd));
+   page->fetching = true;
+   page->status   = 0;
+
+   cmd.cmd      = FQ_CMD_PAGE_READ;
+   cmd.block    = FLASH_ROW_BLOCK(page->row);
+   cmd.page     = FLASH_ROW_PAGE(page->row);
+   cmd.callback = txPageStatus;
+   cmd.param    = page;
+   flashQueueSubmit(&cmd);
+
+   // Read from column address 0x0 and into location 1 of the buffer. 
+   // Location 0 is reserved for the GUI header
+   
+   // TODO replace FLASH_PAGE_SIZE_B with num samples remaining... doesn't really matter
+   cmd.cmd      = FQ_CMD_READ_CACHE;
+   cmd.column   = 0x0;
+   cmd.pBuf     = (uint8_t*)&page->buf[1];
+   cmd.nBytes   = FLASH_PAGE_SIZE_B;
+   cmd.callback = NULL;
+   cmd.param    = NULL;
+   flashQueueSubmit(&cmd);
+
+   cmd.column   = FLASH_PAGE_CRC_COL;
+   cmd.pBuf     = (uint8_t*)&page->crc;
+   cmd.nBytes   = sizeof(page->crc);
+   cmd.callback = txPageRead;
+   cmd.param    = page;
+   flashQueueSubmit(&cmd);
+
+   return true;
+}
+
+
+// Check a page that has been read. If it fails, it is read again, up to
+// FLASH_READ_RETRIES times, and false is returned until the new read is in.
+// A page that still fails is sent as it is and counted against its axis,
+// the frame info goes again ahead of the end of the frame to say so
+bool txPageOk(tx_page_t *page)
+{
+   const arch_rec_t *rec = archCurrentRecord();
+   bool    hasCrc = (rec != NULL) && (rec->flags & ARCH_FLAG_PAGE_CRC);
+   uint8_t result = flashCheckPageData(hasCrc ? (uint8_t*)&page->buf[1] : NULL, page->crc, page->status);
+
+   if ((result >= FLASH_PAGE_ECC_FAILED) && (page->retries < FLASH_READ_RETRIES))
+   {
+       DEBUG_PRINT(("Page check failed (%d), reading again\n", result));
+       page->full = false;
+       if (!readTxPage(page))
+       {
+           // Checked and read again on a later pass
+           page->full = true;
+           return false;
+       }
+       page->retries++;
+       return false;
+   }
+
+   archCountCheck(result, page->retries);
+   if (result >= FLASH_PAGE_ECC_FAILED)
+       archMarkCorrupt(page->axis);
+   return true;
+}
+
+
+// Queue an event for whatever went wrong storing the capture in flash, so
+// the manager hears of it before the first of its data. Corrupt pages are
+// only known as they are read, see GET_DATA
+void reportCaptureEvents(void)
+{
+   if (!archIsReplay() && (getFlashWrStats()->overruns > 0))
+       txQueueEvent(EVENT_WRITER_OVERRUN, getFlashWrStats()->overruns);
+}
+
+
+// Every MAIN_TICK_MS: heartbeat, and the ready message while waiting on
+// the manager. A streaming mote only waits once its credit has run out, the
+// ready message then asks for more
+void mainTick(void)
+{
+   adi_gpio_Toggle(ADI_GPIO_PORT1, ADI_GPIO_PIN_12);
+
+   if ((state == WAIT_FOR_READY) || (state == NEW_PARAM))
+       sendMgrReady();   // Let manager know you're ready
+
+   evTimerStart(&mainTickTimer, MAIN_TICK_MS, mainTick);
+}
+
+
+// Called with the interrupts off at the end of each pass of the main loop.
+// The core may sleep if the pass left the state as it was, no UART bytes
+// are waiting and the state can only move on from an interrupt: a reply or
+// notification from the mote, a flash queue callback or a timer
+bool mainIdle(void)
+{
+   if ((head != tail) || (state != passState))
+       return false;
+
+   switch (state)
+   {
+       case RADIO_SETUP:
+           return radioSetupDone;
+
+       case WAIT_FOR_READY:
+       case NEW_PARAM:
+       case TX:
+       case RETX:
+       case WAIT:
+           return true;
+
+       default:
+           return false;
+   }
+}
+
+
 void initialise()
 {
 
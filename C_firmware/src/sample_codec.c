@@ -0,0 +1,304 @@
+/*********************************************************************************
+Copyright(c) 2018-2020 Analog Devices, Inc. All Rights Reserved.
+
+This software is proprietary to Analog Devices, Inc. and its licensors.
+By using this software you agree to the terms of the associated Analog Devices
+License Agreement.
+*********************************************************************************/
+
+/*!
+* @file      sample_codec.c
+* @brief     Lossless sample compression for flash pages
+*
+* @details
+*            Each sample is predicted from the ones before it and the
+*            residual is Rice coded. Samples are coded one at a time as they
+*            are acquired, so the cost is spread over the sampling period.
+*
+*            The samples go in blocks of CODEC_BLOCK_LEN. For every block,
+*            the first or second order predictor is chosen, whichever did
+*            better on the block before, and the Rice parameter k comes from
+*            that predictor's mean residual. The decoder works both out the
+*            same way from the samples it has decoded, so nothing but the
+*            residuals is stored.
+*
+*            A residual r is mapped to u = 2r (r >= 0) or -2r-1 (r < 0) and
+*            written as u >> k in unary (ones ending with a zero) then the k
+*            low bits of u. If the unary part would be CODEC_ESC_Q or longer,
+*            CODEC_ESC_Q ones are followed by u in CODEC_RAW_BITS instead.
+*
+*            A page starts with codec_page_hdr_t, its first sample is stored
+*            as is and the predictors start from it. Pages therefore never
+*            depend on each other.
+*
+*/
+/*=======================  I N C L U D E S   =================================*/
+
+#include <string.h>
+
+#include "sample_codec.h"
+
+#if 0
+  #define DEBUG_PRINT(a) printf a
+#else
+  #define DEBUG_PRINT(a) (void)0
+#endif
+
+/*=======================  L O C A L    F U N C T I O N S  ===================*/
+
+// Append the n low bits of value, n <= 24
+static void putBits(codec_enc_t *enc, uint32_t value, uint8_t n)
+{
+    enc->acc      = (enc->acc << n) | (value & ((1u << n) - 1u));
+    enc->accBits += n;
+
+    while (enc->accBits >= 8u)
+    {
+        enc->accBits -= 8u;
+        enc->page[CODEC_HDR_B + enc->nBytes++] = (uint8_t)(enc->acc >> enc->accBits);
+    }
+}
+
+
+static uint16_t predict2(uint16_t prev1, uint16_t prev2)
+{
+    int32_t p = 2 * (int32_t)prev1 - (int32_t)prev2;
+
+    if (p < 0)
+        p = 0;
+    else if (p > UINT16_MAX)
+        p = UINT16_MAX;
+
+    return (uint16_t)p;
+}
+
+
+static uint32_t absDiff(uint16_t a, uint16_t b)
+{
+    return (a > b) ? (uint32_t)(a - b) : (uint32_t)(b - a);
+}
+
+
+// Bits needed for the mean residual of a block
+static uint8_t riceParam(uint32_t sumAbs)
+{
+    uint32_t mean = sumAbs >> CODEC_BLOCK_SHIFT;
+    uint8_t  k    = 0;
+
+    while ((mean >> k) && (k < CODEC_K_MAX))
+        k++;
+
+    return k;
+}
+
+
+static void modelStart(codec_model_t *model, uint16_t first)
+{
+    memset(model, 0, sizeof(*model));
+
+    model->prev1 = first;
+    model->prev2 = first;
+    model->order = 1;
+    model->k     = CODEC_K_INIT;
+}
+
+
+static uint16_t modelPredict(const codec_model_t *model)
+{
+    return (model->order == 1) ? model->prev1 : predict2(model->prev1, model->prev2);
+}
+
+
+// Account for the sample just coded and choose the predictor and Rice
+// parameter of the next block when this one is complete
+static void modelUpdate(codec_model_t *model, uint16_t sample)
+{
+    model->sumAbs1 += absDiff(sample, model->prev1);
+    model->sumAbs2 += absDiff(sample, predict2(model->prev1, model->prev2));
+    model->prev2    = model->prev1;
+    model->prev1    = sample;
+
+    if (++model->blkCount == CODEC_BLOCK_LEN)
+    {
+        model->order    = (model->sumAbs2 < model->sumAbs1) ? 2u : 1u;
+        model->k        = riceParam((model->order == 1) ? model->sumAbs1 : model->sumAbs2);
+        model->sumAbs1  = 0;
+        model->sumAbs2  = 0;
+        model->blkCount = 0;
+    }
+}
+
+
+// Read the next n bits, n <= 24. Reads past the used part of the page
+// give zeros, so a damaged page can't make the decoder run off it
+static uint32_t getBits(codec_dec_t *dec, uint8_t n)
+{
+    uint32_t value = 0;
+
+    while (n--)
+    {
+        value <<= 1;
+        if (dec->bitPos < dec->endBit)
+            value |= (dec->page[dec->bitPos >> 3] >> (7u - (dec->bitPos & 7u))) & 1u;
+        dec->bitPos++;
+    }
+
+    return value;
+}
+
+/*==========================  C O D E  =======================================*/
+
+// Begin a page with its first sample. page is FLASH_PAGE_SIZE_B bytes.
+// Calibrated samples are signed and are coded as offset binary, so they
+// don't wrap around between -1 and 0
+void codecStart(codec_enc_t *enc, uint8_t *page, uint16_t first, bool isSigned)
+{
+    memset(enc, 0, sizeof(*enc));
+
+    enc->page     = page;
+    enc->flags    = isSigned ? CODEC_FLAG_SIGNED : 0;
+    enc->nSamples = 1;
+    enc->first    = first;
+
+    if (isSigned)
+        first ^= 0x8000u;
+
+    modelStart(&enc->model, first);
+}
+
+
+// True if one more sample is sure to fit in the page
+bool codecRoom(const codec_enc_t *enc)
+{
+    return ((uint32_t)enc->nBytes * 8u + enc->accBits + CODEC_MAX_SAMPLE_BITS <= CODEC_PAGE_BITS) &&
+           (enc->nSamples < UINT16_MAX);
+}
+
+
+// Code the next sample. Only call while codecRoom() is true
+void codecPut(codec_enc_t *enc, uint16_t sample)
+{
+    uint8_t  k = enc->model.k;
+    int32_t  r;
+    uint32_t u, q;
+
+    if (enc->flags & CODEC_FLAG_SIGNED)
+        sample ^= 0x8000u;
+
+    r = (int32_t)sample - (int32_t)modelPredict(&enc->model);
+    u = (r >= 0) ? ((uint32_t)r << 1) : (((uint32_t)(-r) << 1) - 1u);
+    q = u >> k;
+
+    if (q < CODEC_ESC_Q)
+    {
+        putBits(enc, ((1u << q) - 1u) << 1, (uint8_t)(q + 1u));
+        if (k > 0)
+            putBits(enc, u, k);
+    }
+    else
+    {
+        putBits(enc, (1u << CODEC_ESC_Q) - 1u, CODEC_ESC_Q);
+        putBits(enc, u, CODEC_RAW_BITS);
+    }
+
+    modelUpdate(&enc->model, sample);
+    enc->nSamples++;
+}
+
+
+// Write out the last bits and the page header. Returns the bytes used
+uint16_t codecFinish(codec_enc_t *enc)
+{
+    codec_page_hdr_t hdr;
+
+    if (enc->accBits > 0)
+        putBits(enc, 0, (uint8_t)(8u - enc->accBits));
+
+    hdr.magic    = CODEC_PAGE_MAGIC;
+    hdr.flags    = enc->flags;
+    hdr.nBytes   = (uint16_t)(CODEC_HDR_B + enc->nBytes);
+    hdr.nSamples = enc->nSamples;
+    hdr.first    = enc->first;
+    memcpy(enc->page, &hdr, sizeof(hdr));
+
+    return hdr.nBytes;
+}
+
+
+// Used bytes of a compressed page, 0 if it isn't one
+uint16_t codecPageBytes(const uint8_t *page)
+{
+    codec_page_hdr_t hdr;
+
+    memcpy(&hdr, page, sizeof(hdr));
+    if ((hdr.magic != CODEC_PAGE_MAGIC) || (hdr.nBytes < CODEC_HDR_B) || (hdr.nBytes > FLASH_PAGE_SIZE_B))
+        return 0;
+
+    return hdr.nBytes;
+}
+
+
+// Start reading the samples of a compressed page. Returns false if it isn't one
+bool codecDecStart(codec_dec_t *dec, const uint8_t *page)
+{
+    codec_page_hdr_t hdr;
+    uint16_t         nBytes = codecPageBytes(page);
+
+    if (nBytes == 0)
+        return false;
+
+    memcpy(&hdr, page, sizeof(hdr));
+    memset(dec, 0, sizeof(*dec));
+
+    dec->page   = page;
+    dec->bitPos = CODEC_HDR_B * 8u;
+    dec->endBit = nBytes * 8u;
+    dec->left   = hdr.nSamples;
+    dec->flags  = hdr.flags;
+
+    if (dec->flags & CODEC_FLAG_SIGNED)
+        hdr.first ^= 0x8000u;
+
+    modelStart(&dec->model, hdr.first);
+    return true;
+}
+
+
+// Next sample of the page, as it was given to codecPut(). Returns false
+// once all of them have been read
+bool codecGet(codec_dec_t *dec, uint16_t *sample)
+{
+    uint16_t x;
+    uint32_t u, q = 0;
+    int32_t  r;
+
+    if (dec->left == 0)
+        return false;
+
+    dec->left--;
+
+    if (!dec->firstDone)
+    {
+        // The first sample is the one the model was started from
+        dec->firstDone = true;
+        x = dec->model.prev1;
+    }
+    else
+    {
+        while ((q < CODEC_ESC_Q) && getBits(dec, 1))
+            q++;
+
+        if (q == CODEC_ESC_Q)
+            u = getBits(dec, CODEC_RAW_BITS);
+        else
+            u = (q << dec->model.k) | getBits(dec, dec->model.k);
+
+        r = (u & 1u) ? -(int32_t)((u + 1u) >> 1) : (int32_t)(u >> 1);
+        x = (uint16_t)((int32_t)modelPredict(&dec->model) + r);
+
+        modelUpdate(&dec->model, x);
+    }
+
+    *sample = (dec->flags & CODEC_FLAG_SIGNED) ? (uint16_t)(x ^ 0x8000u) : x;
+    return true;
+}
@@ -21,13 +21,13 @@ License Agreement.
 #include "SPI1_AD7685.h"
 #include "scheduler.h"
 #include "SmartMesh_RF_cog.h"
+#include "event_loop.h"
 #include <adi_rtc.h>
 
 // For printf statements
 #include "stdio.h"
 #include "stdint.h"
-
-bool timerTicked = false;
+#include <string.h>
 
 /*=============  D A T A  =============*/
 
@@ -41,6 +41,12 @@ uint32_t                 nTimeout;
 volatile static uint32_t gNumGp0Timeouts = 0u;
 bool check_ad7685 = false; //Controls FFT readings
 
+#ifdef SAMP_JITTER_PROFILING
+/* Cycle count latched on the most recent sampling timer tick */
+static volatile uint32_t sampTickCycles = 0u;
+static samp_jitter_t     sampJitter;
+#endif
+
 /* Clocks */
 extern uint16_t          HDIV;
 extern uint16_t          PDIV;
@@ -51,8 +57,6 @@ extern uint32_t          lfxtal_freq;
 
 /* Flags */
 extern bool              idle;
-extern int               waitDone;
-extern int               timerTicks;
 extern int               FFT_Samples_Timeout;
 
 /* Application variables struct for SmartMesh */
@@ -258,11 +262,9 @@ void GP0CallbackFunction(void *pCBParam, uint32_t Event, void  * pArg)
     if ((Event & ADI_TMR_EVENT_TIMEOUT) == ADI_TMR_EVENT_TIMEOUT)
     {
         gNumGp0Timeouts++;
-        
-        adi_gpio_Toggle(ADI_GPIO_PORT1, ADI_GPIO_PIN_12);
-        waitDone = 1;
-        timerTicks++;
-        timerTicked = true;
+
+        /* The main loop fires the timers that are due */
+        evTick();
     }
 }
 
@@ -273,7 +275,65 @@ void SamplingTimeCallbackFunction(void *pCBParam, uint32_t Event, void  * pArg)
     /* IF(Interrupt occurred because of a timeout) */
     if ((Event & ADI_TMR_EVENT_TIMEOUT) == ADI_TMR_EVENT_TIMEOUT)
     {
+#ifdef SAMP_JITTER_PROFILING
+        sampTickCycles = DWT->CYCCNT;
+
+        // Previous tick still hasn't been serviced, so that sample is lost
+        if (check_ad7685)
+            sampJitter.numMissed++;
+#endif
         /* Set adc read flag and reset timeout */
         check_ad7685 = true; // When this flag is set the data from the ADC will be read back over SPI
     }
 }
+
+
+/* Clear the jitter statistics before a new capture and start the DWT cycle
+ * counter. Should be called before the sampling timer is started */
+void sampJitterReset(uint32_t period_us)
+{
+#ifdef SAMP_JITTER_PROFILING
+    memset(&sampJitter, 0, sizeof(sampJitter));
+    sampJitter.period_us = period_us;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT       = 0u;
+    DWT->CTRL        |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+
+/* Called on the rising CONV edge of each AD7685 read. Records the latency
+ * between the sampling timer tick and the actual start of conversion */
+void sampJitterConvEdge(void)
+{
+#ifdef SAMP_JITTER_PROFILING
+    uint32_t latency_us;
+    uint8_t  bin = 0;
+
+    // Unsigned subtraction handles the counter wrapping
+    latency_us = (DWT->CYCCNT - sampTickCycles) / (hfosc_freq / 1000000u);
+
+    sampJitter.numSamples++;
+
+    if (latency_us > sampJitter.maxLatency_us)
+        sampJitter.maxLatency_us = latency_us;
+
+    if (latency_us > (sampJitter.period_us >> 1))
+        sampJitter.numLate++;
+
+    while (bin < SAMP_JITTER_HIST_BINS - 1u && latency_us >= (1u << bin))
+        bin++;
+
+    if (sampJitter.hist[bin] < UINT16_MAX)
+        sampJitter.hist[bin]++;
+#endif
+}
+
+
+#ifdef SAMP_JITTER_PROFILING
+const samp_jitter_t* getSampJitter(void)
+{
+    return &sampJitter;
+}
+#endif
@@ -208,6 +208,9 @@ ADI_RTC_RESULT enterSleep(ADI_PWR_POWER_MODE low_power_mode_type)
   
     ADI_RTC_RESULT eResult;
 
+    // The last frame to the radio may still be going out by DMA
+    dn_uart_txFlush();
+
     // Enable SRAM retention for hibernate
     pADI_PMG0->SRAMRET = 0x303;
 
@@ -326,6 +329,15 @@ void rtc0Callback (void *pCBParam, uint32_t nEvent, void *EventArg) {
 
 }
 
+/* Current RTC count in seconds, used to timestamp captures */
+uint32_t rtc_GetTime(void)
+{
+    uint32_t rtcCount = 0;
+
+    adi_rtc_GetCount(hDevice0, &rtcCount);
+    return rtcCount;
+}
+
 /*  standard ctime (time.h) constructs */
 void rtc_ReportTime(void) {
 